@@ -0,0 +1,75 @@
+#include "bench.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Every heap allocation of the process is counted so benchmarks can report allocations per frame.
+// Only in this build, the app doesn't link this file and keeps the default allocator.
+static std::atomic<unsigned long long> heapAllocations(0);
+
+static unsigned long long countedAllocations() {
+	return heapAllocations.load(std::memory_order_relaxed);
+}
+
+void * operator new(size_t size) {
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	void * p = malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+void * operator new[](size_t size) {
+	return operator new(size);
+}
+void operator delete(void * p) noexcept {
+	free(p);
+}
+void operator delete[](void * p) noexcept {
+	free(p);
+}
+void operator delete(void * p, size_t) noexcept {
+	free(p);
+}
+void operator delete[](void * p, size_t) noexcept {
+	free(p);
+}
+
+#ifdef __cpp_aligned_new
+// over-aligned types (alignas > 16) go through these from C++17 on
+void * operator new(size_t size, std::align_val_t align) {
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+#ifdef _WIN32
+	void * p = _aligned_malloc(size ? size : 1, (size_t)align);
+#else
+	void * p = nullptr;
+	if (posix_memalign(&p, (size_t)align < sizeof(void *) ? sizeof(void *) : (size_t)align, size ? size : 1) != 0) p = nullptr;
+#endif
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+void * operator new[](size_t size, std::align_val_t align) {
+	return operator new(size, align);
+}
+void operator delete(void * p, std::align_val_t) noexcept {
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+void operator delete[](void * p, std::align_val_t align) noexcept {
+	operator delete(p, align);
+}
+void operator delete(void * p, size_t, std::align_val_t align) noexcept {
+	operator delete(p, align);
+}
+void operator delete[](void * p, size_t, std::align_val_t align) noexcept {
+	operator delete(p, align);
+}
+#endif
+
+// Standalone entry for the headless benchmarks (see bench.h), the app runs the same with --bench
+int main(int argc, char * argv[]) {
+	benchHeapAllocations = countedAllocations;
+	return runBenchmarks(argc, argv);
+}
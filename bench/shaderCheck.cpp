@@ -0,0 +1,270 @@
+// Runs the keyed / depth shaders (src/keyingShaders.h) offscreen and compares every pixel with the
+// CPU reference (keyBodies(), colorizeDepth()). Needs EGL and desktop GL, a software implementation
+// is fine and the point: on a box without a GPU Mesa's llvmpipe runs it
+//   make -C bench shadercheck && bench/kinect2share-shadercheck
+// Exits non zero if the shaders don't compile or any byte differs.
+
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include "frameSource.h"
+#include "keying.h"
+#include "keyingShaders.h"
+#include "pixelKernels.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+// same idea as the bench's synthetic frame: two bodies, a noisy depth ramp with holes and a mapping
+// slightly wider than the color frame, some points -inf
+struct CheckFrame {
+	std::vector<unsigned short> depth;
+	std::vector<unsigned char> bodyIndex;
+	std::vector<float> colorCoords;
+	std::vector<unsigned char> colorBGRA;
+
+	void makeSynthetic(unsigned int seed) {
+		srand(seed);
+		const int n = DEPTH_WIDTH * DEPTH_HEIGHT;
+		bodyIndex.assign(n, 255);
+		depth.resize(n);
+		colorCoords.resize(n * 2);
+		colorBGRA.resize(COLOR_WIDTH * COLOR_HEIGHT * 4);
+		for (size_t i = 0; i < colorBGRA.size(); i++) {
+			colorBGRA[i] = (unsigned char)(rand() & 0xFF);
+		}
+		for (int y = 0; y < DEPTH_HEIGHT; y++) {
+			for (int x = 0; x < DEPTH_WIDTH; x++) {
+				int i = y * DEPTH_WIDTH + x;
+				float dx0 = (x - 170) / 70.0f, dy0 = (y - 230) / 170.0f;
+				float dx1 = (x - 350) / 60.0f, dy1 = (y - 250) / 160.0f;
+				if (dx0 * dx0 + dy0 * dy0 < 1.0f) bodyIndex[i] = 0;
+				else if (dx1 * dx1 + dy1 * dy1 < 1.0f) bodyIndex[i] = 5;
+				else if (x < 8) bodyIndex[i] = 6; // just past the last body id
+				depth[i] = (unsigned short)(rand() % 50 == 0 ? 0 : 400 + (x * 31 + y * 17) % 8000 + rand() % 5);
+				if (rand() % 20 == 0) {
+					colorCoords[i * 2] = -std::numeric_limits<float>::infinity();
+					colorCoords[i * 2 + 1] = -std::numeric_limits<float>::infinity();
+				}
+				else {
+					colorCoords[i * 2] = x * 3.9f - 40.0f + (rand() % 100) / 100.0f;
+					colorCoords[i * 2 + 1] = y * 2.6f - 15.0f + (rand() % 100) / 100.0f;
+				}
+			}
+		}
+	}
+};
+
+//--------------------------------------------------------------
+static bool createContext() {
+	EGLDisplay display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+		printf("no EGL display\n");
+		return false;
+	}
+
+	// no surface is ever drawn to, so no config needed where EGL_KHR_no_config_context is there
+	// (Mesa's surfaceless platform has no desktop GL configs at all)
+	EGLConfig config = EGL_NO_CONFIG_KHR;
+	const char * extensions = eglQueryString(display, EGL_EXTENSIONS);
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		printf("no desktop GL\n");
+		return false;
+	}
+	if (!extensions || !strstr(extensions, "EGL_KHR_no_config_context")) {
+		const EGLint attributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		EGLint configs = 0;
+		if (!eglChooseConfig(display, attributes, &config, 1, &configs) || configs == 0) {
+			printf("no desktop GL config\n");
+			return false;
+		}
+	}
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		printf("could not create a surfaceless GL context\n");
+		return false;
+	}
+	printf("GL %s, %s\n", (const char *)glGetString(GL_VERSION), (const char *)glGetString(GL_RENDERER));
+	return true;
+}
+
+static GLuint compile(GLenum type, const char * source) {
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, nullptr);
+	glCompileShader(shader);
+	GLint ok = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+	if (!ok) {
+		char log[2048];
+		glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		printf("shader compile failed:\n%s\n", log);
+		return 0;
+	}
+	return shader;
+}
+
+static GLuint link(const char * fragment) {
+	GLuint vs = compile(GL_VERTEX_SHADER, keyingShaderVertex);
+	GLuint fs = compile(GL_FRAGMENT_SHADER, fragment);
+	if (!vs || !fs) return 0;
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vs);
+	glAttachShader(program, fs);
+	glLinkProgram(program);
+	GLint ok = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &ok);
+	if (!ok) {
+		char log[2048];
+		glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+		printf("shader link failed:\n%s\n", log);
+		return 0;
+	}
+	return program;
+}
+
+// rectangle texture, nearest, like the app's after setTextureMinMagFilter(GL_NEAREST, GL_NEAREST)
+static GLuint texture(GLenum internalFormat, int width, int height, GLenum format, GLenum type, const void * data) {
+	GLuint tex;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_RECTANGLE, tex);
+	glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_RECTANGLE, 0, internalFormat, width, height, 0, format, type, data);
+	return tex;
+}
+
+static void bind(GLuint program, const char * name, int unit, GLuint tex) {
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_RECTANGLE, tex);
+	glUniform1i(glGetUniformLocation(program, name), unit);
+}
+
+// one quad over the depth frame, row y of the readback is depth row y
+static void drawFrame(std::vector<unsigned char> & out) {
+	glViewport(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glBegin(GL_QUADS);
+	glTexCoord2f(0, 0);
+	glVertex2f(-1, -1);
+	glTexCoord2f(DEPTH_WIDTH, 0);
+	glVertex2f(1, -1);
+	glTexCoord2f(DEPTH_WIDTH, DEPTH_HEIGHT);
+	glVertex2f(1, 1);
+	glTexCoord2f(0, DEPTH_HEIGHT);
+	glVertex2f(-1, 1);
+	glEnd();
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, out.data());
+}
+
+static bool compare(const char * name, const std::vector<unsigned char> & gpu, const std::vector<unsigned char> & cpu) {
+	int mismatches = 0, first = -1;
+	for (size_t i = 0; i < gpu.size(); i += 4) {
+		if (memcmp(&gpu[i], &cpu[i], 4) == 0) continue;
+		if (first < 0) first = (int)i / 4;
+		mismatches++;
+	}
+	if (mismatches == 0) {
+		printf("  %-6s ok\n", name);
+		return true;
+	}
+	printf("  %-6s %d of %d pixels differ, first at %d,%d: gpu %d %d %d %d cpu %d %d %d %d\n", name, mismatches,
+		(int)gpu.size() / 4, first % DEPTH_WIDTH, first / DEPTH_WIDTH,
+		gpu[first * 4], gpu[first * 4 + 1], gpu[first * 4 + 2], gpu[first * 4 + 3],
+		cpu[first * 4], cpu[first * 4 + 1], cpu[first * 4 + 2], cpu[first * 4 + 3]);
+	return false;
+}
+
+//--------------------------------------------------------------
+int main() {
+	if (!createContext()) return 1;
+	GLuint keyed = link(keyingShaderKeyed);
+	GLuint depth = link(keyingShaderDepth);
+	if (!keyed || !depth) return 1;
+
+	GLuint fbo, target;
+	glGenFramebuffers(1, &fbo);
+	glGenRenderbuffers(1, &target);
+	glBindRenderbuffer(GL_RENDERBUFFER, target);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, DEPTH_WIDTH, DEPTH_HEIGHT);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		printf("fbo incomplete\n");
+		return 1;
+	}
+
+	const int pixels = DEPTH_WIDTH * DEPTH_HEIGHT;
+	std::vector<unsigned char> gpu(pixels * 4), cpu(pixels * 4);
+	const int ramps[][2] = { { 500, 4500 }, { 2100, 3400 }, { 0, 65535 }, { 3000, 3000 } };
+	bool ok = true;
+	for (unsigned int seed = 1; seed <= 3; seed++) {
+		CheckFrame frame;
+		frame.makeSynthetic(seed);
+		printf("frame %u\n", seed);
+
+		GLuint bodyIndexTex = texture(GL_R8, DEPTH_WIDTH, DEPTH_HEIGHT, GL_RED, GL_UNSIGNED_BYTE, frame.bodyIndex.data());
+		GLuint coordTex = texture(GL_RG32F, DEPTH_WIDTH, DEPTH_HEIGHT, GL_RG, GL_FLOAT, frame.colorCoords.data());
+		GLuint colorTex = texture(GL_RGBA8, COLOR_WIDTH, COLOR_HEIGHT, GL_BGRA, GL_UNSIGNED_BYTE, frame.colorBGRA.data());
+		GLuint depthTex = texture(GL_R16, DEPTH_WIDTH, DEPTH_HEIGHT, GL_RED, GL_UNSIGNED_SHORT, frame.depth.data());
+
+		glUseProgram(keyed);
+		bind(keyed, "bodyIndex", 1, bodyIndexTex);
+		bind(keyed, "colorCoords", 2, coordTex);
+		bind(keyed, "color", 3, colorTex);
+		glUniform2f(glGetUniformLocation(keyed, "colorSize"), (float)COLOR_WIDTH, (float)COLOR_HEIGHT);
+		glUniform1f(glGetUniformLocation(keyed, "maxBodies"), (float)KEYING_MAX_BODIES);
+		drawFrame(gpu);
+
+		KeyingFrame kf;
+		kf.bodyIndex = frame.bodyIndex.data();
+		kf.colorCoords = frame.colorCoords.data();
+		kf.colorBGRA = frame.colorBGRA.data();
+		kf.outRGBA = cpu.data();
+		kf.depthWidth = DEPTH_WIDTH;
+		kf.depthHeight = DEPTH_HEIGHT;
+		kf.colorWidth = COLOR_WIDTH;
+		kf.colorHeight = COLOR_HEIGHT;
+		keyBodies(kf, KEYING_SCALAR);
+		ok = compare("keyed", gpu, cpu) && ok;
+
+		glUseProgram(depth);
+		bind(depth, "depth", 1, depthTex);
+		for (const int * ramp : ramps) {
+			DepthRamp params(ramp[0], ramp[1]);
+			glUniform1f(glGetUniformLocation(depth, "nearMm"), (float)params.nearMm);
+			glUniform1f(glGetUniformLocation(depth, "range"), (float)params.range);
+			glUniform1f(glGetUniformLocation(depth, "scale"), (float)params.scale);
+			drawFrame(gpu);
+			colorizeDepth(frame.depth.data(), cpu.data(), pixels, ramp[0], ramp[1], PIXEL_SCALAR);
+			char name[32];
+			snprintf(name, sizeof(name), "depth %d..%d", ramp[0], ramp[1]);
+			ok = compare(name, gpu, cpu) && ok;
+		}
+
+		GLuint textures[] = { bodyIndexTex, coordTex, colorTex, depthTex };
+		glDeleteTextures(4, textures);
+	}
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		printf("GL error 0x%x\n", error);
+		ok = false;
+	}
+	printf(ok ? "shaders match the CPU reference\n" : "SHADERS DIFFER FROM THE CPU REFERENCE\n");
+	return ok ? 0 : 1;
+}
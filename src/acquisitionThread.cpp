@@ -0,0 +1,43 @@
+#include "acquisitionThread.h"
+
+//--------------------------------------------------------------
+AcquisitionThread::AcquisitionThread()
+	: source(nullptr)
+	, bQuit(false)
+	, bRunning(false)
+	, arrivalMicros(0)
+	, updateMicros(0) {
+}
+
+AcquisitionThread::~AcquisitionThread() {
+	stop();
+}
+
+//--------------------------------------------------------------
+void AcquisitionThread::start(FrameSource * source_, const std::function<void(bool)> & process_) {
+	stop();
+	source = source_;
+	process = process_;
+	bQuit = false;
+	thread = std::thread(&AcquisitionThread::threadLoop, this);
+	bRunning = true;
+}
+
+void AcquisitionThread::stop() {
+	if (!bRunning) return;
+	bQuit = true;
+	thread.join();
+	bRunning = false;
+}
+
+//--------------------------------------------------------------
+void AcquisitionThread::threadLoop() {
+	while (!bQuit) {
+		bool bArrived = source->waitForFrame(ACQUISITION_WAIT_MILLIS);
+		arrivalMicros = frameSourceMicros();
+		StageTimers::Clock::time_point start = StageTimers::Clock::now();
+		bool bFrameNew = bArrived && source->update();
+		updateMicros = StageTimers::microsSince(start);
+		process(bFrameNew);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "frameSource.h"
+#include "stageTimers.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+// Runs a FrameSource on its own thread, driven by frame arrival (FrameSource::waitForFrame)
+// instead of the render loop. process() is called on this thread after every wait, with
+// bFrameNew when update() delivered a frame, and does the app's per frame cpu work (see
+// ofApp::processFrame). The frame's pointers are only valid inside process().
+// process() also runs without a frame every ACQUISITION_WAIT_MILLIS at most, so settings
+// changes still get picked up while the camera is unplugged.
+
+#define ACQUISITION_WAIT_MILLIS 50
+
+class AcquisitionThread {
+public:
+	AcquisitionThread();
+	~AcquisitionThread();
+
+	void start(FrameSource * source, const std::function<void(bool bFrameNew)> & process);
+	void stop();
+	bool isRunning() const { return bRunning; }
+
+	// acquisition thread: frameSourceMicros() when waitForFrame() returned, i.e. frame arrival,
+	// and how long FrameSource::update() took
+	long long getArrivalMicros() const { return arrivalMicros; }
+	float getUpdateMicros() const { return updateMicros; }
+
+private:
+	void threadLoop();
+
+	FrameSource * source;
+	std::function<void(bool)> process;
+	std::thread thread;
+	std::atomic<bool> bQuit;
+	bool bRunning;
+
+	long long arrivalMicros;
+	float updateMicros;
+};
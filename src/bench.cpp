@@ -0,0 +1,1035 @@
+#include "bench.h"
+#include "acquisitionThread.h"
+#include "bodyJson.h"
+#include "captureFormat.h"
+#include "frameReplay.h"
+#include "keying.h"
+#include "pixelKernels.h"
+#include "skeletonFeatures.h"
+#include "skeletonFilter.h"
+#include "skeletonStore.h"
+#include "spscQueue.h"
+#include "stageTimers.h"
+#include "tripleBuffer.h"
+#include "workerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <limits>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One Kinect frame, either synthetic: two "bodies" (ellipses) over background, a color plane of noise,
+// a noisy depth ramp and a depth -> color mapping roughly like the real one, with some invalid (-inf)
+// points, or copied from a recording.
+struct BenchFrame {
+	std::vector<unsigned short> depth;
+	std::vector<unsigned char> bodyIndex;
+	std::vector<float> colorCoords;
+	std::vector<unsigned char> colorBGRA;
+	BodySample bodies[BODY_COUNT_MAX];
+
+	void makeSynthetic(unsigned int seed) {
+		srand(seed);
+		const int n = DEPTH_WIDTH * DEPTH_HEIGHT;
+		bodyIndex.assign(n, 255);
+		depth.resize(n);
+		colorCoords.resize(n * 2);
+		colorBGRA.resize(COLOR_WIDTH * COLOR_HEIGHT * 4);
+
+		for (size_t i = 0; i < colorBGRA.size(); i++) {
+			colorBGRA[i] = (unsigned char)(rand() & 0xFF);
+		}
+
+		for (int y = 0; y < DEPTH_HEIGHT; y++) {
+			for (int x = 0; x < DEPTH_WIDTH; x++) {
+				int i = y * DEPTH_WIDTH + x;
+
+				float dx0 = (x - 170) / 70.0f, dy0 = (y - 230) / 170.0f;
+				float dx1 = (x - 350) / 60.0f, dy1 = (y - 250) / 160.0f;
+				if (dx0 * dx0 + dy0 * dy0 < 1.0f) bodyIndex[i] = 0;
+				else if (dx1 * dx1 + dy1 * dy1 < 1.0f) bodyIndex[i] = 3;
+				depth[i] = (unsigned short)((bodyIndex[i] == 255 ? 3500 - y * 2 : 2000 + x / 8) + rand() % 5);
+				if (rand() % 50 == 0) depth[i] = 0; // no reading
+
+				if (rand() % 20 == 0) {
+					colorCoords[i * 2] = -std::numeric_limits<float>::infinity();
+					colorCoords[i * 2 + 1] = -std::numeric_limits<float>::infinity();
+				}
+				else {
+					// slightly wider than the color frame so the edges fall out of bounds
+					colorCoords[i * 2] = x * 3.9f - 40.0f + (rand() % 100) / 100.0f;
+					colorCoords[i * 2 + 1] = y * 2.6f - 15.0f + (rand() % 100) / 100.0f;
+				}
+			}
+		}
+
+		// the two ellipses are tracked, joints scattered around them
+		memset(bodies, 0, sizeof(bodies));
+		for (int b = 0; b < BODY_COUNT_MAX; b++) {
+			BodySample & body = bodies[b];
+			body.bodyId = b;
+			body.tracked = b == 0 || b == 3;
+			if (!body.tracked) continue;
+			body.trackingId = 72057594037927936ull + rand();
+			body.leftHandState = rand() % 5;
+			body.rightHandState = rand() % 5;
+			for (int j = 0; j < JOINT_COUNT; j++) {
+				JointSample & joint = body.joints[j];
+				joint.position[0] = (b == 0 ? -0.4f : 0.3f) + (rand() % 1000 - 500) / 1250.0f;
+				joint.position[1] = (rand() % 2000 - 1000) / 1100.0f;
+				joint.position[2] = 2.0f + (rand() % 1000) / 3000.0f;
+				joint.trackingState = JOINT_TRACKED;
+			}
+		}
+	}
+
+	void copyFrom(const KinectFrame & frame) {
+		depth.assign(frame.depth, frame.depth + DEPTH_SIZE);
+		bodyIndex.assign(frame.bodyIndex, frame.bodyIndex + DEPTH_SIZE);
+		colorCoords.assign(frame.colorCoords, frame.colorCoords + DEPTH_SIZE * 2);
+		colorBGRA.assign(frame.colorBGRA, frame.colorBGRA + COLOR_WIDTH * COLOR_HEIGHT * 4);
+		memcpy(bodies, frame.bodies, sizeof(bodies));
+	}
+};
+
+unsigned long long (*benchHeapAllocations)() = nullptr;
+
+static unsigned long long heapAllocations() {
+	return benchHeapAllocations ? benchHeapAllocations() : 0;
+}
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+static double elapsedMs(BenchClock::time_point start) {
+	return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+// Metrics of this run for the baseline file / regression check. Every metric is a cost (time or
+// allocations), lower is better. Only reported after the timed loops, report() allocates.
+struct BenchResult {
+	std::string name;
+	double value;
+	bool bAllocations; // compared exactly, times get the tolerance
+};
+static std::vector<BenchResult> results;
+
+static void report(const std::string & name, double value, bool bAllocations = false) {
+	if (bAllocations && !benchHeapAllocations) return; // not counted, a 0 would pass any baseline
+	BenchResult result;
+	result.name = name;
+	result.value = value;
+	result.bAllocations = bAllocations;
+	results.push_back(result);
+}
+
+//--------------------------------------------------------------
+static bool benchKeying(const BenchFrame & frame, int frames) {
+	const int pixels = DEPTH_WIDTH * DEPTH_HEIGHT;
+	std::vector<unsigned char> reference(pixels * 4);
+	std::vector<unsigned char> out(pixels * 4);
+
+	KeyingFrame kf;
+	kf.bodyIndex = frame.bodyIndex.data();
+	kf.colorCoords = frame.colorCoords.data();
+	kf.colorBGRA = frame.colorBGRA.data();
+	kf.depthWidth = DEPTH_WIDTH;
+	kf.depthHeight = DEPTH_HEIGHT;
+	kf.colorWidth = COLOR_WIDTH;
+	kf.colorHeight = COLOR_HEIGHT;
+
+	kf.outRGBA = reference.data();
+	keyBodiesScalar(kf, 0, DEPTH_HEIGHT);
+
+	bool ok = true;
+	const KeyingPath paths[] = { KEYING_SCALAR, KEYING_SSE2, KEYING_AVX2 };
+	printf("keying (%dx%d depth -> %dx%d color)\n", DEPTH_WIDTH, DEPTH_HEIGHT, COLOR_WIDTH, COLOR_HEIGHT);
+	for (KeyingPath path : paths) {
+		if (!keyingPathSupported(path)) {
+			printf("  %-8s not supported on this cpu\n", keyingPathName(path));
+			continue;
+		}
+
+		kf.outRGBA = out.data();
+		memset(out.data(), 0xCD, out.size());
+		keyBodies(kf, path); // warm up + correctness
+		bool match = memcmp(out.data(), reference.data(), out.size()) == 0;
+		ok = ok && match;
+
+		BenchClock::time_point start = BenchClock::now();
+		for (int i = 0; i < frames; i++) {
+			keyBodies(kf, path);
+		}
+		double ms = elapsedMs(start) / frames;
+
+		printf("  %-8s %8.3f ms/frame %8.2f ns/pixel %9.1f fps  %s\n", keyingPathName(path), ms,
+			ms * 1e6 / pixels, 1000.0 / ms, match ? "ok" : "MISMATCH vs scalar");
+		report(std::string("keying.") + keyingPathName(path) + ".ns_per_pixel", ms * 1e6 / pixels);
+	}
+	return ok;
+}
+
+//--------------------------------------------------------------
+// Row tiled keying on the WorkerPool, 1 .. maxThreads, cycling through a set of frames
+static bool benchKeyingThreads(const std::vector<BenchFrame> & frameSet, int frames, int maxThreads) {
+	const int pixels = DEPTH_WIDTH * DEPTH_HEIGHT;
+	std::vector<unsigned char> reference(pixels * 4);
+	std::vector<unsigned char> out(pixels * 4);
+
+	std::vector<KeyingFrame> keyingFrames(frameSet.size());
+	for (size_t i = 0; i < frameSet.size(); i++) {
+		KeyingFrame & kf = keyingFrames[i];
+		kf.bodyIndex = frameSet[i].bodyIndex.data();
+		kf.colorCoords = frameSet[i].colorCoords.data();
+		kf.colorBGRA = frameSet[i].colorBGRA.data();
+		kf.outRGBA = out.data();
+		kf.depthWidth = DEPTH_WIDTH;
+		kf.depthHeight = DEPTH_HEIGHT;
+		kf.colorWidth = COLOR_WIDTH;
+		kf.colorHeight = COLOR_HEIGHT;
+	}
+
+	bool ok = true;
+	double singleMs = 0;
+	WorkerPool pool;
+	printf("keying on worker pool (%s, %d row tiles, %d frame set)\n", keyingPathName(KEYING_AUTO), KEYING_TILE_ROWS, (int)frameSet.size());
+	for (int threads = 1; threads <= maxThreads; threads++) {
+		pool.setup(threads);
+
+		// tiles must give the same result as one pass
+		KeyingFrame check = keyingFrames[0];
+		check.outRGBA = reference.data();
+		keyBodies(check);
+		keyBodiesParallel(keyingFrames[0], pool);
+		bool match = memcmp(out.data(), reference.data(), out.size()) == 0;
+		ok = ok && match;
+
+		BenchClock::time_point start = BenchClock::now();
+		for (int i = 0; i < frames; i++) {
+			keyBodiesParallel(keyingFrames[i % keyingFrames.size()], pool);
+		}
+		double ms = elapsedMs(start) / frames;
+		if (threads == 1) singleMs = ms;
+
+		printf("  %2d threads %8.3f ms/frame %9.1f fps  x%.2f  %s\n", threads, ms, 1000.0 / ms,
+			singleMs / ms, match ? "ok" : "MISMATCH vs single pass");
+		report("keying.pool" + std::to_string(threads) + ".ms_per_frame", ms);
+	}
+	return ok;
+}
+
+//--------------------------------------------------------------
+// Per pixel kernels (pixelKernels.h) on every path: cutout mask, BGRA -> RGBA of the color plane,
+// depth colorization, infrared normalization (linear and with a gamma curve), RGBA -> UYVY / UYVA.
+// The check runs a few pixels short of the plane so the scalar tails are hit too.
+static bool benchPixelKernels(const BenchFrame & frame, int frames) {
+	const int depthPixels = DEPTH_WIDTH * DEPTH_HEIGHT;
+	const int colorPixels = COLOR_WIDTH * COLOR_HEIGHT;
+	std::vector<unsigned char> reference(colorPixels * 4);
+	std::vector<unsigned char> out(colorPixels * 4);
+
+	// infrared: bright bodies on a dim background, a few saturated pixels
+	std::vector<unsigned short> infrared(depthPixels);
+	for (int i = 0; i < depthPixels; i++) {
+		infrared[i] = (unsigned short)(frame.bodyIndex[i] != 255 ? 6000 + rand() % 4000 : 300 + rand() % 1500);
+		if (rand() % 500 == 0) infrared[i] = 65535;
+	}
+	InfraredLevels linear, gamma;
+	int black, white;
+	infraredPercentiles(infrared.data(), depthPixels, 1, 99.5f, black, white);
+	linear.setWindow(black, white);
+	gamma.setWindow(black, white);
+	gamma.setGamma(2.2f);
+
+	struct Kernel {
+		const char * name;
+		int pixels;
+	};
+	const Kernel kernels[] = {
+		{ "mask", depthPixels },
+		{ "swizzle", colorPixels },
+		{ "colorize", depthPixels },
+		{ "ir", depthPixels },
+		{ "irGamma", depthPixels },
+		{ "uyvy", colorPixels },
+		{ "uyva", depthPixels },
+		{ "bgraUyvy", colorPixels }
+	};
+	auto run = [&](int kernel, int count, unsigned char * dst, PixelPath path) {
+		switch (kernel) {
+		case 0:
+			bodyIndexMask(frame.bodyIndex.data(), dst, count, path);
+			break;
+		case 1:
+			swizzleRB(frame.colorBGRA.data(), dst, count, path);
+			break;
+		case 2:
+			colorizeDepth(frame.depth.data(), dst, count, 2100, 3400, path); // both clamps get hit
+			break;
+		case 3:
+			normalizeInfrared(infrared.data(), dst, count, linear, path);
+			break;
+		case 4:
+			normalizeInfrared(infrared.data(), dst, count, gamma, path);
+			break;
+		case 5:
+			rgbaToUyvy(frame.colorBGRA.data(), dst, count & ~1, YUV_BT709, path); // pairs only
+			break;
+		case 6:
+			rgbaToUyva(frame.colorBGRA.data(), dst, dst + depthPixels * 2, count & ~1, YUV_BT601, path);
+			break;
+		default:
+			bgraToUyvy(frame.colorBGRA.data(), dst, count & ~1, YUV_BT709, path);
+			break;
+		}
+	};
+
+	bool ok = true;
+	const PixelPath paths[] = { PIXEL_SCALAR, PIXEL_SSE2 };
+	printf("pixel kernels (cutout mask, BGRA -> RGBA, depth colorize, infrared %d..%d)\n", black, white);
+	for (int k = 0; k < 8; k++) {
+		const Kernel & kernel = kernels[k];
+		memset(reference.data(), 0xCD, reference.size());
+		run(k, kernel.pixels - 3, reference.data(), PIXEL_SCALAR);
+
+		for (PixelPath path : paths) {
+			if (!pixelPathSupported(path)) {
+				printf("  %-8s %-6s not supported on this cpu\n", kernel.name, pixelPathName(path));
+				continue;
+			}
+
+			memset(out.data(), 0xCD, out.size());
+			run(k, kernel.pixels - 3, out.data(), path);
+			bool match = memcmp(out.data(), reference.data(), out.size()) == 0;
+
+			unsigned long long allocations = heapAllocations();
+			BenchClock::time_point start = BenchClock::now();
+			for (int i = 0; i < frames; i++) {
+				run(k, kernel.pixels, out.data(), path);
+			}
+			double ms = elapsedMs(start) / frames;
+			double perFrame = double(heapAllocations() - allocations) / frames;
+			ok = ok && match && perFrame == 0;
+
+			printf("  %-8s %-6s %8.3f ms/frame %8.2f ns/pixel %9.1f fps %4.1f allocations/frame  %s\n", kernel.name,
+				pixelPathName(path), ms, ms * 1e6 / kernel.pixels, 1000.0 / ms, perFrame, match ? "ok" : "MISMATCH vs scalar");
+			std::string name = std::string("pixels.") + kernel.name + "." + pixelPathName(path);
+			report(name + ".ns_per_pixel", ms * 1e6 / kernel.pixels);
+			report(name + ".allocations_per_frame", perFrame, true);
+		}
+	}
+
+	// BGRA straight in == swizzled first
+	std::vector<unsigned char> swizzled(colorPixels * 4);
+	swizzleRB(frame.colorBGRA.data(), swizzled.data(), colorPixels, PIXEL_SCALAR);
+	rgbaToUyvy(swizzled.data(), reference.data(), colorPixels, YUV_BT709, PIXEL_SCALAR);
+	bgraToUyvy(frame.colorBGRA.data(), out.data(), colorPixels, YUV_BT709);
+	bool bgraMatch = memcmp(out.data(), reference.data(), colorPixels * 2) == 0;
+	if (!bgraMatch) printf("  bgraUyvy differs from swizzle + rgbaToUyvy\n");
+	ok = ok && bgraMatch;
+
+	// video levels: white and black pairs, both matrices
+	const unsigned char whiteBlack[16] = { 255, 255, 255, 255, 255, 255, 255, 255, 0, 0, 0, 255, 0, 0, 0, 255 };
+	const unsigned char expected[8] = { 128, 235, 128, 235, 128, 16, 128, 16 };
+	for (YuvMatrix matrix : { YUV_BT601, YUV_BT709 }) {
+		unsigned char uyvy[8];
+		rgbaToUyvy(whiteBlack, uyvy, 4, matrix, PIXEL_SCALAR);
+		bool levels = memcmp(uyvy, expected, 8) == 0;
+		if (!levels) printf("  uyvy %s white / black levels wrong\n", matrix == YUV_BT601 ? "BT.601" : "BT.709");
+		ok = ok && levels;
+	}
+	return ok;
+}
+
+//--------------------------------------------------------------
+// NDI depth encodings (pixelKernels.h) on every path, against scalar, plus what a receiver decodes:
+// rg16 gives the millimetres back exactly, window8 to within one level of the window
+static bool benchDepthEncoding(const BenchFrame & frame, int frames) {
+	const int pixels = DEPTH_WIDTH * DEPTH_HEIGHT;
+	const int nearMm = 2100, farMm = 3400; // both clamps get hit
+	std::vector<unsigned char> reference(pixels * 2);
+	std::vector<unsigned char> out(pixels * 2);
+	const DepthEncoding encodings[] = { DEPTH_ENCODING_RG16, DEPTH_ENCODING_WINDOW8, DEPTH_ENCODING_FALSE_COLOR };
+	const PixelPath paths[] = { PIXEL_SCALAR, PIXEL_SSE2 };
+
+	bool ok = true;
+	printf("depth encodings (2 bytes per pixel)\n");
+	for (DepthEncoding encoding : encodings) {
+		memset(reference.data(), 0xCD, reference.size());
+		encodeDepth(encoding, frame.depth.data(), reference.data(), pixels - 4, nearMm, farMm, PIXEL_SCALAR);
+
+		// receiver side
+		int decodeErrors = 0;
+		DepthRamp ramp(nearMm, farMm);
+		for (int i = 0; i < pixels - 4; i++) {
+			int d = frame.depth[i];
+			if (encoding == DEPTH_ENCODING_RG16) {
+				if (reference[i * 2] + 256 * reference[i * 2 + 1] != d) decodeErrors++;
+			}
+			else if (encoding == DEPTH_ENCODING_WINDOW8) {
+				int decoded = decodeDepthWindow8(reference[i * 2 + 1], nearMm, farMm);
+				int clamped = std::min(std::max(d, (int)ramp.nearMm), (int)(ramp.nearMm + ramp.range));
+				if (d == 0 ? decoded != 0 : std::abs(decoded - clamped) > (int)ramp.range / 255 + 1) decodeErrors++;
+			}
+		}
+
+		for (PixelPath path : paths) {
+			if (!pixelPathSupported(path)) continue;
+			memset(out.data(), 0xCD, out.size());
+			encodeDepth(encoding, frame.depth.data(), out.data(), pixels - 4, nearMm, farMm, path);
+			bool match = memcmp(out.data(), reference.data(), out.size()) == 0;
+
+			unsigned long long allocations = heapAllocations();
+			BenchClock::time_point start = BenchClock::now();
+			for (int i = 0; i < frames; i++) {
+				encodeDepth(encoding, frame.depth.data(), out.data(), pixels, nearMm, farMm, path);
+			}
+			double ms = elapsedMs(start) / frames;
+			double perFrame = double(heapAllocations() - allocations) / frames;
+			ok = ok && match && perFrame == 0 && decodeErrors == 0;
+
+			printf("  %-10s %-6s %8.3f ms/frame %8.2f ns/pixel %4.1f allocations/frame  %s", depthEncodingName(encoding),
+				pixelPathName(path), ms, ms * 1e6 / pixels, perFrame, match ? "ok" : "MISMATCH vs scalar");
+			if (decodeErrors) printf(", %d pixels decode wrong", decodeErrors);
+			printf("\n");
+			std::string name = std::string("depthEncoding.") + depthEncodingName(encoding) + "." + pixelPathName(path);
+			report(name + ".ns_per_pixel", ms * 1e6 / pixels);
+			report(name + ".allocations_per_frame", perFrame, true);
+		}
+	}
+	return ok;
+}
+
+//--------------------------------------------------------------
+// kv2rec encode / decode with the compression presets, checks the round trip
+static bool benchCapture(const BenchFrame & bench, int frames) {
+	KinectFrame frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.depth = bench.depth.data();
+	frame.bodyIndex = bench.bodyIndex.data();
+	frame.colorBGRA = bench.colorBGRA.data();
+	frame.colorCoords = bench.colorCoords.data();
+	frame.bodies[0].tracked = 1;
+
+	struct Preset {
+		const char * name;
+		unsigned int mask;
+	};
+	const Preset presets[] = {
+		{ "raw", CAPTURE_COMPRESS_NONE },
+		{ "depth", CAPTURE_COMPRESS_DEPTH },
+		{ "all", CAPTURE_COMPRESS_ALL }
+	};
+
+	bool ok = true;
+	CaptureEncoder encoder;
+	CaptureDecoder decoder;
+	std::vector<unsigned char> encoded;
+	frames = frames / 10 > 0 ? frames / 10 : 1; // the color plane makes this slow
+	printf("capture (kv2rec delta + lz4)\n");
+	for (const Preset & preset : presets) {
+		BenchClock::time_point start = BenchClock::now();
+		for (int i = 0; i < frames; i++) {
+			encoder.encodeFrame(frame, preset.mask, encoded);
+		}
+		double encodeMs = elapsedMs(start) / frames;
+
+		KinectFrame decoded;
+		start = BenchClock::now();
+		bool match = true;
+		for (int i = 0; i < frames; i++) {
+			match = decoder.decodeFrame(encoded.data(), encoded.size(), decoded) && match;
+		}
+		double decodeMs = elapsedMs(start) / frames;
+
+		match = match && memcmp(decoded.depth, frame.depth, captureStreamSize(CAPTURE_STREAM_DEPTH)) == 0
+			&& decoded.infrared == nullptr
+			&& memcmp(decoded.bodyIndex, frame.bodyIndex, captureStreamSize(CAPTURE_STREAM_BODY_INDEX)) == 0
+			&& memcmp(decoded.colorBGRA, frame.colorBGRA, captureStreamSize(CAPTURE_STREAM_COLOR)) == 0
+			&& memcmp(decoded.colorCoords, frame.colorCoords, captureStreamSize(CAPTURE_STREAM_COLOR_COORDS)) == 0
+			&& memcmp(decoded.bodies, frame.bodies, sizeof(frame.bodies)) == 0;
+		ok = ok && match;
+
+		CaptureFrameHeader header;
+		memcpy(&header, encoded.data(), sizeof(header));
+		printf("  %-6s encode %8.3f ms decode %8.3f ms %8.2f MB/frame %7.1f MB/s at 30fps  %s\n", preset.name,
+			encodeMs, decodeMs, encoded.size() / 1e6, encoded.size() * 30 / 1e6, match ? "ok" : "MISMATCH after round trip");
+		report(std::string("capture.") + preset.name + ".encode_ms", encodeMs);
+		if (preset.mask != CAPTURE_COMPRESS_NONE) { // raw decode only points into the buffer
+			report(std::string("capture.") + preset.name + ".decode_ms", decodeMs);
+		}
+		for (int s = 0; s < CAPTURE_STREAM_COUNT; s++) {
+			const CaptureChunk & chunk = header.chunks[s];
+			if (chunk.rawSize == 0) continue;
+			printf("           %-13s %9u -> %9u bytes (%5.1f%%)\n", captureStreamName(s), chunk.rawSize,
+				chunk.storedSize, 100.0 * chunk.storedSize / chunk.rawSize);
+		}
+	}
+	return ok;
+}
+
+//--------------------------------------------------------------
+// NDI frame handoff queue: a producer pushing as fast as it can with drop oldest against a consumer
+// thread, every item has to come out exactly once (popped or evicted) and in order
+static bool benchSpscQueue(int items) {
+	SpscQueue<int> queue(4);
+	std::atomic<bool> bDone(false);
+	std::vector<int> popped;
+	popped.reserve(items);
+
+	BenchClock::time_point start = BenchClock::now();
+	std::thread consumer([&] {
+		int item;
+		while (true) {
+			if (queue.pop(item)) popped.push_back(item);
+			else if (bDone) break;
+		}
+		while (queue.pop(item)) popped.push_back(item);
+	});
+
+	std::vector<int> evicted;
+	evicted.reserve(items);
+	for (int i = 0; i < items; i++) {
+		int oldest;
+		if (queue.pushDropOldest(i, oldest)) evicted.push_back(oldest);
+	}
+	bDone = true;
+	consumer.join();
+	double ms = elapsedMs(start);
+
+	bool ok = popped.size() + evicted.size() == (size_t)items;
+	for (size_t i = 1; ok && i < popped.size(); i++) ok = popped[i] > popped[i - 1];
+	for (size_t i = 1; ok && i < evicted.size(); i++) ok = evicted[i] > evicted[i - 1];
+
+	printf("spsc queue (drop oldest, capacity %d)\n", (int)queue.capacity());
+	printf("  %d items %8.2f Mitems/s  %d popped %d dropped  %s\n", items, items / ms / 1000.0,
+		(int)popped.size(), (int)evicted.size(), ok ? "ok" : "LOST / REORDERED ITEMS");
+	return ok;
+}
+
+//--------------------------------------------------------------
+// The string concatenation body2JSON() used before BodyJsonWriter, kept as the reference output
+static std::string bodyJsonReference(const BodySample & body, const char * const names[JOINT_COUNT]) {
+	using std::string;
+	using std::to_string;
+	string bdata = "";
+	string newData = "";
+	for (int j = 0; body.tracked && j < JOINT_COUNT; j++) {
+		const float * pos = body.joints[j].position;
+		string name = names[j];
+		newData = "\"j\":";
+		newData = newData + "\"" + name + "\",";
+		newData = newData + "\"x\":" + to_string(pos[0]) + ",";
+		newData = newData + "\"y\":" + to_string(pos[1]) + ",";
+		newData = newData + "\"z\":" + to_string(pos[2]);
+		newData = "{" + newData + "}";
+		if (bdata == "") bdata = newData;
+		else bdata = bdata + "," + newData;
+	}
+	newData = "{\"LH-st8\":" + to_string(body.leftHandState) + "}";
+	bdata = body.tracked ? newData + "," + bdata : newData;
+	bdata = "{\"RH-st8\":" + to_string(body.rightHandState) + "}," + bdata;
+	bdata = "{\"ID\":" + to_string(body.trackingId) + "}," + bdata;
+	bdata = "{\"tracked\":" + to_string(body.tracked) + "}," + bdata;
+
+	string escaped;
+	for (char c : bdata) {
+		if (c == '"' || c == '\\') escaped += '\\';
+		escaped += c;
+	}
+	return "{\"b" + to_string(body.bodyId) + "\": \"[" + escaped + "]\"}";
+}
+
+// OSC JSON of every body: BodyJsonWriter against the old string building, output has to be identical.
+// The float formatter is also checked against printf on edge cases and random bit patterns.
+static bool benchBodyJson(const std::vector<BenchFrame> & frameSet, int frames) {
+	bool floatsMatch = true;
+	char fast[BODY_JSON_FLOAT_MAX], slow[BODY_JSON_FLOAT_MAX];
+	const float edgeCases[] = { 0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 0.0078125f, -0.0078125f, 0.0000005f, 0.00000049f,
+		-0.0000001f, 1.9999999f, 999999.9f, 1099511627776.0f, 3.4e38f, 1e-45f,
+		std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN() };
+	srand(42);
+	for (int i = 0; floatsMatch && i < 1000000; i++) {
+		float value;
+		if (i < (int)(sizeof(edgeCases) / sizeof(edgeCases[0]))) value = edgeCases[i];
+		else {
+			unsigned int bits = ((unsigned int)rand() << 16) ^ (unsigned int)rand() ^ ((unsigned int)rand() << 31);
+			memcpy(&value, &bits, sizeof(value));
+		}
+		int n = formatFloatFixed6(value, fast);
+		snprintf(slow, sizeof(slow), "%f", value);
+		floatsMatch = (int)strlen(slow) == n && memcmp(fast, slow, n) == 0;
+		if (!floatsMatch) printf("  %%f mismatch: %s vs %.*s\n", slow, n, fast);
+	}
+
+	bool match = true;
+	BodyJsonWriter writer;
+	for (const BenchFrame & frame : frameSet) {
+		for (const BodySample & body : frame.bodies) {
+			std::string reference = bodyJsonReference(body, jointNames);
+			match = match && reference == writer.write(body, jointNames)
+				&& strcmp(writer.getAddress(), ("/kV2/body/" + std::to_string(body.bodyId)).c_str()) == 0;
+		}
+	}
+
+	printf("body json (%d bodies per frame)\n", BODY_COUNT_MAX);
+	frames *= 10;
+	size_t bytes = 0;
+	unsigned long long allocations = heapAllocations();
+	BenchClock::time_point start = BenchClock::now();
+	for (int i = 0; i < frames; i++) {
+		for (const BodySample & body : frameSet[i % frameSet.size()].bodies) {
+			bytes += bodyJsonReference(body, jointNames).size();
+		}
+	}
+	double ms = elapsedMs(start) / frames;
+	double perFrame = double(heapAllocations() - allocations) / frames;
+	printf("  strings  %8.3f ms/frame %8.1f allocations/frame %6d bytes/frame\n", ms, perFrame, (int)(bytes / frames));
+	report("bodyJson.strings.ms_per_frame", ms);
+
+	bytes = 0;
+	allocations = heapAllocations();
+	start = BenchClock::now();
+	for (int i = 0; i < frames; i++) {
+		for (const BodySample & body : frameSet[i % frameSet.size()].bodies) {
+			writer.write(body, jointNames);
+			bytes += writer.getLength();
+		}
+	}
+	ms = elapsedMs(start) / frames;
+	perFrame = double(heapAllocations() - allocations) / frames;
+	printf("  writer   %8.3f ms/frame %8.1f allocations/frame %6d bytes/frame  %s%s\n", ms, perFrame, (int)(bytes / frames),
+		match ? "ok" : "MISMATCH vs strings", floatsMatch ? "" : ", %f MISMATCH");
+	report("bodyJson.writer.ms_per_frame", ms);
+	report("bodyJson.writer.allocations_per_frame", perFrame, true);
+	return match && floatsMatch && perFrame == 0;
+}
+
+//--------------------------------------------------------------
+// Skeleton history: one writer pushing as fast as it can against reader threads, every frame a
+// reader gets has to be whole (all values from the same push) and newest first
+static bool benchSkeletonHistory(int pushes, int readers) {
+	SkeletonHistory history;
+	std::atomic<bool> bDone(false);
+	std::atomic<int> torn(0), reads(0);
+
+	BenchClock::time_point start = BenchClock::now();
+	std::vector<std::thread> threads;
+	for (int r = 0; r < readers; r++) {
+		threads.push_back(std::thread([&] {
+			SkeletonFrame frame;
+			unsigned long long last = 0;
+			while (!bDone) {
+				if (!history.getLatest(frame)) continue;
+				bool bWhole = frame.frameNumber >= last && frame.timestamp == (long long)frame.frameNumber
+					&& frame.position[2][SKELETON_JOINTS - 1] == (float)(frame.frameNumber & 0xFFFF);
+				if (!bWhole) torn++;
+				last = frame.frameNumber;
+				reads++;
+			}
+		}));
+	}
+
+	SkeletonFrame frame;
+	frame.clear();
+	for (int i = 1; i <= pushes; i++) {
+		frame.frameNumber = i;
+		frame.timestamp = i;
+		for (int c = 0; c < 3; c++) {
+			for (int j = 0; j < SKELETON_JOINTS; j++) frame.position[c][j] = (float)(i & 0xFFFF);
+		}
+		history.push(frame);
+	}
+	bDone = true;
+	for (auto& t : threads) t.join();
+	double ms = elapsedMs(start);
+
+	SkeletonFrame oldest;
+	bool ok = torn == 0 && history.get(history.getCapacity() - 1, oldest)
+		&& oldest.frameNumber == (unsigned long long)(pushes - history.getCapacity() + 1)
+		&& !history.get(history.getCapacity(), oldest);
+	printf("skeleton history (%d frames, %d readers, %d bytes/frame)\n", history.getCapacity(), readers, (int)sizeof(SkeletonFrame));
+	printf("  %d pushes %8.2f Mframes/s  %d reads  %s\n", pushes, pushes / ms / 1000.0, (int)reads,
+		ok ? "ok" : "TORN / MISSING FRAMES");
+	return ok;
+}
+
+//--------------------------------------------------------------
+// Skeleton smoothing: SSE2 against the scalar reference over a sequence of bodies at 30 fps
+static bool benchSkeletonFilter(const std::vector<BenchFrame> & frameSet, int frames) {
+	struct Preset {
+		const char * name;
+		int type;
+	};
+	const Preset presets[] = {
+		{ "one euro", SKELETON_FILTER_ONE_EURO },
+		{ "double exp", SKELETON_FILTER_DOUBLE_EXP }
+	};
+
+	bool ok = true;
+	frames *= 10;
+	printf("skeleton filter (%d joints, predict 50 ms)\n", SKELETON_JOINTS);
+	for (const Preset & preset : presets) {
+		SkeletonFilterSettings settings;
+		settings.type = preset.type;
+		settings.predictMs = 50;
+		SkeletonFilter reference, filter;
+		reference.setSettings(settings);
+		reference.setSimd(false);
+		filter.setSettings(settings);
+
+		bool match = true;
+		double scalarMs = 0, simdMs = 0;
+		SkeletonFrame expected, skeleton;
+		for (int i = 0; i < frames; i++) {
+			const BenchFrame & frame = frameSet[i % frameSet.size()];
+			expected.fromBodies(frame.bodies, i, i * 33333ll);
+			skeleton = expected;
+
+			BenchClock::time_point start = BenchClock::now();
+			reference.apply(expected);
+			scalarMs += elapsedMs(start);
+			start = BenchClock::now();
+			filter.apply(skeleton);
+			simdMs += elapsedMs(start);
+
+			// same operations in the same order, only fma contraction could tell them apart
+			for (int c = 0; c < 3; c++) {
+				for (int j = 0; j < SKELETON_JOINTS; j++) {
+					float diff = expected.position[c][j] - skeleton.position[c][j];
+					match = match && diff < 1e-5f && diff > -1e-5f;
+				}
+			}
+		}
+		ok = ok && match;
+		printf("  %-10s scalar %7.2f us/frame  sse2 %7.2f us/frame  %s\n", preset.name, scalarMs * 1000 / frames,
+			simdMs * 1000 / frames, match ? "ok" : "MISMATCH vs scalar");
+		std::string name = preset.type == SKELETON_FILTER_ONE_EURO ? "oneEuro" : "doubleExp";
+		report("skeletonFilter." + name + ".us_per_frame", simdMs * 1000 / frames);
+	}
+	return ok;
+}
+
+//--------------------------------------------------------------
+// Feature pass over all bodies, plus a posed body whose angles / triggers are known
+static bool benchSkeletonFeatures(const std::vector<BenchFrame> & frameSet, int frames) {
+	FeatureEngine engine;
+	SkeletonFrame skeleton;
+	frames *= 10;
+	BenchClock::time_point start = BenchClock::now();
+	for (int i = 0; i < frames; i++) {
+		skeleton.fromBodies(frameSet[i % frameSet.size()].bodies, i, i * 33333ll);
+		engine.update(skeleton);
+	}
+	double ms = elapsedMs(start) / frames;
+
+	// straight left arm held up above the head, right hand resting on it, moving at 1 m/s in x
+	bool ok = true;
+	engine.reset();
+	skeleton.clear();
+	const float pose[JOINT_COUNT][3] = {
+		{ 0, 0, 2 }, { 0, 0.3f, 2 }, { 0, 0.6f, 2 }, { 0, 0.75f, 2 },           // spine base .. head
+		{ -0.2f, 0.55f, 2 }, { -0.2f, 0.85f, 2 }, { -0.2f, 1.1f, 2 }, { -0.2f, 1.2f, 2 }, // left arm
+		{ 0.2f, 0.55f, 2 }, { 0.1f, 0.8f, 2 }, { -0.1f, 1.0f, 2 }, { -0.15f, 1.15f, 2 }, // right arm
+		{ -0.1f, -0.05f, 2 }, { -0.1f, -0.5f, 2 }, { -0.1f, -0.9f, 2 }, { -0.1f, -0.95f, 1.9f },
+		{ 0.1f, -0.05f, 2 }, { 0.1f, -0.5f, 2 }, { 0.1f, -0.9f, 2 }, { 0.1f, -0.95f, 1.9f },
+		{ 0, 0.5f, 2 }, { -0.2f, 1.25f, 2 }, { -0.18f, 1.2f, 2 }, { -0.15f, 1.2f, 2 }, { -0.13f, 1.15f, 2 }
+	};
+	skeleton.tracked[2] = 1;
+	for (int f = 0; f < 3; f++) {
+		skeleton.timestamp = f * 100000ll; // 10 fps, moves 0.1 m per frame
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			int i = SkeletonFrame::index(2, j);
+			skeleton.position[0][i] = pose[j][0] + f * 0.1f;
+			skeleton.position[1][i] = pose[j][1];
+			skeleton.position[2][i] = pose[j][2];
+		}
+		engine.update(skeleton);
+	}
+	const BodyFeatures & features = engine.getBody(2);
+	ok = features.tracked && !engine.getBody(0).tracked
+		&& std::fabs(features.angle[0] - 180) < 0.5f     // ElbowL straight
+		&& std::fabs(features.angle[8] - 180) < 0.5f     // KneeL straight
+		&& std::fabs(features.speed[0] - 1) < 1e-3f && features.acceleration[0] < 1e-3f
+		&& std::fabs(features.boneLength[3] - 0.3f) < 1e-4f // SpineMid -> SpineBase
+		&& features.triggers == (FEATURE_LEFT_HAND_UP | FEATURE_RIGHT_HAND_UP | FEATURE_HANDS_UP | FEATURE_HANDS_TOGETHER)
+		&& features.triggersStarted == 0;
+
+	printf("skeleton features (%d bones, %d angles)\n", BONE_COUNT, FEATURE_ANGLE_COUNT);
+	printf("  %7.2f us/frame  %s\n", ms * 1000, ok ? "ok" : "WRONG FEATURES for the test pose");
+	report("skeletonFeatures.us_per_frame", ms * 1000);
+	return ok;
+}
+
+//--------------------------------------------------------------
+// Stage timers: record() cost, and the rolling percentiles against sorting the last window by hand
+static bool benchStageTimers(int samples) {
+	StageTimers timers;
+	srand(7);
+	std::vector<float> recorded(samples);
+	for (int i = 0; i < samples; i++) {
+		recorded[i] = (float)(rand() % 100000) / 10.0f;
+	}
+
+	BenchClock::time_point start = BenchClock::now();
+	for (int i = 0; i < samples; i++) {
+		timers.record(TIMING_KEYING, recorded[i]);
+	}
+	double ms = elapsedMs(start);
+
+	int count = samples < TIMING_WINDOW ? samples : TIMING_WINDOW;
+	std::vector<float> window(recorded.end() - count, recorded.end());
+	std::sort(window.begin(), window.end());
+	auto rank = [&](int p) { return window[(p * count + 99) / 100 - 1] / 1000.0f; };
+
+	TimingSummary summary, empty;
+	bool ok = timers.summarize(TIMING_KEYING, summary) && !timers.summarize(TIMING_FBO, empty)
+		&& summary.samples == (unsigned int)samples && summary.p50 == rank(50) && summary.p95 == rank(95)
+		&& summary.p99 == rank(99) && summary.max == window.back() / 1000.0f;
+
+	start = BenchClock::now();
+	for (int s = 0; s < TIMING_STAGE_COUNT; s++) {
+		timers.summarize(s, empty);
+	}
+	double summarizeMs = elapsedMs(start);
+
+	printf("stage timers (%d stages, %d sample window)\n", TIMING_STAGE_COUNT, TIMING_WINDOW);
+	printf("  record %6.2f ns  summarize all %6.3f ms  p50 %.3f p95 %.3f p99 %.3f ms  %s\n", ms * 1e6 / samples,
+		summarizeMs, summary.p50, summary.p95, summary.p99, ok ? "ok" : "WRONG PERCENTILES");
+	report("stageTimers.record_ns", ms * 1e6 / samples);
+	return ok;
+}
+
+//--------------------------------------------------------------
+// Frames paced like the live sensor: due every periodMicros, waitForFrame() sleeps until then
+class PacedFrameSource : public FrameSource {
+public:
+	PacedFrameSource(long long periodMicros_) : periodMicros(periodMicros_), startMicros(0) {
+		memset(&frame, 0, sizeof(frame));
+	}
+	bool setup() override {
+		startMicros = frameSourceMicros();
+		return true;
+	}
+	bool waitForFrame(int timeoutMillis) override {
+		long long wait = getDueMicros() - frameSourceMicros();
+		if (wait > timeoutMillis * 1000LL) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMillis));
+			return false;
+		}
+		if (wait > 0) std::this_thread::sleep_for(std::chrono::microseconds(wait));
+		return true;
+	}
+	bool update() override {
+		if (frameSourceMicros() < getDueMicros()) return false;
+		frame.frameNumber++;
+		frame.timestamp = getDueMicros() - periodMicros; // when it "arrived"
+		return true;
+	}
+	const KinectFrame & getFrame() const override { return frame; }
+	std::string getName() const override { return "paced"; }
+
+private:
+	long long getDueMicros() const { return startMicros + (long long)(frame.frameNumber + 1) * periodMicros; }
+
+	long long periodMicros;
+	long long startMicros;
+	KinectFrame frame;
+};
+
+// Acquisition thread at 30 fps against a render loop that takes longer than a frame: every frame
+// still gets processed right after it's due, and the render side only ever sees whole frames,
+// newest first, through the triple buffer
+static bool benchAcquisition(int frames) {
+	const long long period = 33333;
+	const int payload = 64 * 1024;
+	PacedFrameSource source(period);
+	source.setup();
+
+	TripleBuffer<std::vector<unsigned long long>> buffers;
+	for (int i = 0; i < 3; i++) buffers.getSlot(i).assign(payload, 0);
+
+	std::vector<long long> delays;
+	delays.reserve(frames);
+	AcquisitionThread acquisition;
+	acquisition.start(&source, [&](bool bFrameNew) {
+		if (!bFrameNew) return;
+		const KinectFrame & frame = source.getFrame();
+		delays.push_back(frameSourceMicros() - frame.timestamp);
+		std::vector<unsigned long long> & out = buffers.getBack();
+		for (int i = 0; i < payload; i++) out[i] = frame.frameNumber;
+		buffers.publish();
+	});
+
+	int taken = 0, torn = 0;
+	unsigned long long last = 0;
+	while (last < (unsigned long long)frames) {
+		if (buffers.update()) {
+			const std::vector<unsigned long long> & in = buffers.getFront();
+			for (int i = 1; i < payload; i++) {
+				if (in[i] != in[0]) {
+					torn++;
+					break;
+				}
+			}
+			if (in[0] <= last) torn++;
+			last = in[0];
+			taken++;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(45)); // slow draw()
+	}
+	acquisition.stop();
+
+	std::vector<long long> sorted(delays.begin(), delays.begin() + frames);
+	std::sort(sorted.begin(), sorted.end());
+	bool ok = torn == 0 && taken < frames;
+	printf("acquisition thread (%.0f fps source, 45 ms render loop)\n", 1e6 / period);
+	printf("  %d frames processed, %d shown  delay after arrival p50 %.2f ms  p99 %.2f ms  %s\n", frames, taken,
+		sorted[sorted.size() / 2] / 1000.0, sorted[sorted.size() * 99 / 100] / 1000.0, ok ? "ok" : "TORN / OUT OF ORDER FRAMES");
+	return ok;
+}
+
+//--------------------------------------------------------------
+// Baseline file: one "name value" line per metric, '#' starts a comment line
+static bool saveBaseline(const char * path) {
+	FILE * file = fopen(path, "w");
+	if (!file) return false;
+	fprintf(file, "# kinect2share bench baseline, lower is better\n");
+	for (const BenchResult & result : results) {
+		fprintf(file, "%s %.17g\n", result.name.c_str(), result.value);
+	}
+	return fclose(file) == 0;
+}
+
+static bool loadBaseline(const char * path, std::map<std::string, double> & baseline) {
+	FILE * file = fopen(path, "r");
+	if (!file) return false;
+	char line[256], name[200];
+	double value;
+	while (fgets(line, sizeof(line), file)) {
+		if (line[0] == '#') continue;
+		if (sscanf(line, "%199s %lf", name, &value) == 2) baseline[name] = value;
+	}
+	fclose(file);
+	return true;
+}
+
+// Times may be up to tolerancePercent above the baseline, allocations can't go up at all.
+// Returns the number of regressions, metrics only one side has are listed but don't count.
+static int compareBaseline(const std::map<std::string, double> & baseline, double tolerancePercent) {
+	int regressions = 0;
+	printf("baseline comparison (times +%.0f%% allowed, allocations exact)\n", tolerancePercent);
+	for (const BenchResult & result : results) {
+		auto it = baseline.find(result.name);
+		if (it == baseline.end()) {
+			printf("  %-42s %12s -> %10.3f           new\n", result.name.c_str(), "", result.value);
+			continue;
+		}
+		double base = it->second;
+		bool bRegressed = result.bAllocations ? result.value > base : result.value > base * (1 + tolerancePercent / 100);
+		if (bRegressed) regressions++;
+		printf("  %-42s %12.3f -> %10.3f %+7.1f%%  %s\n", result.name.c_str(), base, result.value,
+			base > 0 ? (result.value / base - 1) * 100 : 0.0, bRegressed ? "REGRESSION" : "ok");
+	}
+	for (const auto & entry : baseline) {
+		bool bFound = false;
+		for (const BenchResult & result : results) bFound = bFound || result.name == entry.first;
+		if (!bFound) printf("  %-42s %12.3f              not run\n", entry.first.c_str(), entry.second);
+	}
+	return regressions;
+}
+
+//--------------------------------------------------------------
+int runBenchmarks(int argc, char * argv[]) {
+	int frames = 300;
+	int maxThreads = (int)std::thread::hardware_concurrency();
+	const char * replayPath = nullptr;
+	const char * baselinePath = nullptr;
+	const char * saveBaselinePath = nullptr;
+	double tolerancePercent = 15;
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--bench") == 0 || strcmp(argv[i], "--frames") == 0) && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+			frames = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+			baselinePath = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--save-baseline") == 0 && i + 1 < argc) {
+			saveBaselinePath = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+			tolerancePercent = atof(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			maxThreads = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			replayPath = argv[i + 1];
+		}
+	}
+	if (maxThreads < 1) maxThreads = 1;
+
+	printf("kinect2share benchmarks, %d frames per run\n", frames);
+	if (!benchHeapAllocations) printf("allocations aren't counted in this build, only by the standalone bench\n");
+
+	// frame set: the start of a recording if given, synthetic otherwise
+	std::vector<BenchFrame> frameSet;
+	if (replayPath) {
+		ReplayFrameSource replay(replayPath, true);
+		if (!replay.setup()) {
+			printf("could not open recording %s\n", replayPath);
+			return 1;
+		}
+		int count = replay.getNumFrames() < 30 ? replay.getNumFrames() : 30;
+		frameSet.resize(count);
+		for (int i = 0; i < count && replay.update(); i++) {
+			frameSet[i].copyFrom(replay.getFrame());
+		}
+		printf("frame set: %d frames from %s\n", count, replayPath);
+	}
+	else {
+		frameSet.resize(8);
+		for (size_t i = 0; i < frameSet.size(); i++) {
+			frameSet[i].makeSynthetic(1234 + (unsigned int)i);
+		}
+		printf("frame set: %d synthetic frames\n", (int)frameSet.size());
+	}
+
+	bool ok = benchKeying(frameSet[0], frames);
+	ok = benchKeyingThreads(frameSet, frames, maxThreads) && ok;
+	ok = benchPixelKernels(frameSet[0], frames) && ok;
+	ok = benchDepthEncoding(frameSet[0], frames) && ok;
+	ok = benchCapture(frameSet[0], frames) && ok;
+	ok = benchSpscQueue(frames * 10000) && ok;
+	ok = benchBodyJson(frameSet, frames) && ok;
+	ok = benchSkeletonHistory(frames * 1000, 2) && ok;
+	ok = benchSkeletonFilter(frameSet, frames) && ok;
+	ok = benchSkeletonFeatures(frameSet, frames) && ok;
+	ok = benchAcquisition(frames < 90 ? frames : 90) && ok;
+	ok = benchStageTimers(frames * 1000) && ok;
+
+	if (saveBaselinePath) {
+		if (saveBaseline(saveBaselinePath)) printf("baseline saved to %s\n", saveBaselinePath);
+		else printf("could not write baseline %s\n", saveBaselinePath);
+	}
+	int regressions = 0;
+	if (baselinePath) {
+		std::map<std::string, double> baseline;
+		if (!loadBaseline(baselinePath, baseline)) {
+			printf("could not read baseline %s\n", baselinePath);
+			return 1;
+		}
+		regressions = compareBaseline(baseline, tolerancePercent);
+		printf("%d regressions\n", regressions);
+	}
+	if (!ok) return 1;
+	return regressions > 0 ? 2 : 0;
+}
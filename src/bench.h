@@ -0,0 +1,18 @@
+#pragma once
+
+// Headless microbenchmarks for the cpu stages.
+// Run with:  KinectNDIApp --bench [frames] [--threads maxThreads] [--replay recording.kv2rec]
+//                         [--save-baseline file] [--baseline file] [--tolerance percent]
+// or the standalone build in bench/ (no openFrameworks, Kinect, GL or NDI, builds on Linux),
+// which takes the same options plus --frames N.
+// Frames are synthetic or taken from a recording.
+// Every SIMD path is also checked against the scalar reference. --save-baseline writes this
+// run's metrics, --baseline compares against a saved run: times may be --tolerance percent
+// (default 15) slower, allocations can't go up.
+// Returns 0 if all is well, 1 if any output differs, 2 on performance regressions only.
+int runBenchmarks(int argc, char * argv[]);
+
+// Heap allocations so far, for the allocations per frame metrics. Set by the standalone build,
+// which replaces operator new to count them (bench/benchMain.cpp). The app keeps the default
+// allocator, this stays null there and allocations aren't reported.
+extern unsigned long long (*benchHeapAllocations)();
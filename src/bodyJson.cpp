@@ -0,0 +1,139 @@
+#include "bodyJson.h"
+
+#include <cstdio>
+#include <cstring>
+
+// sizes up front so a body normally fits without ever growing the arena
+#define BODY_JSON_RESERVE 8192
+#define BODY_JSON_NUMBER_MAX 24 // int / unsigned long long digits + sign
+#define APPEND_LITERAL(s) append(s, sizeof(s) - 1)
+
+//--------------------------------------------------------------
+static int formatUnsigned(unsigned long long value, char * out) {
+	char digits[BODY_JSON_NUMBER_MAX];
+	int n = 0;
+	do {
+		digits[n++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value);
+	for (int i = 0; i < n; i++) {
+		out[i] = digits[n - 1 - i];
+	}
+	return n;
+}
+
+static int formatInt(int value, char * out) {
+	if (value >= 0) return formatUnsigned((unsigned long long)value, out);
+	out[0] = '-';
+	return 1 + formatUnsigned(0ull - (unsigned long long)(long long)value, out + 1);
+}
+
+int formatFloatFixed6(float value, char * out) {
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	bool bNegative = (bits >> 31) != 0;
+	int exponent = (bits >> 23) & 0xFF;
+	unsigned long long mantissa = bits & 0x7FFFFF;
+
+	// nan, inf and anything above 2^40 (not a position in meters) go the slow way
+	if (exponent >= 127 + 40) {
+		return snprintf(out, BODY_JSON_FLOAT_MAX, "%f", value);
+	}
+	if (exponent) mantissa |= 1 << 23;
+	else exponent = 1; // denormal
+	int shift = exponent - 127 - 23; // value = mantissa * 2^shift
+
+	// value * 10^6 rounded to nearest, ties to even. Exact: mantissa * 10^6 < 2^44
+	unsigned long long scaled;
+	if (shift >= 0) {
+		scaled = (mantissa << shift) * 1000000;
+	}
+	else if (-shift >= 64) {
+		scaled = 0; // below 2^-40, rounds to 0.000000 (and the shift below can't go that far)
+	}
+	else {
+		unsigned long long product = mantissa * 1000000;
+		int k = -shift;
+		scaled = product >> k;
+		unsigned long long remainder = product & ((1ull << k) - 1);
+		unsigned long long half = 1ull << (k - 1);
+		if (remainder > half || (remainder == half && (scaled & 1))) scaled++;
+	}
+
+	int n = 0;
+	if (bNegative) out[n++] = '-'; // "%f" keeps the sign of -0.0 and of tiny negatives
+	n += formatUnsigned(scaled / 1000000, out + n);
+	out[n++] = '.';
+	unsigned int fraction = (unsigned int)(scaled % 1000000);
+	for (int i = 5; i >= 0; i--) {
+		out[n + i] = (char)('0' + fraction % 10);
+		fraction /= 10;
+	}
+	return n + 6;
+}
+
+//--------------------------------------------------------------
+BodyJsonWriter::BodyJsonWriter()
+	: length(0) {
+	arena.resize(BODY_JSON_RESERVE);
+	address[0] = 0;
+}
+
+void BodyJsonWriter::reserve(size_t bytes) {
+	// only a pathological joint name list gets here
+	if (length + bytes > arena.size()) arena.resize((length + bytes) * 2);
+}
+
+void BodyJsonWriter::append(const char * text, size_t n) {
+	memcpy(arena.data() + length, text, n);
+	length += n;
+}
+
+void BodyJsonWriter::appendEscaped(const char * text) {
+	for (; *text; text++) {
+		if (*text == '"' || *text == '\\') arena[length++] = '\\';
+		arena[length++] = *text;
+	}
+}
+
+//--------------------------------------------------------------
+const char * BodyJsonWriter::write(const BodySample & body, const char * const names[JOINT_COUNT], unsigned int jointMask) {
+	char number[BODY_JSON_FLOAT_MAX];
+	length = 0;
+
+	memcpy(address, "/kV2/body/", 10);
+	address[10 + formatInt(body.bodyId, address + 10)] = 0;
+
+	reserve(128 + 4 * BODY_JSON_NUMBER_MAX);
+	APPEND_LITERAL("{\"b");
+	append(number, formatInt(body.bodyId, number));
+	APPEND_LITERAL("\": \"[{\\\"tracked\\\":");
+	append(number, formatInt(body.tracked, number));
+	APPEND_LITERAL("},{\\\"ID\\\":");
+	append(number, formatUnsigned(body.trackingId, number));
+	APPEND_LITERAL("},{\\\"RH-st8\\\":");
+	append(number, formatInt(body.rightHandState, number));
+	APPEND_LITERAL("},{\\\"LH-st8\\\":");
+	append(number, formatInt(body.leftHandState, number));
+	APPEND_LITERAL("}");
+
+	for (int j = 0; body.tracked && j < JOINT_COUNT; j++) {
+		if (!(jointMask & (1u << j))) continue;
+		const float * pos = body.joints[j].position;
+		reserve(64 + 2 * strlen(names[j]) + 3 * BODY_JSON_FLOAT_MAX);
+		APPEND_LITERAL(",{\\\"j\\\":\\\"");
+		appendEscaped(names[j]);
+		APPEND_LITERAL("\\\",\\\"x\\\":");
+		append(number, formatFloatFixed6(pos[0], number));
+		APPEND_LITERAL(",\\\"y\\\":");
+		append(number, formatFloatFixed6(pos[1], number));
+		APPEND_LITERAL(",\\\"z\\\":");
+		append(number, formatFloatFixed6(pos[2], number));
+		APPEND_LITERAL("}");
+	}
+
+	reserve(8);
+	APPEND_LITERAL("]\"}");
+	arena[length] = 0;
+	return arena.data();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "frameSource.h"
+
+#include <vector>
+
+// Per body JSON as sent on /kV2/body/<bodyId> in "OSC as JSON" mode:
+//   {"b0": "[{\"tracked\":1},{\"ID\":72057594037938015},{\"RH-st8\":2},{\"LH-st8\":3},{\"j\":\"SpineBase\",\"x\":-0.102359,\"y\":-0.669035,\"z\":1.112273},...]"}
+// The inner array is a JSON string, so its quotes are escaped. Untracked bodies stop after LH-st8.
+//
+// Written straight into a buffer that is reused frame after frame, numbers are formatted by hand
+// (floats exactly like to_string(float), i.e. printf "%f"), so a frame doesn't touch the heap.
+// Output is byte identical to the string concatenation this replaced, see benchBodyJson().
+class BodyJsonWriter {
+public:
+	BodyJsonWriter();
+
+	// returns the JSON for one body, valid until the next write().
+	// Only joints with their bit set in jointMask are written (SkeletonDeltaFilter)
+	const char * write(const BodySample & body, const char * const names[JOINT_COUNT], unsigned int jointMask = ~0u);
+	// "/kV2/body/<bodyId>" of the last write()
+	const char * getAddress() const { return address; }
+	size_t getLength() const { return length; }
+
+private:
+	void reserve(size_t bytes);
+	void appendEscaped(const char * text); // as a JSON string inside the JSON string
+	void append(const char * text, size_t n);
+
+	std::vector<char> arena;
+	size_t length;
+	char address[32];
+};
+
+// printf("%f", value) without the CRT (rounds half to even on the exact binary value, like
+// glibc and the UCRT), returns the number of chars written. out needs BODY_JSON_FLOAT_MAX bytes.
+#define BODY_JSON_FLOAT_MAX 64
+int formatFloatFixed6(float value, char * out);
@@ -0,0 +1,246 @@
+#include "captureFormat.h"
+#include "lz4.h"
+
+#include <cstring>
+
+static_assert(sizeof(CaptureFileHeader) == 64, "CaptureFileHeader must not have padding (recording format)");
+static_assert(sizeof(CaptureFrameHeader) % CAPTURE_ALIGNMENT == 0, "chunks start aligned after CaptureFrameHeader");
+static_assert(sizeof(CaptureIndexEntry) == 16, "CaptureIndexEntry must not have padding (recording format)");
+
+// delta filter layout per stream, bytes per sample and interleaved channels.
+// 0 bytes: plain LZ4, no filter
+struct StreamLayout {
+	const char * name;
+	int sampleBytes;
+	int channels;
+};
+
+static const StreamLayout streamLayouts[CAPTURE_STREAM_COUNT] = {
+	{ "depth", 2, 1 },
+	{ "infrared", 2, 1 },
+	{ "body index", 0, 0 },  // long runs of 255 already, LZ4 does fine
+	{ "color", 1, 4 },       // B G R A
+	{ "color coords", 4, 2 }, // x y float bits, neighbours are close
+	{ "bodies", 0, 0 }
+};
+
+static size_t alignUp(size_t size) {
+	return (size + CAPTURE_ALIGNMENT - 1) / CAPTURE_ALIGNMENT * CAPTURE_ALIGNMENT;
+}
+
+//--------------------------------------------------------------
+size_t captureStreamSize(int stream) {
+	switch (stream) {
+	case CAPTURE_STREAM_DEPTH: return DEPTH_SIZE * sizeof(unsigned short);
+	case CAPTURE_STREAM_INFRARED: return DEPTH_SIZE * sizeof(unsigned short);
+	case CAPTURE_STREAM_BODY_INDEX: return DEPTH_SIZE;
+	case CAPTURE_STREAM_COLOR: return COLOR_WIDTH * COLOR_HEIGHT * 4;
+	case CAPTURE_STREAM_COLOR_COORDS: return DEPTH_SIZE * 2 * sizeof(float);
+	case CAPTURE_STREAM_BODIES: return BODY_COUNT_MAX * sizeof(BodySample);
+	default: return 0;
+	}
+}
+
+const char * captureStreamName(int stream) {
+	return stream >= 0 && stream < CAPTURE_STREAM_COUNT ? streamLayouts[stream].name : "unknown";
+}
+
+void captureInitHeader(CaptureFileHeader & header) {
+	memset(&header, 0, sizeof(header));
+	header.magic = CAPTURE_MAGIC;
+	header.version = CAPTURE_VERSION;
+	header.depthWidth = DEPTH_WIDTH;
+	header.depthHeight = DEPTH_HEIGHT;
+	header.colorWidth = COLOR_WIDTH;
+	header.colorHeight = COLOR_HEIGHT;
+	header.bodyCount = BODY_COUNT_MAX;
+	header.jointCount = JOINT_COUNT;
+	header.streamCount = CAPTURE_STREAM_COUNT;
+}
+
+bool captureCheckHeader(const CaptureFileHeader & header) {
+	return header.magic == CAPTURE_MAGIC && header.version == CAPTURE_VERSION
+		&& header.depthWidth == DEPTH_WIDTH && header.depthHeight == DEPTH_HEIGHT
+		&& header.colorWidth == COLOR_WIDTH && header.colorHeight == COLOR_HEIGHT
+		&& header.bodyCount == BODY_COUNT_MAX && header.jointCount == JOINT_COUNT
+		&& header.streamCount == CAPTURE_STREAM_COUNT;
+}
+
+//--------------------------------------------------------------
+// Delta filter: plane (channel * sizeof(T) + byte) holds that byte of every channel sample,
+// samples = total values, a multiple of channels
+template<typename T>
+static void deltaEncode(const T * src, size_t samples, int channels, unsigned char * planes) {
+	const size_t perPlane = samples / channels;
+	for (int c = 0; c < channels; c++) {
+		unsigned char * plane = planes + c * sizeof(T) * perPlane;
+		T prev = 0;
+		for (size_t i = 0; i < perPlane; i++) {
+			T v = src[i * channels + c];
+			T d = (T)(v - prev);
+			prev = v;
+			for (size_t b = 0; b < sizeof(T); b++) {
+				plane[b * perPlane + i] = (unsigned char)(d >> (8 * b));
+			}
+		}
+	}
+}
+
+template<typename T>
+static void deltaDecode(const unsigned char * planes, size_t samples, int channels, T * dst) {
+	const size_t perPlane = samples / channels;
+	for (int c = 0; c < channels; c++) {
+		const unsigned char * plane = planes + c * sizeof(T) * perPlane;
+		T prev = 0;
+		for (size_t i = 0; i < perPlane; i++) {
+			T d = 0;
+			for (size_t b = 0; b < sizeof(T); b++) {
+				d |= (T)((T)plane[b * perPlane + i] << (8 * b));
+			}
+			prev = (T)(prev + d);
+			dst[i * channels + c] = prev;
+		}
+	}
+}
+
+static void deltaEncode(const StreamLayout & layout, const unsigned char * src, size_t size, unsigned char * planes) {
+	switch (layout.sampleBytes) {
+	case 1: deltaEncode(src, size, layout.channels, planes); break;
+	case 2: deltaEncode((const unsigned short*)src, size / 2, layout.channels, planes); break;
+	case 4: deltaEncode((const unsigned int*)src, size / 4, layout.channels, planes); break;
+	}
+}
+
+static void deltaDecode(const StreamLayout & layout, const unsigned char * planes, size_t size, unsigned char * dst) {
+	switch (layout.sampleBytes) {
+	case 1: deltaDecode(planes, size, layout.channels, dst); break;
+	case 2: deltaDecode(planes, size / 2, layout.channels, (unsigned short*)dst); break;
+	case 4: deltaDecode(planes, size / 4, layout.channels, (unsigned int*)dst); break;
+	}
+}
+
+//--------------------------------------------------------------
+void CaptureEncoder::encodeFrame(const KinectFrame & frame, unsigned int compressMask, std::vector<unsigned char> & out) {
+	const void * streams[CAPTURE_STREAM_COUNT] = {
+		frame.depth, frame.infrared, frame.bodyIndex, frame.colorBGRA, frame.colorCoords, frame.bodies
+	};
+
+	CaptureFrameHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = CAPTURE_FRAME_MAGIC;
+	header.frameNumber = frame.frameNumber;
+	header.timestamp = frame.timestamp;
+
+	out.resize(sizeof(CaptureFrameHeader));
+	for (int s = 0; s < CAPTURE_STREAM_COUNT; s++) {
+		CaptureChunk & chunk = header.chunks[s];
+		size_t offset = alignUp(out.size());
+		chunk.offset = (unsigned int)offset;
+		if (!streams[s]) {
+			out.resize(offset);
+			continue;
+		}
+
+		const unsigned char * src = (const unsigned char*)streams[s];
+		const size_t size = captureStreamSize(s);
+		chunk.rawSize = (unsigned int)size;
+
+		if (compressMask & (1 << s)) {
+			const StreamLayout & layout = streamLayouts[s];
+			if (layout.sampleBytes) {
+				planes.resize(size);
+				deltaEncode(layout, src, size, planes.data());
+				src = planes.data();
+			}
+
+			int bound = lz4CompressBound((int)size);
+			out.resize(offset + bound);
+			int compressed = lz4Compress(src, (int)size, out.data() + offset, bound);
+			if (compressed > 0 && (size_t)compressed < size) {
+				chunk.codec = layout.sampleBytes ? CAPTURE_CODEC_DELTA_LZ4 : CAPTURE_CODEC_LZ4;
+				chunk.storedSize = compressed;
+				out.resize(offset + compressed);
+				continue;
+			}
+			src = (const unsigned char*)streams[s]; // noise doesn't compress, keep it raw
+		}
+
+		chunk.codec = CAPTURE_CODEC_RAW;
+		chunk.storedSize = (unsigned int)size;
+		out.resize(offset + size);
+		memcpy(out.data() + offset, src, size);
+	}
+
+	out.resize(alignUp(out.size()));
+	header.frameSize = (unsigned int)out.size();
+	memcpy(out.data(), &header, sizeof(header));
+}
+
+//--------------------------------------------------------------
+bool captureCheckFrame(const unsigned char * data, long long available) {
+	if (available < (long long)sizeof(CaptureFrameHeader)) return false;
+
+	CaptureFrameHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != CAPTURE_FRAME_MAGIC || header.frameSize > available
+		|| header.frameSize < sizeof(CaptureFrameHeader)) {
+		return false;
+	}
+
+	for (int s = 0; s < CAPTURE_STREAM_COUNT; s++) {
+		const CaptureChunk & chunk = header.chunks[s];
+		if (chunk.rawSize == 0) continue;
+		if (chunk.rawSize != captureStreamSize(s) || chunk.codec > CAPTURE_CODEC_DELTA_LZ4
+			|| (chunk.codec == CAPTURE_CODEC_RAW && chunk.storedSize != chunk.rawSize)
+			|| chunk.offset < sizeof(CaptureFrameHeader) || chunk.offset > header.frameSize
+			|| chunk.storedSize > header.frameSize - chunk.offset) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+const unsigned char * CaptureDecoder::decodeChunk(int stream, const CaptureChunk & chunk, const unsigned char * data) {
+	const unsigned char * src = data + chunk.offset;
+	if (chunk.codec == CAPTURE_CODEC_RAW) return src; // zero copy
+
+	std::vector<unsigned char> & buffer = buffers[stream];
+	buffer.resize(chunk.rawSize);
+	if (chunk.codec == CAPTURE_CODEC_LZ4) {
+		int size = lz4Decompress(src, chunk.storedSize, buffer.data(), chunk.rawSize);
+		return size == (int)chunk.rawSize ? buffer.data() : nullptr;
+	}
+
+	planes.resize(chunk.rawSize);
+	int size = lz4Decompress(src, chunk.storedSize, planes.data(), chunk.rawSize);
+	if (size != (int)chunk.rawSize) return nullptr;
+	deltaDecode(streamLayouts[stream], planes.data(), chunk.rawSize, buffer.data());
+	return buffer.data();
+}
+
+bool CaptureDecoder::decodeFrame(const unsigned char * data, long long available, KinectFrame & frame) {
+	if (!captureCheckFrame(data, available)) return false;
+
+	CaptureFrameHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	const unsigned char * streams[CAPTURE_STREAM_COUNT];
+	for (int s = 0; s < CAPTURE_STREAM_COUNT; s++) {
+		streams[s] = nullptr;
+		if (header.chunks[s].rawSize == 0) continue;
+		streams[s] = decodeChunk(s, header.chunks[s], data);
+		if (!streams[s]) return false;
+	}
+
+	frame.frameNumber = header.frameNumber;
+	frame.timestamp = header.timestamp;
+	frame.depth = (const unsigned short*)streams[CAPTURE_STREAM_DEPTH];
+	frame.infrared = (const unsigned short*)streams[CAPTURE_STREAM_INFRARED];
+	frame.bodyIndex = streams[CAPTURE_STREAM_BODY_INDEX];
+	frame.colorBGRA = streams[CAPTURE_STREAM_COLOR];
+	frame.colorCoords = (const float*)streams[CAPTURE_STREAM_COLOR_COORDS];
+	if (streams[CAPTURE_STREAM_BODIES]) memcpy(frame.bodies, streams[CAPTURE_STREAM_BODIES], sizeof(frame.bodies));
+	else memset(frame.bodies, 0, sizeof(frame.bodies));
+	return true;
+}
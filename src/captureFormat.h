@@ -0,0 +1,119 @@
+#pragma once
+
+#include "frameSource.h"
+
+#include <vector>
+
+// kv2rec capture files, everything little endian:
+//
+//   CaptureFileHeader                   64 bytes
+//   frames                              each CAPTURE_ALIGNMENT aligned
+//     CaptureFrameHeader                one CaptureChunk per stream
+//     chunks                            each CAPTURE_ALIGNMENT aligned
+//   CaptureIndexEntry[frameCount]       offset + timestamp of every frame
+//
+// The index is written when recording stops, a file without one (crashed / still
+// recording) is indexed by walking the frame headers instead.
+// Raw chunks are used straight from the memory mapped file, so a replay copies nothing
+// but the compressed streams. Compressed chunks are LZ4 blocks, for the image streams
+// after a per channel delta filter split into byte planes (see CAPTURE_CODEC_DELTA_LZ4).
+#define CAPTURE_MAGIC 0x5232564B       // "KV2R"
+#define CAPTURE_VERSION 2
+#define CAPTURE_FRAME_MAGIC 0x4632564B // "KV2F"
+#define CAPTURE_ALIGNMENT 64           // cache line, fine for any SIMD load
+
+enum CaptureStream {
+	CAPTURE_STREAM_DEPTH = 0,
+	CAPTURE_STREAM_INFRARED,
+	CAPTURE_STREAM_BODY_INDEX,
+	CAPTURE_STREAM_COLOR,
+	CAPTURE_STREAM_COLOR_COORDS,
+	CAPTURE_STREAM_BODIES,
+	CAPTURE_STREAM_COUNT
+};
+
+enum CaptureCodec {
+	CAPTURE_CODEC_RAW = 0,
+	CAPTURE_CODEC_LZ4,
+	// every sample minus the previous one of the same channel, bytes split into one plane
+	// per channel and byte (so the mostly zero high bytes of depth end up together), LZ4
+	CAPTURE_CODEC_DELTA_LZ4
+};
+
+// CaptureEncoder compression masks, one bit per CaptureStream
+#define CAPTURE_COMPRESS_NONE 0
+#define CAPTURE_COMPRESS_DEPTH ((1 << CAPTURE_STREAM_DEPTH) | (1 << CAPTURE_STREAM_INFRARED) \
+	| (1 << CAPTURE_STREAM_BODY_INDEX) | (1 << CAPTURE_STREAM_COLOR_COORDS) | (1 << CAPTURE_STREAM_BODIES))
+#define CAPTURE_COMPRESS_COLOR (1 << CAPTURE_STREAM_COLOR)
+#define CAPTURE_COMPRESS_ALL (CAPTURE_COMPRESS_DEPTH | CAPTURE_COMPRESS_COLOR)
+
+struct CaptureFileHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int depthWidth;
+	unsigned int depthHeight;
+	unsigned int colorWidth;
+	unsigned int colorHeight;
+	unsigned int bodyCount;
+	unsigned int jointCount;
+	unsigned long long indexOffset; // 0 if the recording wasn't stopped cleanly
+	unsigned int frameCount;
+	unsigned int streamCount;
+	unsigned int reserved[4];
+};
+
+struct CaptureChunk {
+	unsigned int codec;      // CaptureCodec
+	unsigned int storedSize; // bytes in the file
+	unsigned int rawSize;    // 0 if the stream was missing (no infrared)
+	unsigned int offset;     // from the start of the frame header
+};
+
+struct CaptureFrameHeader {
+	unsigned int magic;
+	unsigned int frameSize;  // header + chunks + padding, the next frame starts here
+	unsigned long long frameNumber;
+	long long timestamp;     // microseconds
+	CaptureChunk chunks[CAPTURE_STREAM_COUNT];
+	unsigned int reserved[2];
+};
+
+struct CaptureIndexEntry {
+	unsigned long long offset;
+	long long timestamp;
+};
+
+// uncompressed bytes of a stream
+size_t captureStreamSize(int stream);
+const char * captureStreamName(int stream);
+
+void captureInitHeader(CaptureFileHeader & header);
+bool captureCheckHeader(const CaptureFileHeader & header);
+
+// Serializes frames into the layout above, keeps its scratch buffers between frames
+class CaptureEncoder {
+public:
+	// Writes the frame header + chunks to out (resized, starts at an aligned file offset).
+	// Streams in compressMask are compressed, unless that doesn't make them smaller.
+	void encodeFrame(const KinectFrame & frame, unsigned int compressMask, std::vector<unsigned char> & out);
+
+private:
+	std::vector<unsigned char> planes;
+};
+
+// Turns an encoded frame back into a KinectFrame. Raw streams point into data,
+// compressed ones are decoded into buffers owned by the decoder.
+class CaptureDecoder {
+public:
+	// available: bytes readable at data, false if the frame is truncated or corrupt
+	bool decodeFrame(const unsigned char * data, long long available, KinectFrame & frame);
+
+private:
+	const unsigned char * decodeChunk(int stream, const CaptureChunk & chunk, const unsigned char * data);
+
+	std::vector<unsigned char> buffers[CAPTURE_STREAM_COUNT];
+	std::vector<unsigned char> planes;
+};
+
+// checks magic, size and chunk bounds of the frame at data without decoding it
+bool captureCheckFrame(const unsigned char * data, long long available);
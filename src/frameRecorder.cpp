@@ -0,0 +1,167 @@
+#include "frameRecorder.h"
+
+#include <cstddef>
+#include <cstring>
+
+#define RECORDING_MAX_QUEUED 8 // ~100MB of frames in flight before dropping
+
+// recordings are far beyond 2GB, plain fseek is 32 bit on Windows
+static int seek64(FILE * f, long long offset, int origin) {
+#ifdef _WIN32
+	return _fseeki64(f, offset, origin);
+#else
+	return fseeko(f, (off_t)offset, origin);
+#endif
+}
+
+//--------------------------------------------------------------
+RecordingFrameSource::RecordingFrameSource(std::unique_ptr<FrameSource> source_)
+	: source(std::move(source_))
+	, file(nullptr)
+	, buffersAllocated(0)
+	, bStopWriter(false)
+	, writeOffset(0)
+	, compressMask(CAPTURE_COMPRESS_DEPTH)
+	, framesWritten(0)
+	, framesDropped(0)
+	, bytesWritten(0) {
+}
+
+RecordingFrameSource::~RecordingFrameSource() {
+	stopRecording();
+}
+
+void RecordingFrameSource::close() {
+	stopRecording();
+	source->close();
+}
+
+//--------------------------------------------------------------
+bool RecordingFrameSource::update() {
+	bool bNew = source->update();
+	if (bNew && isRecording() && source->getFrame().hasAllStreams()) {
+		queueFrame(source->getFrame());
+	}
+	return bNew;
+}
+
+//--------------------------------------------------------------
+bool RecordingFrameSource::startRecording(const std::string & path) {
+	stopRecording();
+
+	file = fopen(path.c_str(), "wb");
+	if (!file) return false;
+
+	// the index offset is filled in by stopRecording()
+	CaptureFileHeader header;
+	captureInitHeader(header);
+	fwrite(&header, sizeof(header), 1, file);
+	writeOffset = sizeof(header);
+	index.clear();
+
+	framesWritten = 0;
+	framesDropped = 0;
+	bytesWritten = writeOffset;
+	bStopWriter = false;
+	writer = std::thread(&RecordingFrameSource::writerLoop, this);
+	return true;
+}
+
+void RecordingFrameSource::stopRecording() {
+	if (!file) return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		bStopWriter = true;
+	}
+	frameQueued.notify_one();
+	writer.join(); // writes out whatever is still queued
+
+	writeIndex();
+	fclose(file);
+	file = nullptr;
+}
+
+//--------------------------------------------------------------
+void RecordingFrameSource::queueFrame(const KinectFrame & frame) {
+	std::vector<unsigned char> buffer;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!freeBuffers.empty()) {
+			buffer.swap(freeBuffers.back());
+			freeBuffers.pop_back();
+		}
+		else if (buffersAllocated < RECORDING_MAX_QUEUED) {
+			buffersAllocated++;
+		}
+		else {
+			framesDropped++;
+			return;
+		}
+	}
+
+	// just copy here, compression happens on the writer thread
+	queueEncoder.encodeFrame(frame, CAPTURE_COMPRESS_NONE, buffer);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(std::move(buffer));
+	}
+	frameQueued.notify_one();
+}
+
+void RecordingFrameSource::writerLoop() {
+	while (true) {
+		std::vector<unsigned char> buffer;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			frameQueued.wait(lock, [this] { return bStopWriter || !queue.empty(); });
+			if (queue.empty()) return; // stopped and drained
+			buffer.swap(queue.front());
+			queue.pop_front();
+		}
+
+		writeFrame(buffer);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		freeBuffers.push_back(std::move(buffer));
+	}
+}
+
+void RecordingFrameSource::writeFrame(const std::vector<unsigned char> & buffer) {
+	const std::vector<unsigned char> * encoded = &buffer;
+	unsigned int mask = compressMask;
+	if (mask != CAPTURE_COMPRESS_NONE) {
+		// the queued copy is raw, so this view points straight into it
+		KinectFrame frame;
+		if (!writerDecoder.decodeFrame(buffer.data(), buffer.size(), frame)) return;
+		writerEncoder.encodeFrame(frame, mask, compressed);
+		encoded = &compressed;
+	}
+
+	CaptureIndexEntry entry;
+	memcpy(&entry.timestamp, encoded->data() + offsetof(CaptureFrameHeader, timestamp), sizeof(entry.timestamp));
+	entry.offset = writeOffset;
+
+	if (fwrite(encoded->data(), 1, encoded->size(), file) != encoded->size()) {
+		framesDropped++; // disk full, the index still only lists complete frames
+		seek64(file, writeOffset, SEEK_SET);
+		return;
+	}
+	index.push_back(entry);
+	writeOffset += encoded->size();
+	bytesWritten = writeOffset;
+	framesWritten++;
+}
+
+// frames are all aligned, so the index lands right after the last one
+void RecordingFrameSource::writeIndex() {
+	CaptureFileHeader header;
+	captureInitHeader(header);
+	header.frameCount = (unsigned int)index.size();
+	header.indexOffset = writeOffset;
+
+	if (!index.empty()) fwrite(index.data(), sizeof(CaptureIndexEntry), index.size(), file);
+	seek64(file, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, file);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "captureFormat.h"
+#include "frameSource.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Wraps another source and, while recording, queues a copy of every new frame for a
+// writer thread so the disk never blocks update(). The writer compresses the streams
+// selected with setCompression() and writes a kv2rec capture file (see captureFormat.h).
+// Frames are dropped (and counted) if the disk or the compression can't keep up.
+class RecordingFrameSource : public FrameSource {
+public:
+	RecordingFrameSource(std::unique_ptr<FrameSource> source);
+	~RecordingFrameSource();
+
+	bool setup() override { return source->setup(); }
+	void close() override;
+	bool waitForFrame(int timeoutMillis) override { return source->waitForFrame(timeoutMillis); }
+	bool update() override;
+	const KinectFrame & getFrame() const override { return source->getFrame(); }
+	std::string getName() const override { return source->getName(); }
+
+	FrameSource * getSource() { return source.get(); }
+
+	// CAPTURE_COMPRESS_* mask, can be changed while recording
+	void setCompression(unsigned int compressMask_) { compressMask = compressMask_; }
+	unsigned int getCompression() const { return compressMask; }
+
+	bool startRecording(const std::string & path);
+	void stopRecording();
+	bool isRecording() const { return file != nullptr; }
+	int getFramesWritten() const { return framesWritten; }
+	int getFramesDropped() const { return framesDropped; }
+	long long getBytesWritten() const { return bytesWritten; }
+
+private:
+	void queueFrame(const KinectFrame & frame);
+	void writerLoop();
+	void writeFrame(const std::vector<unsigned char> & buffer);
+	void writeIndex();
+
+	std::unique_ptr<FrameSource> source;
+
+	FILE * file;
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable frameQueued;
+	std::deque<std::vector<unsigned char>> queue; // uncompressed frames waiting for the writer
+	std::vector<std::vector<unsigned char>> freeBuffers;
+	int buffersAllocated;
+	bool bStopWriter;
+
+	CaptureEncoder queueEncoder; // update() side, copies frames uncompressed
+
+	// writer thread only
+	CaptureEncoder writerEncoder;
+	CaptureDecoder writerDecoder;
+	std::vector<unsigned char> compressed;
+	std::vector<CaptureIndexEntry> index;
+	long long writeOffset;
+
+	std::atomic<unsigned int> compressMask;
+
+	std::atomic<int> framesWritten;
+	std::atomic<int> framesDropped;
+	std::atomic<long long> bytesWritten;
+};
@@ -0,0 +1,149 @@
+#include "frameReplay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+//--------------------------------------------------------------
+ReplayFrameSource::ReplayFrameSource(const std::string & path_, bool bUnthrottled_)
+	: path(path_)
+	, bUnthrottled(bUnthrottled_)
+	, bIndexed(false)
+	, nextFrame(0)
+	, playStartMicros(0)
+	, playStartFrame(0) {
+	memset(&frame, 0, sizeof(frame));
+}
+
+ReplayFrameSource::~ReplayFrameSource() {
+	close();
+}
+
+//--------------------------------------------------------------
+bool ReplayFrameSource::setup() {
+	close();
+	if (!mapping.open(path)) return false;
+
+	CaptureFileHeader header;
+	if (mapping.getSize() < (long long)sizeof(header)) {
+		close();
+		return false;
+	}
+	memcpy(&header, mapping.getData(), sizeof(header));
+	if (!captureCheckHeader(header)) {
+		close();
+		return false;
+	}
+
+	// a cleanly stopped recording has its index at the end, no need to touch the frames
+	long long indexSize = (long long)header.frameCount * sizeof(CaptureIndexEntry);
+	bIndexed = header.indexOffset >= sizeof(header) && header.frameCount > 0
+		&& (long long)header.indexOffset + indexSize <= mapping.getSize();
+	if (bIndexed) {
+		const CaptureIndexEntry * entries = (const CaptureIndexEntry*)(mapping.getData() + header.indexOffset);
+		index.assign(entries, entries + header.frameCount);
+	}
+	else {
+		buildIndex();
+	}
+
+	if (index.empty()) {
+		close();
+		return false;
+	}
+
+	seekToFrame(0);
+	return true;
+}
+
+void ReplayFrameSource::close() {
+	mapping.close();
+	index.clear();
+	nextFrame = 0;
+	frame.depth = nullptr;
+	frame.infrared = nullptr;
+	frame.bodyIndex = nullptr;
+	frame.colorBGRA = nullptr;
+	frame.colorCoords = nullptr;
+}
+
+// walk the frame headers of a recording that was never stopped, up to the first broken frame
+void ReplayFrameSource::buildIndex() {
+	index.clear();
+	long long offset = sizeof(CaptureFileHeader);
+	while (captureCheckFrame(mapping.getData() + offset, mapping.getSize() - offset)) {
+		CaptureFrameHeader header;
+		memcpy(&header, mapping.getData() + offset, sizeof(header));
+
+		CaptureIndexEntry entry;
+		entry.offset = offset;
+		entry.timestamp = header.timestamp;
+		index.push_back(entry);
+		offset += header.frameSize;
+	}
+}
+
+//--------------------------------------------------------------
+void ReplayFrameSource::seekToFrame(int frameIndex) {
+	if (index.empty()) return;
+	nextFrame = std::max(0, std::min(frameIndex, (int)index.size() - 1));
+	playStartFrame = nextFrame;
+	playStartMicros = frameSourceMicros();
+	mapping.prefetch(index[nextFrame].offset, sizeof(CaptureFrameHeader));
+}
+
+void ReplayFrameSource::seekToTime(double seconds) {
+	if (index.empty()) return;
+	long long timestamp = index[0].timestamp + (long long)(seconds * 1e6);
+	auto it = std::lower_bound(index.begin(), index.end(), timestamp,
+		[](const CaptureIndexEntry & entry, long long t) { return entry.timestamp < t; });
+	seekToFrame((int)(it - index.begin()));
+}
+
+double ReplayFrameSource::getDuration() const {
+	if (index.empty()) return 0;
+	return (index.back().timestamp - index.front().timestamp) / 1e6;
+}
+
+double ReplayFrameSource::getPosition() const {
+	if (index.empty()) return 0;
+	return (index[nextFrame].timestamp - index.front().timestamp) / 1e6;
+}
+
+//--------------------------------------------------------------
+long long ReplayFrameSource::microsUntilDue() const {
+	// the recorded time since the play start has to pass first
+	long long due = index[nextFrame].timestamp - index[playStartFrame].timestamp;
+	return due - (frameSourceMicros() - playStartMicros);
+}
+
+bool ReplayFrameSource::waitForFrame(int timeoutMillis) {
+	long long wait = index.empty() ? timeoutMillis * 1000LL : (bUnthrottled ? 0 : microsUntilDue());
+	if (wait > timeoutMillis * 1000LL) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMillis));
+		return false;
+	}
+	if (wait > 0) std::this_thread::sleep_for(std::chrono::microseconds(wait));
+	return true;
+}
+
+bool ReplayFrameSource::update() {
+	if (index.empty()) return false;
+	if (!bUnthrottled && microsUntilDue() > 0) return false;
+
+	const CaptureIndexEntry & entry = index[nextFrame];
+	bool ok = decoder.decodeFrame(mapping.getData() + entry.offset, mapping.getSize() - (long long)entry.offset, frame);
+
+	nextFrame++;
+	if (nextFrame == (int)index.size()) {
+		seekToFrame(0); // loop
+	}
+	else {
+		// let the OS page in the next frame while this one is processed
+		const CaptureIndexEntry & next = index[nextFrame];
+		long long nextEnd = nextFrame + 1 < (int)index.size() ? (long long)index[nextFrame + 1].offset : mapping.getSize();
+		mapping.prefetch(next.offset, nextEnd - (long long)next.offset);
+	}
+	return ok;
+}
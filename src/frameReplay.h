@@ -0,0 +1,51 @@
+#pragma once
+
+#include "captureFormat.h"
+#include "frameSource.h"
+#include "mappedFile.h"
+
+#include <vector>
+
+// Plays back a kv2rec recording (see captureFormat.h) from a memory mapping.
+// Raw streams are handed out straight from the mapping, compressed ones are decoded.
+// Native rate follows the recorded timestamps, unthrottled hands out a new frame on every
+// update() which is what the benchmarks want. Loops at the end of the file.
+class ReplayFrameSource : public FrameSource {
+public:
+	ReplayFrameSource(const std::string & path, bool bUnthrottled = false);
+	~ReplayFrameSource();
+
+	bool setup() override;
+	void close() override;
+	bool waitForFrame(int timeoutMillis) override; // sleeps until the next frame is due
+	bool update() override;
+	const KinectFrame & getFrame() const override { return frame; }
+	std::string getName() const override { return "replay " + path; }
+
+	void setUnthrottled(bool bUnthrottled_) { bUnthrottled = bUnthrottled_; }
+	int getNumFrames() const { return (int)index.size(); }
+	bool isIndexed() const { return bIndexed; }
+
+	// Continue playback from the first frame at or after seconds into the recording
+	void seekToTime(double seconds);
+	void seekToFrame(int frameIndex);
+	double getDuration() const;
+	double getPosition() const; // seconds of the next frame
+
+private:
+	void buildIndex();
+	long long microsUntilDue() const; // of the next frame, <= 0 once it can be handed out
+
+	std::string path;
+	bool bUnthrottled;
+	MappedFile mapping;
+	std::vector<CaptureIndexEntry> index;
+	bool bIndexed; // false if the index was rebuilt by scanning the frames
+
+	int nextFrame;
+	long long playStartMicros; // wall clock that maps to the timestamp of playStartFrame
+	int playStartFrame;
+
+	CaptureDecoder decoder;
+	KinectFrame frame;
+};
@@ -0,0 +1,38 @@
+#include "frameSource.h"
+
+#include <chrono>
+#include <thread>
+
+static_assert(sizeof(JointSample) == 10 * 4, "JointSample must not have padding (recording format)");
+static_assert(sizeof(BodySample) == 8 + 4 * 4 + JOINT_COUNT * sizeof(JointSample), "BodySample must not have padding (recording format)");
+
+// JointType values, see the enum copy in ofApp::update()
+const int boneAtlas[BONE_COUNT][2] = {
+	// torso
+	{ 3, 2 }, { 2, 20 }, { 20, 1 }, { 1, 0 },
+	// right arm
+	{ 20, 8 }, { 8, 9 }, { 9, 10 }, { 10, 11 }, { 11, 23 }, { 10, 24 },
+	// left arm
+	{ 20, 4 }, { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 21 }, { 6, 22 },
+	// right leg
+	{ 0, 16 }, { 16, 17 }, { 17, 18 }, { 18, 19 },
+	// left leg
+	{ 0, 12 }, { 12, 13 }, { 13, 14 }, { 14, 15 }
+};
+
+const char * jointNames[JOINT_COUNT] = { "SpineBase", "SpineMid", "Neck", "Head",
+	"ShldrL", "ElbowL", "WristL", "HandL",
+	"ShldrR", "ElbowR", "WristR", "HandR",
+	"HipL", "KneeL", "AnkleL", "FootL",
+	"HipR", "KneeR", "AnkleR", "FootR",
+	"SpineShldr", "HandTipL", "ThumbL", "HandTipR", "ThumbR" };
+
+long long frameSourceMicros() {
+	using namespace std::chrono;
+	return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool FrameSource::waitForFrame(int timeoutMillis) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMillis < 1 ? timeoutMillis : 1));
+	return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+
+// Hardware independent view of one Kinect v2 frame, and the FrameSource interface
+// that ofApp's acquisition thread consumes. Implementations:
+//   KinectFrameSource    - the live sensor (ofxKinectForWindows2, Windows only)
+//   RecordingFrameSource - wraps another source and writes every frame to disk
+//   ReplayFrameSource    - plays a recording back at native or unthrottled rate
+// No openFrameworks / Kinect SDK types in here, so recordings can be replayed headless.
+
+#define DEPTH_WIDTH 512
+#define DEPTH_HEIGHT 424
+#define DEPTH_SIZE (DEPTH_WIDTH * DEPTH_HEIGHT)
+
+#define COLOR_WIDTH 1920
+#define COLOR_HEIGHT 1080
+
+#define KINECT_FPS 30      // depth, color and body frames, recordings keep it
+
+#define BODY_COUNT_MAX 6   // BODY_COUNT in Kinect.h
+#define JOINT_COUNT 25     // JointType_Count
+#define BONE_COUNT 24
+
+// Same values as the Kinect SDK TrackingState
+enum JointTrackingState {
+	JOINT_NOT_TRACKED = 0,
+	JOINT_INFERRED = 1,
+	JOINT_TRACKED = 2
+};
+
+// Laid out without padding so recordings are identical across compilers / 32 + 64 bit
+struct JointSample {
+	float position[3];      // camera space in meters (Joint::getPositionInWorld)
+	float depthPosition[2]; // depth map pixels (Joint::getPositionInDepthMap)
+	float orientation[4];   // quaternion x y z w
+	int trackingState;      // JointTrackingState
+};
+
+struct BodySample {
+	unsigned long long trackingId;
+	int bodyId;
+	int tracked;            // joints are only valid when tracked
+	int leftHandState;      // HandState enum
+	int rightHandState;
+	JointSample joints[JOINT_COUNT]; // indexed by JointType
+};
+
+// Pointers stay valid until the next FrameSource::update()
+struct KinectFrame {
+	unsigned long long frameNumber;
+	long long timestamp; // microseconds, only differences between frames are meaningful
+
+	const unsigned short * depth;     // DEPTH_SIZE, millimeters
+	const unsigned short * infrared;  // DEPTH_SIZE, may be null
+	const unsigned char * bodyIndex;  // DEPTH_SIZE, 0-5 body, 255 background
+	const unsigned char * colorBGRA;  // COLOR_WIDTH * COLOR_HEIGHT * 4
+	const float * colorCoords;        // DEPTH_SIZE {x, y} color space points for every depth pixel
+	BodySample bodies[BODY_COUNT_MAX];
+
+	// what the keying / body output needs, otherwise the cam probably isn't ready yet
+	bool hasAllStreams() const {
+		return depth && bodyIndex && colorBGRA && colorCoords;
+	}
+};
+
+// Joint pairs making up the skeleton, same as the Kinect SDK samples / Body::getBonesAtlas()
+extern const int boneAtlas[BONE_COUNT][2];
+
+// JointType names as sent over OSC, shortened to minimize packet size
+extern const char * jointNames[JOINT_COUNT];
+
+class FrameSource {
+public:
+	virtual ~FrameSource() {}
+
+	virtual bool setup() = 0;
+	virtual void close() {}
+
+	// Block until update() should have a new frame, or timeoutMillis passed (false then).
+	// The default just polls every millisecond.
+	virtual bool waitForFrame(int timeoutMillis);
+	// Poll for a frame, returns true if getFrame() holds a new one
+	virtual bool update() = 0;
+	virtual const KinectFrame & getFrame() const = 0;
+
+	virtual std::string getName() const = 0;
+};
+
+// microseconds on a steady clock, used to timestamp live frames
+long long frameSourceMicros();
@@ -0,0 +1,53 @@
+#include "gpuKeying.h"
+#include "frameSource.h"
+#include "keying.h"
+#include "keyingShaders.h"
+#include "pixelKernels.h"
+
+//--------------------------------------------------------------
+GpuKeying::GpuKeying()
+	: bReady(false) {
+}
+
+bool GpuKeying::load(ofShader & shader, const char * fragment) {
+	return shader.setupShaderFromSource(GL_VERTEX_SHADER, keyingShaderVertex)
+		&& shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragment)
+		&& shader.linkProgram();
+}
+
+bool GpuKeying::setup() {
+	bReady = load(keyed, keyingShaderKeyed) && load(depthRamp, keyingShaderDepth);
+	if (!bReady) ofLogError("kv2") << "Keying shaders didn't compile, keying / depth stay on the cpu";
+	return bReady;
+}
+
+//--------------------------------------------------------------
+// The quad is the first texture drawn at depth size, its texture coordinates are the depth pixels.
+// No blending, the alpha of the output is written as is.
+void GpuKeying::drawKeyed(ofTexture & bodyIndex, ofTexture & colorCoords, ofTexture & color) {
+	ofPushStyle();
+	ofDisableBlendMode();
+	keyed.begin();
+	keyed.setUniformTexture("bodyIndex", bodyIndex, 1);
+	keyed.setUniformTexture("colorCoords", colorCoords, 2);
+	keyed.setUniformTexture("color", color, 3);
+	keyed.setUniform2f("colorSize", (float)COLOR_WIDTH, (float)COLOR_HEIGHT);
+	keyed.setUniform1f("maxBodies", (float)KEYING_MAX_BODIES);
+	bodyIndex.draw(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT);
+	keyed.end();
+	ofPopStyle();
+}
+
+void GpuKeying::drawDepth(ofTexture & depth, int nearMm, int farMm) {
+	DepthRamp ramp(nearMm, farMm);
+	ofPushStyle();
+	ofDisableBlendMode();
+	depthRamp.begin();
+	depthRamp.setUniformTexture("depth", depth, 1);
+	depthRamp.setUniform1f("nearMm", (float)ramp.nearMm);
+	depthRamp.setUniform1f("range", (float)ramp.range);
+	depthRamp.setUniform1f("scale", (float)ramp.scale);
+	depth.draw(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT);
+	depthRamp.end();
+	ofPopStyle();
+}
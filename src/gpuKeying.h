@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Keyed composite and depth colorization in fragment shaders (keyingShaders.h), drawn into
+// whatever fbo is bound. The textures are the uploaded Kinect planes, rectangle textures with
+// GL_NEAREST filtering so every texel is read back as is:
+//   bodyIndex   : 8 bit, DEPTH_WIDTH x DEPTH_HEIGHT
+//   colorCoords : GL_RG32F, the depth -> color mapping
+//   color       : the BGRA color frame
+//   depth       : 16 bit
+// Output matches keyBodies() / colorizeDepth() byte for byte, bench/shaderCheck.cpp checks that.
+
+class GpuKeying {
+public:
+	GpuKeying();
+
+	// false if the shaders don't compile / link, callers stay on the cpu path then
+	bool setup();
+	bool isReady() const { return bReady; }
+
+	void drawKeyed(ofTexture & bodyIndex, ofTexture & colorCoords, ofTexture & color);
+	void drawDepth(ofTexture & depth, int nearMm, int farMm);
+
+private:
+	bool load(ofShader & shader, const char * fragment);
+
+	ofShader keyed;
+	ofShader depthRamp;
+	bool bReady;
+};
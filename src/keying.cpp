@@ -0,0 +1,229 @@
+#include "keying.h"
+#include "simd.h"
+#include "workerPool.h"
+
+#include <cstring>
+
+// Mapped color coordinates come out as floats (not a 1:1 mapping between depth <-> color),
+// the original loop did floor() + a bounds check. For x >= 0 truncation is the same as floor,
+// so every path checks 0 <= x < width in float and then truncates.
+// Invalid mappings are -infinity, NaN fails every compare too, so both are skipped.
+
+static inline unsigned int load32(const unsigned char * p) {
+	unsigned int v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static inline void store32(unsigned char * p, unsigned int v) {
+	memcpy(p, &v, 4);
+}
+
+// BGRA bytes (0xAARRGGBB little endian) -> RGBA bytes (0xAABBGGRR)
+static inline unsigned int bgraToRgba(unsigned int p) {
+	return (p & 0xFF00FF00u) | ((p >> 16) & 0xFFu) | ((p & 0xFFu) << 16);
+}
+
+//--------------------------------------------------------------
+static void keyRangeScalar(const KeyingFrame & f, int begin, int end) {
+	const float colorW = (float)f.colorWidth;
+	const float colorH = (float)f.colorHeight;
+
+	for (int i = begin; i < end; i++) {
+		unsigned int px = 0; // transparent black
+
+		if (f.bodyIndex[i] < KEYING_MAX_BODIES) {
+			float x = f.colorCoords[i * 2];
+			float y = f.colorCoords[i * 2 + 1];
+			if (x >= 0.0f && x < colorW && y >= 0.0f && y < colorH) {
+				int offset = (int)y * f.colorWidth + (int)x;
+				px = bgraToRgba(load32(f.colorBGRA + offset * 4));
+			}
+		}
+		store32(f.outRGBA + i * 4, px);
+	}
+}
+
+void keyBodiesScalar(const KeyingFrame & f, int rowBegin, int rowEnd) {
+	keyRangeScalar(f, rowBegin * f.depthWidth, rowEnd * f.depthWidth);
+}
+
+//--------------------------------------------------------------
+// SSE2 has no gather: the masks, bounds and offsets are done 4 wide,
+// the color fetch is 4 scalar loads, swizzle + store are vector again.
+void keyBodiesSSE2(const KeyingFrame & f, int rowBegin, int rowEnd) {
+#if SIMD_X86
+	const int n = rowEnd * f.depthWidth;
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 colorW = _mm_set1_ps((float)f.colorWidth);
+	const __m128 colorH = _mm_set1_ps((float)f.colorHeight);
+	const __m128i maxBodies = _mm_set1_epi32(KEYING_MAX_BODIES);
+	const __m128i keepAG = _mm_set1_epi32((int)0xFF00FF00);
+	const __m128i lowByte = _mm_set1_epi32(0xFF);
+
+	int i = rowBegin * f.depthWidth;
+	for (; i + 4 <= n; i += 4) {
+		// 4 body index bytes -> 4 x int32
+		int idx4;
+		memcpy(&idx4, f.bodyIndex + i, 4);
+		__m128i idx = _mm_cvtsi32_si128(idx4);
+		idx = _mm_unpacklo_epi8(idx, _mm_setzero_si128());
+		idx = _mm_unpacklo_epi16(idx, _mm_setzero_si128());
+		__m128i bodyMask = _mm_cmplt_epi32(idx, maxBodies);
+
+		// x0 y0 x1 y1 | x2 y2 x3 y3 -> x0 x1 x2 x3, y0 y1 y2 y3
+		__m128 xy01 = _mm_loadu_ps(f.colorCoords + i * 2);
+		__m128 xy23 = _mm_loadu_ps(f.colorCoords + i * 2 + 4);
+		__m128 x = _mm_shuffle_ps(xy01, xy23, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 y = _mm_shuffle_ps(xy01, xy23, _MM_SHUFFLE(3, 1, 3, 1));
+
+		__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(x, zero), _mm_cmplt_ps(x, colorW)),
+			_mm_and_ps(_mm_cmpge_ps(y, zero), _mm_cmplt_ps(y, colorH)));
+		__m128i mask = _mm_and_si128(bodyMask, _mm_castps_si128(inside));
+
+		int bits = _mm_movemask_ps(_mm_castsi128_ps(mask));
+		if (bits == 0) {
+			_mm_storeu_si128((__m128i *)(f.outRGBA + i * 4), _mm_setzero_si128());
+			continue;
+		}
+
+		// truncate, then y * width + x in float: exact since 1920 * 1080 < 2^24 (no pmulld in SSE2)
+		__m128 fx = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+		__m128 fy = _mm_cvtepi32_ps(_mm_cvttps_epi32(y));
+		__m128i offset = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(fy, colorW), fx));
+
+		alignas(16) int off[4];
+		alignas(16) unsigned int px[4];
+		_mm_store_si128((__m128i *)off, offset);
+		for (int k = 0; k < 4; k++) {
+			px[k] = (bits >> k) & 1 ? load32(f.colorBGRA + off[k] * 4) : 0;
+		}
+
+		// BGRA -> RGBA without pshufb (SSSE3)
+		__m128i p = _mm_load_si128((const __m128i *)px);
+		p = _mm_or_si128(_mm_and_si128(p, keepAG),
+			_mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), lowByte),
+				_mm_slli_epi32(_mm_and_si128(p, lowByte), 16)));
+		_mm_storeu_si128((__m128i *)(f.outRGBA + i * 4), p);
+	}
+	keyRangeScalar(f, i, n);
+#else
+	keyBodiesScalar(f, rowBegin, rowEnd);
+#endif
+}
+
+//--------------------------------------------------------------
+// AVX2: 8 pixels per step, masked hardware gather from the color plane
+SIMD_TARGET_AVX2 void keyBodiesAVX2(const KeyingFrame & f, int rowBegin, int rowEnd) {
+#if SIMD_X86
+	const int n = rowEnd * f.depthWidth;
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 colorW = _mm256_set1_ps((float)f.colorWidth);
+	const __m256 colorH = _mm256_set1_ps((float)f.colorHeight);
+	const __m256i stride = _mm256_set1_epi32(f.colorWidth);
+	const __m256i maxBodies = _mm256_set1_epi32(KEYING_MAX_BODIES);
+	const __m256i bgraToRgbaShuffle = _mm256_setr_epi8(
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+	int i = rowBegin * f.depthWidth;
+	for (; i + 8 <= n; i += 8) {
+		__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(f.bodyIndex + i)));
+		__m256i bodyMask = _mm256_cmpgt_epi32(maxBodies, idx);
+
+		// shuffle_ps works per 128 bit lane: gives x0 x1 x4 x5 | x2 x3 x6 x7, permute fixes the order
+		__m256 a = _mm256_loadu_ps(f.colorCoords + i * 2);
+		__m256 b = _mm256_loadu_ps(f.colorCoords + i * 2 + 8);
+		__m256 x = _mm256_castpd_ps(_mm256_permute4x64_pd(
+			_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+		__m256 y = _mm256_castpd_ps(_mm256_permute4x64_pd(
+			_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+
+		__m256 inside = _mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(x, zero, _CMP_GE_OQ), _mm256_cmp_ps(x, colorW, _CMP_LT_OQ)),
+			_mm256_and_ps(_mm256_cmp_ps(y, zero, _CMP_GE_OQ), _mm256_cmp_ps(y, colorH, _CMP_LT_OQ)));
+		__m256i mask = _mm256_and_si256(bodyMask, _mm256_castps_si256(inside));
+
+		if (_mm256_testz_si256(mask, mask)) {
+			_mm256_storeu_si256((__m256i *)(f.outRGBA + i * 4), _mm256_setzero_si256());
+			continue;
+		}
+
+		__m256i offset = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvttps_epi32(y), stride), _mm256_cvttps_epi32(x));
+		offset = _mm256_and_si256(offset, mask); // masked lanes aren't loaded, keep them harmless anyway
+
+		__m256i p = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *)f.colorBGRA, offset, mask, 4);
+		p = _mm256_shuffle_epi8(p, bgraToRgbaShuffle);
+		_mm256_storeu_si256((__m256i *)(f.outRGBA + i * 4), p);
+	}
+	keyRangeScalar(f, i, n);
+#else
+	keyBodiesScalar(f, rowBegin, rowEnd);
+#endif
+}
+
+//--------------------------------------------------------------
+bool keyingPathSupported(KeyingPath path) {
+	switch (path) {
+	case KEYING_AUTO:
+	case KEYING_SCALAR:
+		return true;
+	case KEYING_SSE2:
+		return simdHasSSE2();
+	case KEYING_AVX2:
+		return simdHasAVX2();
+	}
+	return false;
+}
+
+KeyingPath keyingBestPath() {
+	if (simdHasAVX2()) return KEYING_AVX2;
+	if (simdHasSSE2()) return KEYING_SSE2;
+	return KEYING_SCALAR;
+}
+
+const char * keyingPathName(KeyingPath path) {
+	switch (path) {
+	case KEYING_AUTO:
+		return keyingPathName(keyingBestPath());
+	case KEYING_SCALAR:
+		return "scalar";
+	case KEYING_SSE2:
+		return "SSE2";
+	case KEYING_AVX2:
+		return "AVX2";
+	}
+	return "unknown";
+}
+
+//--------------------------------------------------------------
+void keyBodiesRows(const KeyingFrame & frame, int rowBegin, int rowEnd, KeyingPath path) {
+	if (path == KEYING_AUTO || !keyingPathSupported(path)) {
+		path = keyingBestPath();
+	}
+
+	switch (path) {
+	case KEYING_AVX2:
+		keyBodiesAVX2(frame, rowBegin, rowEnd);
+		break;
+	case KEYING_SSE2:
+		keyBodiesSSE2(frame, rowBegin, rowEnd);
+		break;
+	default:
+		keyBodiesScalar(frame, rowBegin, rowEnd);
+		break;
+	}
+}
+
+void keyBodies(const KeyingFrame & frame, KeyingPath path) {
+	keyBodiesRows(frame, 0, frame.depthHeight, path);
+}
+
+void keyBodiesParallel(const KeyingFrame & frame, WorkerPool & pool, KeyingPath path) {
+	const int numTiles = (frame.depthHeight + KEYING_TILE_ROWS - 1) / KEYING_TILE_ROWS;
+	pool.run(numTiles, [&](int tile) {
+		int rowBegin = tile * KEYING_TILE_ROWS;
+		int rowEnd = rowBegin + KEYING_TILE_ROWS < frame.depthHeight ? rowBegin + KEYING_TILE_ROWS : frame.depthHeight;
+		keyBodiesRows(frame, rowBegin, rowEnd, path);
+	});
+}
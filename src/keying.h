@@ -0,0 +1,49 @@
+#pragma once
+
+// Depth -> color keying kernel (the "Keyed" stream)
+// For every depth pixel that belongs to a tracked body, look up the mapped color pixel
+// and write it to the output, everything else becomes transparent black.
+//
+// Inputs are the raw Kinect planes, no openFrameworks types:
+//   bodyIndex   : depthWidth * depthHeight bytes, 0-5 = body id, anything else (255) = background
+//   colorCoords : depthWidth * depthHeight ColorSpacePoint {x, y} float pairs (MapDepthFrameToColorSpace)
+//   colorBGRA   : colorWidth * colorHeight * 4 bytes, as delivered by the Kinect color source
+//   outRGBA     : depthWidth * depthHeight * 4 bytes
+
+#define KEYING_MAX_BODIES 6 // body index values below this are bodies
+#define KEYING_TILE_ROWS 16 // depth rows per tile when keying on a WorkerPool
+
+class WorkerPool;
+
+struct KeyingFrame {
+	const unsigned char * bodyIndex;
+	const float * colorCoords;
+	const unsigned char * colorBGRA;
+	unsigned char * outRGBA;
+	int depthWidth;
+	int depthHeight;
+	int colorWidth;
+	int colorHeight;
+};
+
+enum KeyingPath {
+	KEYING_AUTO = 0, // best path the cpu supports
+	KEYING_SCALAR,   // reference implementation
+	KEYING_SSE2,
+	KEYING_AVX2
+};
+
+// Key the whole frame with the requested path (falls back to the best supported path)
+void keyBodies(const KeyingFrame & frame, KeyingPath path = KEYING_AUTO);
+// Key depth rows [rowBegin, rowEnd) only, rows are independent so tiles can run in parallel
+void keyBodiesRows(const KeyingFrame & frame, int rowBegin, int rowEnd, KeyingPath path = KEYING_AUTO);
+// Split the frame into KEYING_TILE_ROWS tiles on the pool, returns when every tile is done
+void keyBodiesParallel(const KeyingFrame & frame, WorkerPool & pool, KeyingPath path = KEYING_AUTO);
+
+void keyBodiesScalar(const KeyingFrame & frame, int rowBegin, int rowEnd);
+void keyBodiesSSE2(const KeyingFrame & frame, int rowBegin, int rowEnd);
+void keyBodiesAVX2(const KeyingFrame & frame, int rowBegin, int rowEnd);
+
+bool keyingPathSupported(KeyingPath path);
+KeyingPath keyingBestPath();
+const char * keyingPathName(KeyingPath path);
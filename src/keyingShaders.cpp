@@ -0,0 +1,52 @@
+#include "keyingShaders.h"
+
+#define GLSL(source) "#version 120\n#extension GL_ARB_texture_rectangle : enable\n" #source
+
+// pass through, works with the fixed function pipeline of the GL 2.1 window too
+const char * const keyingShaderVertex = GLSL(
+void main() {
+	gl_TexCoord[0] = gl_MultiTexCoord0;
+	gl_Position = ftransform();
+}
+);
+
+// floor(index * 255 + 0.5) recovers the byte, floor(x) + 0.5 is the center of the texel the
+// CPU path truncates to (x >= 0 there). -inf mappings fail the bounds checks.
+const char * const keyingShaderKeyed = GLSL(
+uniform sampler2DRect bodyIndex;
+uniform sampler2DRect colorCoords;
+uniform sampler2DRect color;
+uniform vec2 colorSize;
+uniform float maxBodies;
+
+void main() {
+	vec2 p = gl_TexCoord[0].xy;
+	float index = floor(texture2DRect(bodyIndex, p).r * 255.0 + 0.5);
+	vec2 c = texture2DRect(colorCoords, p).rg;
+	if (index < maxBodies && c.x >= 0.0 && c.x < colorSize.x && c.y >= 0.0 && c.y < colorSize.y) {
+		gl_FragColor = texture2DRect(color, floor(c) + 0.5);
+	}
+	else {
+		gl_FragColor = vec4(0.0);
+	}
+}
+);
+
+// t * scale stays below 2^24 (DepthRamp), so every step is exact in float
+const char * const keyingShaderDepth = GLSL(
+uniform sampler2DRect depth;
+uniform float nearMm;
+uniform float range;
+uniform float scale;
+
+void main() {
+	float d = floor(texture2DRect(depth, gl_TexCoord[0].xy).r * 65535.0 + 0.5);
+	if (d == 0.0) {
+		gl_FragColor = vec4(0.0);
+		return;
+	}
+	float t = clamp(d - nearMm, 0.0, range);
+	float gray = 255.0 - floor(t * scale / 65536.0);
+	gl_FragColor = vec4(vec3(gray / 255.0), 1.0);
+}
+);
@@ -0,0 +1,18 @@
+#pragma once
+
+// GLSL for the GPU keying / depth path (gpuKeying.h), kept free of openFrameworks so the
+// standalone check in bench/ can compile the very same sources under a software GL.
+// GLSL 1.20 with rectangle textures (openFrameworks' default, texture coordinates in pixels),
+// drawn as one quad over the 512x424 depth frame with the depth pixel in gl_TexCoord[0].
+// Every texture is sampled with GL_NEAREST so each texel comes back exactly.
+//
+// Both match the CPU reference byte for byte (keyBodies() and colorizeDepth()):
+//   keyed : body index < KEYING_MAX_BODIES and the mapped color point inside the color frame ->
+//           that color texel, anything else transparent black.
+//           bodyIndex (8 bit), colorCoords (RG 32 bit float), color (BGRA upload reads as RGBA)
+//   depth : the DepthRamp gray ramp (pixelKernels.h), no reading (0) transparent black.
+//           depth (16 bit normalized), nearMm / range / scale from DepthRamp as floats
+
+extern const char * const keyingShaderVertex;
+extern const char * const keyingShaderKeyed;
+extern const char * const keyingShaderDepth;
@@ -0,0 +1,133 @@
+#include "kinectFrameSource.h"
+
+//--------------------------------------------------------------
+KinectFrameSource::KinectFrameSource()
+	: coordinateMapper(nullptr)
+	, frameArrived(0)
+	, mappingMicros(0)
+	, bLongExposure(false) {
+	memset(&frame, 0, sizeof(frame));
+}
+
+//--------------------------------------------------------------
+bool KinectFrameSource::setup() {
+	kinect.open();
+	kinect.initDepthSource();
+	kinect.initColorSource();
+	kinect.initInfraredSource();
+	kinect.initLongExposureInfraredSource();
+	kinect.initBodySource();
+	kinect.initBodyIndexSource();
+
+	kinect.getDepthSource()->setUseTexture(false);
+	kinect.getColorSource()->setUseTexture(false);
+	kinect.getInfraredSource()->setUseTexture(false);
+	kinect.getLongExposureInfraredSource()->setUseTexture(false);
+	kinect.getBodyIndexSource()->setUseTexture(false);
+
+	// added for coordmapping
+	if (kinect.getSensor()->get_CoordinateMapper(&coordinateMapper) < 0) {
+		ofLogError() << "Could not acquire CoordinateMapper!";
+		coordinateMapper = nullptr;
+	}
+	colorCoords.resize(DEPTH_SIZE);
+
+	// depth, body index and body frames come together, color within a few ms.
+	// Without the event waitForFrame() falls back to polling.
+	IDepthFrameReader * reader = kinect.getDepthSource()->getReader();
+	if (!reader || reader->SubscribeFrameArrived(&frameArrived) < 0) {
+		ofLogWarning() << "Could not subscribe to depth frames, polling";
+		frameArrived = 0;
+	}
+
+	return coordinateMapper != nullptr;
+}
+
+void KinectFrameSource::close() {
+	if (frameArrived) {
+		kinect.getDepthSource()->getReader()->UnsubscribeFrameArrived(frameArrived);
+		frameArrived = 0;
+	}
+	kinect.close();
+}
+
+//--------------------------------------------------------------
+bool KinectFrameSource::waitForFrame(int timeoutMillis) {
+	if (!frameArrived) return FrameSource::waitForFrame(timeoutMillis);
+	if (WaitForSingleObject(reinterpret_cast<HANDLE>(frameArrived), timeoutMillis) != WAIT_OBJECT_0) return false;
+
+	// taking the event data resets the event
+	IDepthFrameArrivedEventArgs * args = nullptr;
+	if (kinect.getDepthSource()->getReader()->GetFrameArrivedEventData(frameArrived, &args) >= 0 && args) {
+		args->Release();
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+bool KinectFrameSource::update() {
+	kinect.update();
+
+	// Get pixel data
+	auto& depthPix = kinect.getDepthSource()->getPixels();
+	auto& bodyIndexPix = kinect.getBodyIndexSource()->getPixels();
+	auto& colorPix = kinect.getColorSource()->getPixels();
+	auto& infraredPix = bLongExposure ? kinect.getLongExposureInfraredSource()->getPixels() : kinect.getInfraredSource()->getPixels();
+
+	// Make sure there's some data here, otherwise the cam probably isn't ready yet
+	if (!depthPix.size() || !bodyIndexPix.size() || !colorPix.size() || !coordinateMapper) {
+		frame.depth = nullptr;
+		return false;
+	}
+
+	// Do the depth space -> color space mapping
+	// More info here:
+	// https://msdn.microsoft.com/en-us/library/windowspreview.kinect.coordinatemapper.mapdepthframetocolorspace.aspx
+	// https://msdn.microsoft.com/en-us/library/dn785530.aspx
+	StageTimers::Clock::time_point mappingStart = StageTimers::Clock::now();
+	coordinateMapper->MapDepthFrameToColorSpace(DEPTH_SIZE, (UINT16*)depthPix.getData(), DEPTH_SIZE, colorCoords.data());
+	mappingMicros = StageTimers::microsSince(mappingStart);
+
+	frame.frameNumber++;
+	frame.timestamp = frameSourceMicros();
+	frame.depth = depthPix.getData();
+	frame.infrared = infraredPix.size() ? infraredPix.getData() : nullptr;
+	frame.bodyIndex = bodyIndexPix.getData();
+	frame.colorBGRA = colorPix.getData();
+	frame.colorCoords = (const float*)colorCoords.data(); // ColorSpacePoint is {float X, float Y}
+
+	// untracked bodies have no joints in the addon, keep ours zeroed too
+	auto& bodies = kinect.getBodySource()->getBodies();
+	for (int i = 0; i < BODY_COUNT_MAX; i++) {
+		BodySample & sample = frame.bodies[i];
+		memset(&sample, 0, sizeof(sample));
+		sample.bodyId = i;
+		if (i >= (int)bodies.size()) continue;
+
+		auto& body = bodies[i];
+		sample.bodyId = body.bodyId;
+		sample.trackingId = body.trackingId;
+		sample.tracked = body.tracked;
+		sample.leftHandState = body.leftHandState;
+		sample.rightHandState = body.rightHandState;
+
+		for (auto& joint : body.joints) {
+			JointSample & j = sample.joints[joint.first];
+			ofVec3f pos = joint.second.getPositionInWorld();
+			ofVec2f depthPos = joint.second.getPositionInDepthMap();
+			ofVec4f orientation = joint.second.getOrientation().asVec4();
+			j.position[0] = pos.x;
+			j.position[1] = pos.y;
+			j.position[2] = pos.z;
+			j.depthPosition[0] = depthPos.x;
+			j.depthPosition[1] = depthPos.y;
+			j.orientation[0] = orientation.x;
+			j.orientation[1] = orientation.y;
+			j.orientation[2] = orientation.z;
+			j.orientation[3] = orientation.w;
+			j.trackingState = joint.second.getTrackingState();
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "frameSource.h"
+#include "stageTimers.h"
+#include "ofxKinectForWindows2.h"
+
+#include <vector>
+
+// Live Kinect v2 through ofxKinectForWindows2.
+// The addon's texture uploads are switched off, ofApp uploads from the KinectFrame
+// so live and replayed frames are drawn the same way. Nothing here touches GL, so it can
+// run on the acquisition thread: waitForFrame() blocks on the depth reader's frame arrived event.
+class KinectFrameSource : public FrameSource {
+public:
+	KinectFrameSource();
+
+	bool setup() override;
+	void close() override;
+	bool waitForFrame(int timeoutMillis) override;
+	bool update() override;
+	const KinectFrame & getFrame() const override { return frame; }
+	std::string getName() const override { return "Kinect v2"; }
+
+	ofxKFW2::Device & getDevice() { return kinect; }
+	float getMappingMicros() const { return mappingMicros; } // of the last update()
+	// infrared from the long exposure reader (less noise in the dark, blurs motion), from the next update()
+	void setLongExposureInfrared(bool bLongExposure_) { bLongExposure = bLongExposure_; }
+
+private:
+	ofxKFW2::Device kinect;
+	ICoordinateMapper * coordinateMapper;
+	WAITABLE_HANDLE frameArrived; // depth reader event, 0 if the subscription failed
+	std::vector<ColorSpacePoint> colorCoords;
+	float mappingMicros;
+	bool bLongExposure;
+	KinectFrame frame;
+};
@@ -0,0 +1,153 @@
+#include "lz4.h"
+
+#include <cstring>
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5 // the last 5 bytes of a block are always literals
+#define LZ4_MF_LIMIT 12     // and the last match starts at least 12 bytes before the end
+#define LZ4_MAX_DISTANCE 65535
+#define LZ4_HASH_LOG 12     // 16KB table, same as the reference default
+
+static inline unsigned int read32(const unsigned char * p) {
+	unsigned int v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static inline unsigned int hash32(unsigned int v) {
+	return (v * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+// 15 in the token nibble, the rest as a run of 255s
+static inline unsigned char * writeLength(unsigned char * op, int length) {
+	for (length -= 15; length >= 255; length -= 255) {
+		*op++ = 255;
+	}
+	*op++ = (unsigned char)length;
+	return op;
+}
+
+static unsigned char * writeSequence(unsigned char * op, const unsigned char * literals, int literalLength, int offset, int matchLength) {
+	unsigned char * token = op++;
+	*token = (unsigned char)((literalLength < 15 ? literalLength : 15) << 4);
+	if (literalLength >= 15) op = writeLength(op, literalLength);
+	if (literalLength) memcpy(op, literals, literalLength);
+	op += literalLength;
+
+	if (matchLength == 0) return op; // last sequence, literals only
+
+	*op++ = (unsigned char)(offset & 0xFF);
+	*op++ = (unsigned char)(offset >> 8);
+	int length = matchLength - LZ4_MIN_MATCH;
+	*token |= (unsigned char)(length < 15 ? length : 15);
+	if (length >= 15) op = writeLength(op, length);
+	return op;
+}
+
+//--------------------------------------------------------------
+int lz4Compress(const unsigned char * src, int srcSize, unsigned char * dst, int dstCapacity) {
+	if (srcSize < 0 || dstCapacity < lz4CompressBound(srcSize)) return -1;
+
+	unsigned char * op = dst;
+	int anchor = 0;
+
+	if (srcSize > LZ4_MF_LIMIT) {
+		int table[1 << LZ4_HASH_LOG];
+		memset(table, 0xFF, sizeof(table)); // -1, no candidate
+
+		const int matchStartLimit = srcSize - LZ4_MF_LIMIT;
+		const int matchEndLimit = srcSize - LZ4_LAST_LITERALS;
+		int ip = 0;
+		int misses = 0;
+		while (ip <= matchStartLimit) {
+			unsigned int sequence = read32(src + ip);
+			unsigned int h = hash32(sequence);
+			int ref = table[h];
+			table[h] = ip;
+
+			if (ref < 0 || ip - ref > LZ4_MAX_DISTANCE || read32(src + ref) != sequence) {
+				// skip faster through data that doesn't compress
+				ip += 1 + (misses++ >> 6);
+				continue;
+			}
+			misses = 0;
+
+			while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+				ip--;
+				ref--;
+			}
+			int length = LZ4_MIN_MATCH;
+			while (ip + length < matchEndLimit && src[ref + length] == src[ip + length]) {
+				length++;
+			}
+
+			op = writeSequence(op, src + anchor, ip - anchor, ip - ref, length);
+			ip += length;
+			anchor = ip;
+			if (ip <= matchStartLimit) table[hash32(read32(src + ip - 2))] = ip - 2;
+		}
+	}
+
+	op = writeSequence(op, src + anchor, srcSize - anchor, 0, 0);
+	return (int)(op - dst);
+}
+
+//--------------------------------------------------------------
+// reads the extra length bytes following a 15 nibble, -1 on truncated input
+static inline int readLength(const unsigned char * src, int srcSize, int & ip) {
+	int length = 0;
+	unsigned char b;
+	do {
+		if (ip >= srcSize) return -1;
+		b = src[ip++];
+		length += b;
+	} while (b == 255);
+	return length;
+}
+
+int lz4Decompress(const unsigned char * src, int srcSize, unsigned char * dst, int dstSize) {
+	int ip = 0;
+	int op = 0;
+	while (true) {
+		if (ip >= srcSize) return -1;
+		unsigned char token = src[ip++];
+
+		int literalLength = token >> 4;
+		if (literalLength == 15) {
+			int extra = readLength(src, srcSize, ip);
+			if (extra < 0) return -1;
+			literalLength += extra;
+		}
+		if (literalLength > srcSize - ip || literalLength > dstSize - op) return -1;
+		if (literalLength) memcpy(dst + op, src + ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+
+		if (ip == srcSize) return op; // last sequence has no match
+
+		if (srcSize - ip < 2) return -1;
+		int offset = src[ip] | (src[ip + 1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > op) return -1;
+
+		int matchLength = token & 15;
+		if (matchLength == 15) {
+			int extra = readLength(src, srcSize, ip);
+			if (extra < 0) return -1;
+			matchLength += extra;
+		}
+		matchLength += LZ4_MIN_MATCH;
+		if (matchLength > dstSize - op) return -1;
+
+		unsigned char * d = dst + op;
+		const unsigned char * s = d - offset;
+		if (offset >= matchLength) {
+			memcpy(d, s, matchLength);
+		}
+		else {
+			// overlapping, repeats the last offset bytes
+			for (int i = 0; i < matchLength; i++) d[i] = s[i];
+		}
+		op += matchLength;
+	}
+}
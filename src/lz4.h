@@ -0,0 +1,15 @@
+#pragma once
+
+// Minimal LZ4 block codec (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md),
+// just enough for the capture files. Output is a plain LZ4 block, readable by any LZ4
+// implementation, there's no frame / checksum around it.
+
+// worst case compressed size for srcSize input bytes
+inline int lz4CompressBound(int srcSize) { return srcSize + srcSize / 255 + 16; }
+
+// Returns the compressed size, or -1 if dstCapacity < lz4CompressBound(srcSize)
+int lz4Compress(const unsigned char * src, int srcSize, unsigned char * dst, int dstCapacity);
+
+// Returns the decompressed size, or -1 if src is corrupt or doesn't fit dstSize.
+// Never reads or writes outside the given buffers.
+int lz4Decompress(const unsigned char * src, int srcSize, unsigned char * dst, int dstSize);
@@ -1,8 +1,37 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "bench.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char *argv[]){
+	string replayPath;
+	bool bReplayUnthrottled = false;
+	double replayStartSeconds = 0;
+	bool bHeadless = false;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--bench") {
+			// headless cpu benchmarks, no window / Kinect needed
+			return runBenchmarks(argc, argv);
+		}
+		else if (arg == "--replay" && i + 1 < argc) {
+			// play a recording instead of the live Kinect
+			replayPath = argv[++i];
+		}
+		else if (arg == "--unthrottled") {
+			bReplayUnthrottled = true;
+		}
+		else if (arg == "--seek" && i + 1 < argc) {
+			// start the replay this many seconds in
+			replayStartSeconds = atof(argv[++i]);
+		}
+		else if (arg == "--headless") {
+			// capture box mode: no preview, GUI or overlays, only the enabled outputs run
+			bHeadless = true;
+		}
+	}
+
 	// this kicks off the running of my app
 	// can be OF_WINDOW or OF_FULLSCREEN
 	// pass in width and height too:
@@ -16,7 +45,18 @@ int main( ){
 	//settings.iconified = true;
 	settings.resizable = false;
 	settings.setSize(1680, 1050);
+	if (bHeadless) {
+		// still needs a GL context for the settings panel and the Spout / NDI fbos, but nothing is shown
+		settings.visible = false;
+		settings.setSize(DEPTH_WIDTH, DEPTH_HEIGHT);
+	}
 	ofCreateWindow(settings);
-	return ofRunApp(new ofApp);
+
+	ofApp * app = new ofApp;
+	app->replayPath = replayPath;
+	app->bReplayUnthrottled = bReplayUnthrottled;
+	app->replayStartSeconds = replayStartSeconds;
+	app->bHeadless = bHeadless;
+	return ofRunApp(app);
 
 }
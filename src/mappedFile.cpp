@@ -0,0 +1,131 @@
+#include "mappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//--------------------------------------------------------------
+MappedFile::MappedFile()
+	: data(nullptr)
+	, size(0)
+#ifdef _WIN32
+	, fileHandle(INVALID_HANDLE_VALUE)
+	, mappingHandle(nullptr)
+#else
+	, fd(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+#ifdef _WIN32
+//--------------------------------------------------------------
+bool MappedFile::open(const std::string & path) {
+	close();
+
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0
+		|| (unsigned long long)fileSize.QuadPart > (size_t)-1) {
+		close();
+		return false;
+	}
+	size = fileSize.QuadPart;
+
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mappingHandle) {
+		close();
+		return false;
+	}
+	data = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close() {
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+	data = nullptr;
+	mappingHandle = nullptr;
+	fileHandle = INVALID_HANDLE_VALUE;
+	size = 0;
+}
+
+void MappedFile::prefetch(long long offset, long long length) const {
+	// PrefetchVirtualMemory needs Windows 8, look it up so the app still starts on 7
+	// (and declare the range ourselves, the SDK hides it below _WIN32_WINNT 0x0602)
+	struct MemoryRange {
+		PVOID VirtualAddress;
+		SIZE_T NumberOfBytes;
+	};
+	typedef BOOL(WINAPI * PrefetchFn)(HANDLE, ULONG_PTR, MemoryRange *, ULONG);
+	static PrefetchFn prefetchFn = (PrefetchFn)GetProcAddress(GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory");
+	if (!data || !prefetchFn || offset < 0 || offset >= size) return;
+	if (length > size - offset) length = size - offset;
+
+	MemoryRange range;
+	range.VirtualAddress = (PVOID)(data + offset);
+	range.NumberOfBytes = (SIZE_T)length;
+	prefetchFn(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+//--------------------------------------------------------------
+bool MappedFile::open(const std::string & path) {
+	close();
+
+	fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close();
+		return false;
+	}
+	size = st.st_size;
+
+	void * p = mmap(nullptr, (size_t)size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		close();
+		return false;
+	}
+	data = (const unsigned char*)p;
+	madvise(p, (size_t)size, MADV_SEQUENTIAL);
+	return true;
+}
+
+void MappedFile::close() {
+	if (data) munmap((void*)data, (size_t)size);
+	if (fd >= 0) ::close(fd);
+	data = nullptr;
+	fd = -1;
+	size = 0;
+}
+
+void MappedFile::prefetch(long long offset, long long length) const {
+	if (!data || offset < 0 || offset >= size) return;
+	if (length > size - offset) length = size - offset;
+
+	// madvise wants a page aligned start
+	long long page = sysconf(_SC_PAGESIZE);
+	long long start = offset / page * page;
+	madvise((void*)(data + start), (size_t)(length + offset - start), MADV_WILLNEED);
+}
+#endif
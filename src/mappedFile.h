@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+// Read only memory mapping of a whole file (CreateFileMapping on Windows, mmap elsewhere).
+// Pages are loaded on first touch, so opening a multi GB recording is instant.
+// 32 bit builds can only map files that fit in their address space.
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const std::string & path);
+	void close();
+
+	bool isOpen() const { return data != nullptr; }
+	const unsigned char * getData() const { return data; }
+	long long getSize() const { return size; }
+
+	// hint that [offset, offset + length) is needed soon, e.g. the next frame
+	void prefetch(long long offset, long long length) const;
+
+private:
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+
+	const unsigned char * data;
+	long long size;
+#ifdef _WIN32
+	void * fileHandle;
+	void * mappingHandle;
+#else
+	int fd;
+#endif
+};
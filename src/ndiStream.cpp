@@ -0,0 +1,220 @@
+#include "ndiStream.h"
+#include "pixelKernels.h"
+
+//--------------------------------------------------------------
+NdiStream::NdiStream()
+	: sender(nullptr)
+	, width(0)
+	, height(0)
+	, format(NDI_FORMAT_RGBA)
+	, bSetup(false)
+	, bAsync(false)
+	, lateMicros(1000000 / KINECT_FPS)
+	, frameRate(KINECT_FPS)
+	, latencyTimers(nullptr)
+	, latencyStage(0)
+	, fillSlot(-1)
+	, spareSlot(-1)
+	, bQuit(false)
+	, framesSent(0)
+	, framesDropped(0)
+	, framesLate(0) {
+}
+
+NdiStream::~NdiStream() {
+	close();
+}
+
+//--------------------------------------------------------------
+bool NdiStream::setup(const string & name_, int width_, int height_, int ringSize, bool bAsync_, NdiFormat format_) {
+	close();
+	name = name_;
+	width = width_;
+	height = height_;
+	format = format_;
+	bAsync = bAsync_;
+
+	// queued frames + the one being filled + the one being sent + the one NDI holds (async)
+	int queueSize = ofClamp(ringSize, NDI_RING_MIN, NDI_RING_MAX);
+	pool.resize(queueSize + 3);
+	for (auto& frame : pool) {
+		frame.data.resize(getFrameBytes());
+		frame.metadata.clear();
+		frame.renderMicros = 0;
+		frame.arrivalMicros = 0;
+	}
+	ready.reset(queueSize);
+	released.reset(pool.size());
+	for (int i = 0; i < (int)pool.size(); i++) {
+		released.push(i);
+	}
+	fillSlot = -1;
+	spareSlot = -1;
+	framesSent = framesDropped = framesLate = 0;
+
+	// not clocked, frames go out at the rate the Kinect delivers them
+	NDIlib_send_create_t createDesc;
+	createDesc.p_ndi_name = name.c_str();
+	createDesc.p_groups = nullptr;
+	createDesc.clock_video = false;
+	createDesc.clock_audio = false;
+	sender = NDIlib_send_create(&createDesc);
+	bSetup = sender != nullptr;
+	if (!bSetup) return false;
+
+	const char * formatNames[] = { "RGBA", "UYVY", "UYVA", "BGRA" };
+	ofLogNotice("kv2") << "Created NDI sender [" << name << "] (" << width << "x" << height << " " << formatNames[format] << ", "
+		<< queueSize << " queued" << (bAsync ? ", async" : "") << ")";
+	bQuit = false;
+	thread = std::thread(&NdiStream::senderLoop, this);
+	return true;
+}
+
+void NdiStream::close() {
+	if (!bSetup) return;
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		bQuit = true;
+	}
+	wake.notify_one();
+	thread.join();
+	NDIlib_send_destroy(sender); // NDI lets go of the last async frame
+	sender = nullptr;
+	bSetup = false;
+}
+
+void NdiStream::setFrameRate(int fps) {
+	if (fps <= 0) fps = KINECT_FPS;
+	frameRate = fps;
+	lateMicros = 1000000 / fps;
+}
+
+int NdiStream::getStride() const {
+	return format == NDI_FORMAT_RGBA || format == NDI_FORMAT_BGRA ? width * 4 : width * 2;
+}
+
+int NdiStream::getFrameBytes() const {
+	return getStride() * height + (format == NDI_FORMAT_UYVA ? width * height : 0);
+}
+
+//--------------------------------------------------------------
+unsigned char * NdiStream::beginFrame() {
+	if (!bSetup) return nullptr;
+
+	int slot = spareSlot;
+	spareSlot = -1;
+	if (slot < 0 && !released.pop(slot)) {
+		// sender is behind: the oldest queued frame is worth less than this one
+		if (!ready.pop(slot)) {
+			framesDropped++;
+			return nullptr;
+		}
+		framesDropped++;
+	}
+	fillSlot = slot;
+	return pool[slot].data.data();
+}
+
+void NdiStream::cancelFrame() {
+	if (fillSlot < 0) return;
+	spareSlot = fillSlot;
+	fillSlot = -1;
+	framesDropped++;
+}
+
+void NdiStream::sendFrame(unsigned long long renderMicros, long long arrivalMicros, const char * metadata) {
+	if (fillSlot < 0) return;
+	pool[fillSlot].renderMicros = renderMicros;
+	pool[fillSlot].arrivalMicros = arrivalMicros;
+	if (metadata) pool[fillSlot].metadata = metadata;
+	else pool[fillSlot].metadata.clear();
+
+	int evicted;
+	if (ready.pushDropOldest(fillSlot, evicted)) {
+		spareSlot = evicted;
+		framesDropped++;
+	}
+	fillSlot = -1;
+
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex); // so the wake up can't slip in before the sender waits
+	}
+	wake.notify_one();
+}
+
+void NdiStream::fillFromRGBA(unsigned char * buffer, const unsigned char * rgba, int rgbaStride) const {
+	fill(buffer, rgba, rgbaStride, false);
+}
+
+void NdiStream::fillFromBGRA(unsigned char * buffer, const unsigned char * bgra, int bgraStride) const {
+	fill(buffer, bgra, bgraStride, true);
+}
+
+void NdiStream::fill(unsigned char * buffer, const unsigned char * pixels, int pixelStride, bool bBGRA) const {
+	YuvMatrix matrix = yuvMatrixFor(height);
+	int stride = getStride();
+	bool bSameOrder = bBGRA == (format == NDI_FORMAT_BGRA);
+	for (int y = 0; y < height; y++) {
+		const unsigned char * src = pixels + y * pixelStride;
+		unsigned char * dst = buffer + y * stride;
+		switch (format) {
+		case NDI_FORMAT_UYVY:
+			if (bBGRA) bgraToUyvy(src, dst, width, matrix);
+			else rgbaToUyvy(src, dst, width, matrix);
+			break;
+		case NDI_FORMAT_UYVA:
+			if (bBGRA) bgraToUyva(src, dst, buffer + stride * height + y * width, width, matrix);
+			else rgbaToUyva(src, dst, buffer + stride * height + y * width, width, matrix);
+			break;
+		default:
+			if (bSameOrder) memcpy(dst, src, width * 4);
+			else swizzleRB(src, dst, width);
+			break;
+		}
+	}
+}
+
+//--------------------------------------------------------------
+void NdiStream::senderLoop() {
+	int ndiSlot = -1; // held by NDI until the next async send
+
+	while (true) {
+		int slot;
+		if (!ready.pop(slot)) {
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			wake.wait(lock, [this] { return bQuit || !ready.empty(); });
+			if (bQuit) break;
+			continue;
+		}
+
+		bool bAsyncSend = bAsync;
+		const NDIlib_FourCC_type_e fourCCs[] = { NDIlib_FourCC_type_RGBA, NDIlib_FourCC_type_UYVY, NDIlib_FourCC_type_UYVA, NDIlib_FourCC_type_BGRA };
+		Frame & frame = pool[slot];
+		NDIlib_video_frame_v2_t video;
+		video.xres = width;
+		video.yres = height;
+		video.FourCC = fourCCs[format];
+		video.frame_rate_N = frameRate;
+		video.frame_rate_D = 1;
+		video.picture_aspect_ratio = (float)width / height;
+		video.frame_format_type = NDIlib_frame_format_type_progressive;
+		video.timecode = NDIlib_send_timecode_synthesize;
+		video.p_data = frame.data.data();
+		video.line_stride_in_bytes = getStride();
+		video.p_metadata = frame.metadata.empty() ? nullptr : frame.metadata.c_str();
+		if (bAsyncSend) NDIlib_send_send_video_async_v2(sender, &video);
+		else NDIlib_send_send_video_v2(sender, &video);
+
+		framesSent++;
+		if (ofGetElapsedTimeMicros() - frame.renderMicros > lateMicros) framesLate++;
+		if (latencyTimers && frame.arrivalMicros) {
+			latencyTimers->record(latencyStage, (float)(frameSourceMicros() - frame.arrivalMicros));
+		}
+
+		// async: sending this one released the previous buffer
+		if (ndiSlot >= 0) released.push(ndiSlot);
+		ndiSlot = -1;
+		if (bAsyncSend) ndiSlot = slot;
+		else released.push(slot);
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxNDI.h"
+#include "frameSource.h"
+#include "spscQueue.h"
+#include "stageTimers.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define NDI_RING_MIN 2
+#define NDI_RING_MAX 4
+
+// Pixel layout of a stream's frames, what the producer writes into beginFrame()'s buffer
+enum NdiFormat {
+	NDI_FORMAT_RGBA = 0, // 4 bytes per pixel
+	NDI_FORMAT_UYVY,     // 4:2:2, 2 bytes per pixel: U0 Y0 V0 Y1, width even
+	NDI_FORMAT_UYVA,     // UYVY followed by a plane of width * height alpha bytes
+	NDI_FORMAT_BGRA      // 4 bytes per pixel, the Kinect color plane as it is
+};
+
+// One NDI output: an NDI SDK sender on its own thread, fed by one producer thread (draw(),
+// or the acquisition thread for frames encoded on the cpu) through a lock free queue of
+// pooled buffers. The producer only fills a buffer and queues it, the sender thread does
+// the (possibly blocking) send. If the sender falls behind the oldest queued frame is
+// dropped, the producer never waits.
+// The frames go to the SDK as they are (format, stride, metadata), ofxNDIsender only
+// takes RGBA sized rows.
+// In async mode NDI keeps reading the buffer of a send until the next send (or the sender
+// is destroyed), so that buffer only goes back to the pool then.
+class NdiStream {
+public:
+	NdiStream();
+	~NdiStream();
+
+	// ringSize: frames that can queue up for the sender before the oldest is dropped.
+	// NDIlib_initialize() has to have succeeded before, once for all streams (ofApp::setup())
+	bool setup(const string & name, int width, int height, int ringSize, bool bAsync, NdiFormat format = NDI_FORMAT_RGBA);
+	void close();
+	bool isSetup() const { return bSetup; }
+
+	const string & getName() const { return name; }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	NdiFormat getFormat() const { return format; }
+	int getStride() const; // bytes per row (of the UYVY plane for UYVA)
+	int getFrameBytes() const;
+
+	void setAsync(bool bAsync_) { bAsync = bAsync_; }
+	bool isAsync() const { return bAsync; }
+
+	// sent as the frame's rate, a frame sent more than one frame after it was rendered counts as late
+	void setFrameRate(int fps);
+	// Kinect frame arrival -> send of every frame goes to timers as stage, from the sender thread
+	void setLatencyTimer(StageTimers * timers_, int stage) {
+		latencyTimers = timers_;
+		latencyStage = stage;
+	}
+
+	// Producer side. Buffer (getFrameBytes()) to write the next frame into, follow with sendFrame()
+	// or cancelFrame(). nullptr (counted as dropped) only if NDI holds every buffer.
+	unsigned char * beginFrame();
+	// queue the frame for the sender thread. renderMicros: ofGetElapsedTimeMicros() when it was drawn,
+	// arrivalMicros: frameSourceMicros() when its Kinect frame came in, 0 if unknown.
+	// metadata: NDI per frame metadata (XML), sent along with the frame
+	void sendFrame(unsigned long long renderMicros, long long arrivalMicros = 0, const char * metadata = nullptr);
+	void cancelFrame(); // readback failed, counts as dropped
+	// writes width * height RGBA pixels (rgbaStride bytes per row) into a beginFrame() buffer,
+	// converted to the stream's format (pixelKernels.h)
+	void fillFromRGBA(unsigned char * buffer, const unsigned char * rgba, int rgbaStride) const;
+	void fillFromBGRA(unsigned char * buffer, const unsigned char * bgra, int bgraStride) const;
+
+	int getFramesSent() const { return framesSent; }
+	int getFramesDropped() const { return framesDropped; }
+	int getFramesLate() const { return framesLate; }
+	int getQueued() const { return (int)ready.size(); } // waiting for the sender thread, approximate
+
+private:
+	void senderLoop();
+	void fill(unsigned char * buffer, const unsigned char * pixels, int pixelStride, bool bBGRA) const;
+
+	struct Frame {
+		vector<unsigned char> data;
+		string metadata; // capacity is kept, no allocations once it has been long enough
+		unsigned long long renderMicros;
+		long long arrivalMicros;
+	};
+
+	NDIlib_send_instance_t sender;
+	string name;
+	int width;
+	int height;
+	NdiFormat format;
+	bool bSetup;
+	std::atomic<bool> bAsync;
+	std::atomic<unsigned long long> lateMicros;
+	std::atomic<int> frameRate;
+	StageTimers * latencyTimers;
+	int latencyStage;
+
+	vector<Frame> pool;
+	SpscQueue<int> ready;    // producer -> sender thread, drop oldest
+	SpscQueue<int> released; // sender thread -> producer, buffers NDI is done with
+	int fillSlot;            // producer side, slot between beginFrame() and sendFrame(), -1 if none
+	int spareSlot;           // producer side, a cancelled slot to use next, -1 if none
+
+	std::thread thread;
+	std::atomic<bool> bQuit;
+	std::mutex wakeMutex;    // only to sleep on, the queues don't need it
+	std::condition_variable wake;
+
+	std::atomic<int> framesSent;
+	std::atomic<int> framesDropped;
+	std::atomic<int> framesLate;
+};
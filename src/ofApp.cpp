@@ -20,17 +20,14 @@
 *  Please read the ReadMe file included in the github reprository, for details.
 */
 
-#define DEPTH_WIDTH 512
-#define DEPTH_HEIGHT 424
-#define DEPTH_SIZE DEPTH_WIDTH * DEPTH_HEIGHT
-
-#define COLOR_WIDTH 1920
-#define COLOR_HEIGHT 1080
+// DEPTH_WIDTH / COLOR_WIDTH etc. are in frameSource.h
 
 int previewWidth = DEPTH_WIDTH / 2; // width and hieght of Depth Camera scaled
 int previewHeight = DEPTH_HEIGHT / 2;
 
 string guiFile = "settings.xml";
+string recordingsFolder = "recordings/";
+string logsFolder = "logs/";
 
 // REF: http://www.cplusplus.com/reference/cstring/
 
@@ -41,40 +38,88 @@ string guiFile = "settings.xml";
 //--------------------------------------------------------------
 void ofApp::setup() {
 	ofSetWindowTitle("kinect2share");
-	ofSetFrameRate(30);
-	ofSetVerticalSync(true);
+	// no frame rate cap, frames are processed on the acquisition thread as they arrive and
+	// the preview just shows the newest one
+	ofSetVerticalSync(!bHeadless);
+	if (bHeadless) {
+		// hidden window, no vsync to wait for, just poll for new frames often enough
+		ofSetFrameRate(HEADLESS_FRAME_RATE);
+		ofLogNotice("kv2") << "Headless, no preview. Outputs as set in " << guiFile << " / over OSC";
+	}
+	headlessStatusTime = 0;
 
 	color_StreamName = "kv2_color";
 	cutout_StreamName = "kv2_cutout";
 	depth_StreamName = "kv2_depth";
 	keyed_StreamName = "kv2_keyed";
-
-	kinect.open();
-	kinect.initDepthSource();
-	kinect.initColorSource();
-	kinect.initInfraredSource();
-	kinect.initBodySource();
-	kinect.initBodyIndexSource();
+	infrared_StreamName = "kv2_infrared";
+
+	// Frames come from the live Kinect, or from a recording when started with --replay <file>
+	// Either way they go through the recorder so any session can be recorded.
+	std::unique_ptr<FrameSource> source;
+	ReplayFrameSource * replay = nullptr;
+	kinectSource = nullptr;
+	if (replayPath.empty()) {
+		kinectSource = new KinectFrameSource();
+		source.reset(kinectSource);
+	}
+	else {
+		replay = new ReplayFrameSource(replayPath, bReplayUnthrottled);
+		source.reset(replay);
+	}
+	recorder = new RecordingFrameSource(std::move(source));
+	frameSource.reset(recorder);
+	if (!frameSource->setup()) {
+		ofLogError("kv2") << "Could not open frame source: " << frameSource->getName();
+	}
+	else if (replay) {
+		if (!replay->isIndexed()) ofLogWarning("kv2") << replayPath << " has no index (recording not stopped?), scanned " << replay->getNumFrames() << " frames";
+		replay->seekToTime(replayStartSeconds);
+	}
 
 	// added for coordmapping
-	if (kinect.getSensor()->get_CoordinateMapper(&coordinateMapper) < 0) {
-		ofLogError() << "Could not acquire CoordinateMapper!";
-	}
 	numBodiesTracked = 0;
 	bHaveAllStreams = false;
-	foregroundImg.allocate(DEPTH_WIDTH, DEPTH_HEIGHT, OF_IMAGE_COLOR_ALPHA);
-	colorCoords.resize(DEPTH_WIDTH * DEPTH_HEIGHT);
 	// end add for coordmapping
+	for (int i = 0; i < 3; i++) {
+		PreviewFrame & p = preview.getSlot(i);
+		p.depth.resize(DEPTH_SIZE);
+		p.infrared.resize(DEPTH_SIZE);
+		p.bodyIndex.resize(DEPTH_SIZE);
+		p.colorBGRA.resize(COLOR_WIDTH * COLOR_HEIGHT * 4);
+		p.keyedRGBA.resize(DEPTH_SIZE * 4);
+		p.depthRGBA.resize(DEPTH_SIZE * 4);
+		p.colorCoords.resize(DEPTH_SIZE * 2);
+		p.bCoords = p.bDepthRGBA = p.bGpuDepth = false;
+		p.depthNear = p.depthFar = 0;
+		p.irBlack = p.irWhite = 0;
+		p.bHaveAllStreams = p.bDepth = p.bBodyIndex = p.bColor = p.bInfrared = p.bKeyed = false;
+		p.numBodiesTracked = 0;
+		p.arrivalMicros = 0;
+		p.oscLatencyMicros = 0;
+		p.bRecording = p.bRecordFailed = false;
+		p.framesWritten = p.framesDropped = 0;
+		p.bytesWritten = 0;
+	}
+	bPreviewNew = false;
 
-	ofSetWindowShape(previewWidth * 3, previewHeight * 2);
+	if (!bHeadless) ofSetWindowShape(previewWidth * 3, previewHeight * 2);
 
 	//ofDisableArbTex(); // needed for textures to work... May be needed for NDI?
 	// seems above is needed if loading an image file -> texture
 	//bgCB.load("images/checkerbg.png");
 
 	// TODO: depth and IR to be added -> fboDepth
-	fboDepth.allocate(DEPTH_WIDTH, DEPTH_HEIGHT, GL_RGBA); //setup offscreen buffer in openGL RGBA mode (used for Keyed and B+W bodies.)
+	// one render target per output, so a stream's readback can still be in flight while the next one draws
+	fboDepth.allocate(DEPTH_WIDTH, DEPTH_HEIGHT, GL_RGBA); //setup offscreen buffer in openGL RGBA mode
+	fboCutout.allocate(DEPTH_WIDTH, DEPTH_HEIGHT, GL_RGBA); // B+W bodies
+	fboKeyed.allocate(DEPTH_WIDTH, DEPTH_HEIGHT, GL_RGBA);
+	fboInfrared.allocate(DEPTH_WIDTH, DEPTH_HEIGHT, GL_RGBA);
+	fboAtlas.allocate(DEPTH_WIDTH * ATLAS_STREAMS, DEPTH_HEIGHT, GL_RGBA); // depth | cutout | keyed, for the single readback
 	fboColor.allocate(COLOR_WIDTH, COLOR_HEIGHT, GL_RGB); //setup offscreen buffer in openGL RGB mode
+	coordTex.allocate(DEPTH_WIDTH, DEPTH_HEIGHT, GL_RG32F);
+	coordTex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+	gpuKeying.setup();
 
 
 														  // GUI SETUP ***************** http://openframeworks.cc/documentation/ofxGui/
@@ -85,6 +130,13 @@ void ofApp::setup() {
 
 	OSCgroup.setup("OSC");
 	OSCgroup.add(jsonGrouped.setup("OSC as JSON", true));
+	OSCgroup.add(oscBinary.setup("OSC binary (schema)", false));
+	OSCgroup.add(oscBundles.setup("Joints as bundles", true));
+	OSCgroup.add(oscFeatures.setup("Features -> OSC", false));
+	OSCgroup.add(oscBones.setup("Bone vectors -> OSC", false));
+	OSCgroup.add(oscDelta.setup("Only send changes", false));
+	OSCgroup.add(oscDeadBand.setup("Dead band (mm)", 5, 0, 50));
+	OSCgroup.add(oscKeyframe.setup("Keyframe every (s)", 1, 0.1, 10));
 	OSCgroup.add(HostField.setup("Host ip", "10.249.59.100"));
 	OSCgroup.add(oscPort.setup("Output port", 8080));
 	OSCgroup.add(oscPortIn.setup("Input port", 4321));
@@ -95,6 +147,7 @@ void ofApp::setup() {
 	SPOUTgroup.add(spoutColor.setup("Color -> spout", true));
 	SPOUTgroup.add(spoutKeyed.setup("Keyed -> spout", true));
 	SPOUTgroup.add(spoutDepth.setup("Depth -> spout", true));
+	SPOUTgroup.add(spoutInfrared.setup("Infrared -> spout", false));
 	gui.add(&SPOUTgroup);
 
 	NDIgroup.setup("NDI");
@@ -103,9 +156,55 @@ void ofApp::setup() {
 	NDIgroup.add(ndiColor.setup("Color -> NDI", true));
 	NDIgroup.add(ndiKeyed.setup("Keyed -> NDI", true));
 	NDIgroup.add(ndiDepth.setup("Depth -> NDI", true));
+	NDIgroup.add(ndiInfrared.setup("Infrared -> NDI", false));
+	NDIgroup.add(ndiAsync.setup("Async send", true));
+	NDIgroup.add(ndiBuffers.setup("Buffers <reboot>", 3, NDI_RING_MIN, NDI_RING_MAX));
+	NDIgroup.add(pboDepth.setup("PBO ring <reboot>", 3, PBO_RING_MIN, PBO_RING_MAX));
+	NDIgroup.add(ndiAtlas.setup("Single readback (atlas)", false));
+	NDIgroup.add(ndiCompact.setup("UYVY / UYVA formats <reboot>", true));
+	NDIgroup.add(ndiDepthEncoding.setup("Depth RGBA/RG16/8bit/false <reboot>", DEPTH_ENCODING_RGBA, DEPTH_ENCODING_RGBA, DEPTH_ENCODING_COUNT - 1));
 	gui.add(&NDIgroup);
 
+	FILTERgroup.setup("Skeleton filter (OSC)");
+	FILTERgroup.add(filterType.setup("Off / One Euro / Double exp", SKELETON_FILTER_OFF, SKELETON_FILTER_OFF, SKELETON_FILTER_TYPE_COUNT - 1));
+	FILTERgroup.add(filterMinCutoff.setup("Min cutoff (Hz)", 1.0, 0.05, 10));
+	FILTERgroup.add(filterBeta.setup("Beta (speed)", 1.0, 0, 20));
+	FILTERgroup.add(filterDCutoff.setup("Speed cutoff (Hz)", 1.0, 0.05, 10));
+	FILTERgroup.add(filterSmoothing.setup("Double exp smoothing", 0.5, 0.01, 1));
+	FILTERgroup.add(filterTrend.setup("Double exp trend", 0.5, 0.01, 1));
+	FILTERgroup.add(filterPredict.setup("Predict (ms)", 0, 0, 100));
+	gui.add(&FILTERgroup);
+
+	CPUgroup.setup("Processing");
+	CPUgroup.add(keyingThreads.setup("Keying threads", WorkerPool::defaultNumThreads(), 1, 16));
+	CPUgroup.add(gpuShaders.setup("Keying + depth on GPU", false));
+	CPUgroup.add(depthColorize.setup("Colorize depth", false));
+	CPUgroup.add(depthNear.setup("Depth near (mm)", 500, 0, 8000));
+	CPUgroup.add(depthFar.setup("Depth far (mm)", 4500, 0, 8000));
+	gui.add(&CPUgroup);
+
+	IRgroup.setup("Infrared");
+	IRgroup.add(irAutoGain.setup("Auto gain", true));
+	IRgroup.add(irBlack.setup("Black level", 0, 0, 65535));
+	IRgroup.add(irWhite.setup("White level", 8000, 0, 65535));
+	IRgroup.add(irGamma.setup("Gamma", 1.0, 0.2, 3));
+	IRgroup.add(irLongExposure.setup("Long exposure", false));
+	gui.add(&IRgroup);
+
+	TIMINGgroup.setup("Timing");
+	TIMINGgroup.add(timingOverlay.setup("Timing overlay", false));
+	TIMINGgroup.add(timingOsc.setup("Timing -> OSC", false));
+	TIMINGgroup.add(timingCsv.setup("Timing -> CSV log", false));
+	gui.add(&TIMINGgroup);
+
+	CAPTUREgroup.setup("Capture");
+	CAPTUREgroup.add(recordToggle.setup("Record -> disk", false));
+	CAPTUREgroup.add(compressDepthToggle.setup("Compress depth/IR/coords", true));
+	CAPTUREgroup.add(compressColorToggle.setup("Compress color", false));
+	gui.add(&CAPTUREgroup);
+
 	gui.loadFromFile(guiFile);
+	recordToggle = false; // never start recording on launch
 	//if (!gui.loadFromFile(guiFile)) {
 	//	ofLogError("kv2") << "Unable to load settings xml";
 	//	ofExit();
@@ -113,18 +212,32 @@ void ofApp::setup() {
 
 	// HostField.addListener(this, &ofApp::HostFieldChanged);
 
+	keyingPool.setup(keyingThreads);
+
 	// OSC setup  * * * * * * * * * * * * *
 	// OSC setup  * * * * * * * * * * * * *
 	// OSC setup  * * * * * * * * * * * * *
 	//oscSender.disableBroadcast(); //depricated
 	oscSender.setup(HostField, oscPort);
-	oscReceiver.setup(oscPortIn);
+	setupControls();
+	oscControlPort = oscControl.start(oscPortIn) ? oscPortIn : -1;
+	schemaSentTime = -SKELETON_SCHEMA_INTERVAL; // goes out with the first binary frame
+	jointBundler.setup(jointNames);
+	oscReconnects = reconnectsDone = 0;
+	schemaRequests = schemaRequestsDone = 0;
+	bRecordRequested = bRecordFailed = false;
+	timingSentTime = 0;
+	bTimingCsvRequested = false;
+	irAutoBlack = irAutoWhite = -1; // taken from the first frame
 
 	// NDI setup * * * * * * * * * * * * * 
 	// NDI setup * * * * * * * * * * * * * 
 	// NDI setup * * * * * * * * * * * * * 
 
-	if (ndiActive) {
+	// the SDK once for all the streams, destroyed in exit() after they are closed
+	bNdiInitialized = ndiActive && NDIlib_initialize();
+	if (ndiActive && !bNdiInitialized) ofLogError("kv2") << "Could not initialize NDI, is the NDI runtime installed?";
+	if (bNdiInitialized) {
 		NDIlock = false;
 		cout << "NDI SDK copyright NewTek (http:\\NDI.NewTek.com)" << endl;
 		// Set the dimensions of the sender output here
@@ -132,105 +245,45 @@ void ofApp::setup() {
 		//senderWidth = 1920; // HD	-	PBO 150fps / 120fps Async/Sync unclocked
 		//senderHeight = 1080; //		FBO  80fps /  75fps Async/Sync unclocked
 
-		// TODO : async currently doesn't work???
-		// Optionally set NDI asynchronous sending instead of clocked at 60fps
-		ndiSender1.SetAsync(false); // change to true for async
-		ndiSender2.SetAsync(false); // change to true for async
-		ndiSender3.SetAsync(false); // change to true for async
-		ndiSender4.SetAsync(false); // change to true for async
-
-		int senderWidth;
-		int senderHeight;
-
-		//==================================================
-		//==================================================
-		senderWidth = COLOR_WIDTH;
-		senderHeight = COLOR_HEIGHT;
-
-		// Initialize ofPixel buffers
-		color_ndiBuffer[0].allocate(senderWidth, senderHeight, 4);
-		color_ndiBuffer[1].allocate(senderWidth, senderHeight, 4);
-
-		//// Create a new sender
-		strcpy(senderName, color_StreamName.c_str());
-		ndiSender1.CreateSender(senderName, senderWidth, senderHeight, NDIlib_FourCC_type_RGBA); //// Specify RGBA format here
-		cout << "Created NDI sender [" << senderName << "] (" << senderWidth << "x" << senderHeight << ")" << endl;
-		color_idx = 0; // index used for buffer swapping
-
-					   //==================================================
-					   //==================================================
-		senderWidth = DEPTH_WIDTH;
-		senderHeight = DEPTH_HEIGHT;
-
-		// Initialize ofPixel buffers
-		cutout_ndiBuffer[0].allocate(senderWidth, senderHeight, 4);
-		cutout_ndiBuffer[1].allocate(senderWidth, senderHeight, 4);
-
-		// Create a new sender
-		strcpy(senderName, cutout_StreamName.c_str());
-		ndiSender2.CreateSender(senderName, senderWidth, senderHeight, NDIlib_FourCC_type_RGBA); //// Specify RGBA format here
-		cout << "Created NDI sender [" << senderName << "] (" << senderWidth << "x" << senderHeight << ")" << endl;
-		cutout_idx = 0; // index used for buffer swapping
-
-						//==================================================
-						//==================================================
-		senderWidth = DEPTH_WIDTH;
-		senderHeight = DEPTH_HEIGHT;
-
-		// Initialize ofPixel buffers
-		depth_ndiBuffer[0].allocate(senderWidth, senderHeight, 4);
-		depth_ndiBuffer[1].allocate(senderWidth, senderHeight, 4);
-
-		// Create a new sender
-		strcpy(senderName, depth_StreamName.c_str());
-		ndiSender3.CreateSender(senderName, senderWidth, senderHeight, NDIlib_FourCC_type_RGBA); //// Specify RGBA format here
-		cout << "Created NDI sender [" << senderName << "] (" << senderWidth << "x" << senderHeight << ")" << endl;
-		depth_idx = 0; // index used for buffer swapping
-
-					   //==================================================
-					   //==================================================
-		senderWidth = DEPTH_WIDTH;
-		senderHeight = DEPTH_HEIGHT;
-
-		// Initialize ofPixel buffers
-		keyed_ndiBuffer[0].allocate(senderWidth, senderHeight, 4);
-		keyed_ndiBuffer[1].allocate(senderWidth, senderHeight, 4);
-
-		// Create a new sender
-		strcpy(senderName, keyed_StreamName.c_str());
-		ndiSender4.CreateSender(senderName, senderWidth, senderHeight, NDIlib_FourCC_type_RGBA); //// Specify RGBA format here
-		cout << "Created NDI sender [" << senderName << "] (" << senderWidth << "x" << senderHeight << ")" << endl;
-		keyed_idx = 0; // index used for buffer swapping
-
-					   //NDI SENDER 1 colorSize============================
-					   //==================================================
-					   // Initialize OpenGL pbos for asynchronous read of fbo data
-
-		senderWidth = COLOR_WIDTH; // DUSX resetting to work with color_ndi
-		senderHeight = COLOR_HEIGHT;
-		glGenBuffers(2, ndiPbo1);
-		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, ndiPbo1[0]);
-		glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, senderWidth*senderHeight * 4, 0, GL_STREAM_READ);
-		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, ndiPbo1[1]);
-		glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, senderWidth*senderHeight * 4, 0, GL_STREAM_READ);
-		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
-		Pbo1Index = NextPbo1Index = 0;
-		bUsePBO1 = true; // Change to false to compare  // DUSX was originally true
-
-						 //NDI SENDER 2 depthSize============================
-						 //==================================================
-						 // Initialize OpenGL pbos for asynchronous read of fbo data
-
-		senderWidth = DEPTH_WIDTH; // DUSX resetting to work with color_ndi
-		senderHeight = DEPTH_HEIGHT;
-		glGenBuffers(2, ndiPbo2);
-		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, ndiPbo2[0]);
-		glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, senderWidth*senderHeight * 4, 0, GL_STREAM_READ);
-		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, ndiPbo2[1]);
-		glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, senderWidth*senderHeight * 4, 0, GL_STREAM_READ);
-		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
-		Pbo2Index = NextPbo2Index = 0;
-		bUsePBO2 = true; // Change to false to compare  // DUSX was originally true
+		// Every stream sends from its own thread, draw() only queues frames (see ndiStream.h).
+		// UYVY wherever alpha means nothing, UYVA for keyed: half / three quarters of the RGBA bytes,
+		// the readbacks are converted on the way into the stream's buffer
+		NdiFormat opaqueFormat = ndiCompact ? NDI_FORMAT_UYVY : NDI_FORMAT_RGBA;
+		NdiFormat alphaFormat = ndiCompact ? NDI_FORMAT_UYVA : NDI_FORMAT_RGBA;
+		// color goes out straight from the Kinect's BGRA plane on the acquisition thread, no fbo / readback
+		ndiColorStream.setup(color_StreamName, COLOR_WIDTH, COLOR_HEIGHT, ndiBuffers, ndiAsync, ndiCompact ? NDI_FORMAT_UYVY : NDI_FORMAT_BGRA);
+		ndiCutoutStream.setup(cutout_StreamName, DEPTH_WIDTH, DEPTH_HEIGHT, ndiBuffers, ndiAsync, opaqueFormat);
+		// the 2 byte depth encodings need no fbo, the acquisition thread sends them (see processFrame())
+		depthEncoding = (DepthEncoding)(int)ndiDepthEncoding;
+		if (depthEncoding == DEPTH_ENCODING_RG16) {
+			ndiDepthStream.setup(depth_StreamName, DEPTH_WIDTH / 2, DEPTH_HEIGHT, ndiBuffers, ndiAsync);
+		}
+		else if (depthEncoding != DEPTH_ENCODING_RGBA) {
+			ndiDepthStream.setup(depth_StreamName, DEPTH_WIDTH, DEPTH_HEIGHT, ndiBuffers, ndiAsync, NDI_FORMAT_UYVY);
+		}
+		else {
+			ndiDepthStream.setup(depth_StreamName, DEPTH_WIDTH, DEPTH_HEIGHT, ndiBuffers, ndiAsync, opaqueFormat);
+		}
+		ndiKeyedStream.setup(keyed_StreamName, DEPTH_WIDTH, DEPTH_HEIGHT, ndiBuffers, ndiAsync, alphaFormat);
+		ndiInfraredStream.setup(infrared_StreamName, DEPTH_WIDTH, DEPTH_HEIGHT, ndiBuffers, ndiAsync, opaqueFormat);
+		// the Kinect's rate, also for replays: an unthrottled one only sends faster, the content is still 30 fps
+		NdiStream * streams[] = { &ndiColorStream, &ndiCutoutStream, &ndiDepthStream, &ndiKeyedStream, &ndiInfraredStream };
+		for (NdiStream * stream : streams) {
+			stream->setFrameRate(KINECT_FPS);
+		}
+		ndiColorStream.setLatencyTimer(&timers, TIMING_LATENCY_NDI_COLOR);
+		ndiCutoutStream.setLatencyTimer(&timers, TIMING_LATENCY_NDI_CUTOUT);
+		ndiDepthStream.setLatencyTimer(&timers, TIMING_LATENCY_NDI_DEPTH);
+		ndiKeyedStream.setLatencyTimer(&timers, TIMING_LATENCY_NDI_KEYED);
+		ndiInfraredStream.setLatencyTimer(&timers, TIMING_LATENCY_NDI_INFRARED);
+
+		// Initialize OpenGL pbos for asynchronous read of fbo data
+		cutoutPbo.setup(DEPTH_WIDTH, DEPTH_HEIGHT, pboDepth);
+		depthPbo.setup(DEPTH_WIDTH, DEPTH_HEIGHT, pboDepth);
+		keyedPbo.setup(DEPTH_WIDTH, DEPTH_HEIGHT, pboDepth);
+		infraredPbo.setup(DEPTH_WIDTH, DEPTH_HEIGHT, pboDepth);
+		atlasPbo.setup(DEPTH_WIDTH * ATLAS_STREAMS, DEPTH_HEIGHT, pboDepth);
+		bUsePBO = true; // Change to false to compare
 	}
 	else {
 		NDIlock = true;
@@ -238,103 +291,225 @@ void ofApp::setup() {
 	// NDI setup DONE ^ ^ ^ * * * * * * * * * *
 	// NDI setup DONE ^ ^ ^ * * * * * * * * * *
 	// NDI setup DONE ^ ^ ^ * * * * * * * * * *
+
+	updateOutputs();
+	publishSettings();
+	acquisition.start(frameSource.get(), [this](bool bFrameNew) { processFrame(bFrameNew); });
 }
 
 //--------------------------------------------------------------
 void ofApp::update() {
-	// get OSC messages
-	while (oscReceiver.hasWaitingMessages()) {
-		ofxOscMessage m;
-		oscReceiver.getNextMessage(&m);
-
-		if (m.getAddress() == "/app-exit") {
-			bool trigger = m.getArgAsInt(0);
-			//string s = m.getArgAsString(0);
-			if (trigger) {
-				exit();
-				std::exit(0);
-				oscSendMsg("exit", "/kv2status/");
+	// OSC commands received since the last frame (oscControl.h), applied here so settings
+	// never change halfway through a frame
+	OscCommand command;
+	bool bReconnect = false;
+	while (oscControl.pop(command)) {
+		applyControl(command, bReconnect);
+	}
+	if (bReconnect) HostFieldChanged();
+	updateOutputs();
+	publishSettings();
+	if (bHeadless) logHeadlessStatus();
+
+	// newest frame from the acquisition thread, if there was one since the last update()
+	bPreviewNew = preview.update();
+	const PreviewFrame & p = preview.getFront();
+	if (p.bRecordFailed) recordToggle = false;
+	bHaveAllStreams = p.bHaveAllStreams;
+	if (!bPreviewNew || !bHaveAllStreams) {
+		bPreviewNew = false;
+		return;
+	}
+	numBodiesTracked = p.numBodiesTracked;
+
+	// Upload for the previews / fbos (the Kinect addon's own textures are off, see KinectFrameSource)
+	StageTimers::Clock::time_point uploadStart = StageTimers::Clock::now();
+	// nearest filtering for the shaders, these are all drawn 1:1 anyway
+	if (p.bDepth) {
+		depthPixels.setFromExternalPixels((unsigned short*)p.depth.data(), DEPTH_WIDTH, DEPTH_HEIGHT, 1);
+		depthTex.loadData(depthPixels);
+		depthTex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+	}
+	if (p.bDepthRGBA) {
+		depthColorPixels.setFromExternalPixels((unsigned char*)p.depthRGBA.data(), DEPTH_WIDTH, DEPTH_HEIGHT, OF_PIXELS_RGBA);
+		depthColorTex.loadData(depthColorPixels);
+	}
+	if (p.bBodyIndex) {
+		bodyIndexPixels.setFromExternalPixels((unsigned char*)p.bodyIndex.data(), DEPTH_WIDTH, DEPTH_HEIGHT, 1);
+		bodyIndexTex.loadData(bodyIndexPixels);
+		bodyIndexTex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+	}
+	if (p.bColor) {
+		colorPixels.setFromExternalPixels((unsigned char*)p.colorBGRA.data(), COLOR_WIDTH, COLOR_HEIGHT, OF_PIXELS_BGRA);
+		colorTex.loadData(colorPixels);
+		colorTex.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+	}
+	if (p.bCoords) {
+		coordTex.loadData(p.colorCoords.data(), DEPTH_WIDTH, DEPTH_HEIGHT, GL_RG);
+	}
+	if (p.bInfrared) {
+		infraredPixels.setFromExternalPixels((unsigned char*)p.infrared.data(), DEPTH_WIDTH, DEPTH_HEIGHT, 1);
+		infraredTex.loadData(infraredPixels);
+	}
+	if (p.bKeyed) {
+		keyedPixels.setFromExternalPixels((unsigned char*)p.keyedRGBA.data(), DEPTH_WIDTH, DEPTH_HEIGHT, OF_PIXELS_RGBA);
+		keyedTex.loadData(keyedPixels);
+	}
+	timers.record(TIMING_UPLOAD, StageTimers::microsSince(uploadStart));
+}
+
+// GUI -> acquisition thread, once per update()
+void ofApp::publishSettings() {
+	std::lock_guard<std::mutex> lock(settingsMutex);
+	settings.jsonGrouped = jsonGrouped;
+	settings.oscBinary = oscBinary;
+	settings.oscBundles = oscBundles;
+	settings.oscFeatures = oscFeatures;
+	settings.oscBones = oscBones;
+	settings.oscDelta = oscDelta;
+	settings.oscDeadBand = oscDeadBand;
+	settings.oscKeyframe = oscKeyframe;
+	settings.filter.type = filterType;
+	settings.filter.minCutoff = filterMinCutoff;
+	settings.filter.beta = filterBeta;
+	settings.filter.derivativeCutoff = filterDCutoff;
+	settings.filter.smoothing = filterSmoothing;
+	settings.filter.trendSmoothing = filterTrend;
+	settings.filter.predictMs = filterPredict;
+	settings.keyingThreads = keyingThreads;
+	settings.bKeyed = spoutKeyed || ndiKeyed;
+	if (bHeadless) settings.bKeyed = bKeyedOut;
+	settings.bGpu = gpuShaders && gpuKeying.isReady();
+	settings.bColorizeDepth = depthColorize;
+	settings.depthNear = depthNear;
+	settings.depthFar = depthFar;
+	settings.bDepth = bDepthOut;
+	// the keying shader reads the body index and color planes too
+	settings.bBodyIndex = bCutoutOut || (settings.bGpu && settings.bKeyed);
+	settings.bColor = bColorOut || (settings.bGpu && settings.bKeyed);
+	settings.bInfrared = bInfraredOut;
+	settings.bIrAutoGain = irAutoGain;
+	settings.bIrLongExposure = irLongExposure;
+	settings.irBlack = irBlack;
+	settings.irWhite = irWhite;
+	settings.irGamma = irGamma;
+	settings.bNdiDepthEncoded = ndiActive && !NDIlock && ndiDepth && depthEncoding != DEPTH_ENCODING_RGBA;
+	settings.bNdiColor = ndiActive && !NDIlock && ndiColor;
+	settings.bNdiAsync = ndiAsync;
+	settings.bRecord = recordToggle;
+	settings.compressMask = (compressDepthToggle ? CAPTURE_COMPRESS_DEPTH : 0) | (compressColorToggle ? CAPTURE_COMPRESS_COLOR : 0);
+	settings.bTimingOsc = timingOsc;
+	settings.bTimingCsv = timingCsv;
+	string host = HostField;
+	strncpy(settings.oscHost, host.c_str(), OSC_HOST_MAX - 1);
+	settings.oscHost[OSC_HOST_MAX - 1] = 0;
+	settings.oscPort = oscPort;
+	settings.reconnects = oscReconnects;
+	settings.schemaRequests = schemaRequests;
+}
+
+void ofApp::updateOutputs() {
+	bool bNdi = ndiActive && !NDIlock;
+	bDepthOut = !bHeadless || spoutDepth || (bNdi && ndiDepth && depthEncoding == DEPTH_ENCODING_RGBA);
+	bColorOut = !bHeadless || spoutColor; // NDI color doesn't need the fbo, see processFrame()
+	bCutoutOut = !bHeadless || spoutCutOut || (bNdi && ndiCutOut);
+	bKeyedOut = !bHeadless || spoutKeyed || (bNdi && ndiKeyed);
+	bInfraredOut = !bHeadless || spoutInfrared || (bNdi && ndiInfrared);
+}
+
+// headless stand in for the status overlay, one line on the console every HEADLESS_STATUS_INTERVAL
+void ofApp::logHeadlessStatus() {
+	float now = ofGetElapsedTimef();
+	if (now - headlessStatusTime < HEADLESS_STATUS_INTERVAL) return;
+	headlessStatusTime = now;
+
+	const PreviewFrame & p = preview.getFront();
+	stringstream ss;
+	ss << frameSource->getName() << (p.bHaveAllStreams ? "" : " (not all streams)")
+		<< ", " << p.numBodiesTracked << " bodies, OSC out " << p.oscLatencyMicros / 1000.0f << " ms after frame";
+	if (ndiActive && !NDIlock) {
+		NdiStream * streams[] = { &ndiColorStream, &ndiCutoutStream, &ndiDepthStream, &ndiKeyedStream, &ndiInfraredStream };
+		for (NdiStream * stream : streams) {
+			if (stream->getFramesSent()) ss << ", " << stream->getName() << " " << stream->getFramesSent() << " sent";
+		}
+	}
+	if (p.bRecording) ss << ", REC " << p.framesWritten << " frames";
+	ofLogNotice("kv2") << ss.str();
+}
+
+//--------------------------------------------------------------
+// Acquisition thread, after every FrameSource::waitForFrame(). Skeletons go out over OSC
+// first, the keying and the copies for the previews come after.
+void ofApp::processFrame(bool bFrameNew) {
+	{
+		std::lock_guard<std::mutex> lock(settingsMutex);
+		processing = settings;
+	}
+	if (processing.reconnects != reconnectsDone) {
+		reconnectsDone = processing.reconnects;
+		oscSender.setup(processing.oscHost, processing.oscPort);
+		ofLogNotice("kv2") << "OSC sending to " << processing.oscHost << ":" << processing.oscPort;
+		oscSendMsg("fieldUpdated", "/kv2status/");
+	}
+	if (processing.schemaRequests != schemaRequestsDone) {
+		schemaRequestsDone = processing.schemaRequests;
+		sendSkeletonSchema();
+	}
+
+	// start / stop recording from the GUI
+	recorder->setCompression(processing.compressMask);
+	if (processing.bRecord != bRecordRequested) {
+		bRecordRequested = processing.bRecord;
+		bRecordFailed = false;
+		if (bRecordRequested) {
+			string path = ofToDataPath(recordingsFolder + "kv2_" + ofGetTimestampString("%Y-%m-%d_%H-%M-%S") + ".kv2rec", true);
+			ofDirectory::createDirectory(recordingsFolder, true, true);
+			if (!recorder->startRecording(path)) {
+				ofLogError("kv2") << "Could not record to " << path;
+				bRecordFailed = true; // update() switches the toggle off
 			}
 		}
+		else {
+			recorder->stopRecording();
+		}
 	}
+	exportTimings();
+	if (!bFrameNew) return;
 
 	//KV2
-	kinect.update();
-
-	// Get pixel data
-	auto& depthPix = kinect.getDepthSource()->getPixels();
-	auto& bodyIndexPix = kinect.getBodyIndexSource()->getPixels();
-	auto& colorPix = kinect.getColorSource()->getPixels();
+	const KinectFrame & frame = frameSource->getFrame();
+	float mappingMicros = kinectSource ? kinectSource->getMappingMicros() : 0;
+	timers.record(TIMING_FETCH, acquisition.getUpdateMicros() - mappingMicros);
+	if (kinectSource) timers.record(TIMING_MAPPING, mappingMicros);
+
+	PreviewFrame & out = preview.getBack();
+	out.arrivalMicros = acquisition.getArrivalMicros();
+	out.bRecording = recorder->isRecording();
+	out.bRecordFailed = bRecordFailed;
+	out.framesWritten = recorder->getFramesWritten();
+	out.framesDropped = recorder->getFramesDropped();
+	out.bytesWritten = recorder->getBytesWritten();
 
 	// Make sure there's some data here, otherwise the cam probably isn't ready yet
-	if (!depthPix.size() || !bodyIndexPix.size() || !colorPix.size()) {
-		bHaveAllStreams = false;
+	out.bHaveAllStreams = frame.hasAllStreams();
+	if (!out.bHaveAllStreams) {
+		preview.publish();
 		return;
 	}
-	else {
-		bHaveAllStreams = true;
-	}
+
+	// Skeletons go into the SoA store first, everything body related reads them from there
+	StageTimers::Clock::time_point skeletonStart = StageTimers::Clock::now();
+	skeleton.fromBodies(frame.bodies, frame.frameNumber, frame.timestamp);
+	skeletonHistory.push(skeleton);
 
 	// Count number of tracked bodies
-	numBodiesTracked = 0;
-	auto& bodies = kinect.getBodySource()->getBodies();
-	for (auto& body : bodies) {
-		if (body.tracked) {
-			numBodiesTracked++;
-		}
-	}
-
-	// Do the depth space -> color space mapping
-	// More info here:
-	// https://msdn.microsoft.com/en-us/library/windowspreview.kinect.coordinatemapper.mapdepthframetocolorspace.aspx
-	// https://msdn.microsoft.com/en-us/library/dn785530.aspx
-	coordinateMapper->MapDepthFrameToColorSpace(DEPTH_SIZE, (UINT16*)depthPix.getPixels(), DEPTH_SIZE, (ColorSpacePoint*)colorCoords.data());
-
-	// Loop through the depth image
-	if (spoutKeyed || ndiKeyed) {
-		for (int y = 0; y < DEPTH_HEIGHT; y++) {
-			for (int x = 0; x < DEPTH_WIDTH; x++) {
-				int index = (y * DEPTH_WIDTH) + x;
-
-				ofColor trans(0, 0, 0, 0);
-				foregroundImg.setColor(x, y, trans);
-
-				// This is the check to see if a given pixel is inside a tracked  body or part of the background.
-				// If it's part of a body, the value will be that body's id (0-5), or will > 5 if it's
-				// part of the background
-				// More info here: https://msdn.microsoft.com/en-us/library/windowspreview.kinect.bodyindexframe.aspx
-				float val = bodyIndexPix[index];
-				if (val >= bodies.size()) {
-					continue; // exit for loop without executing the following code
-				}
-
-				// For a given (x,y) in the depth image, lets look up where that point would be
-				// in the color image
-				ofVec2f mappedCoord = colorCoords[index];
-
-				// Mapped x/y coordinates in the color can come out as floats since it's not a 1:1 mapping
-				// between depth <-> color spaces i.e. a pixel at (100, 100) in the depth image could map
-				// to (405.84637, 238.13828) in color space
-				// So round the x/y values down to ints so that we can look up the nearest pixel
-				mappedCoord.x = floor(mappedCoord.x);
-				mappedCoord.y = floor(mappedCoord.y);
-
-				// Make sure it's within some sane bounds, and skip it otherwise
-				if (mappedCoord.x < 0 || mappedCoord.y < 0 || mappedCoord.x >= COLOR_WIDTH || mappedCoord.y >= COLOR_HEIGHT) {
-					continue;
-				}
-
-				// Finally, pull the color from the color image based on its coords in
-				// the depth image
-				foregroundImg.setColor(x, y, colorPix.getColor(mappedCoord.x, mappedCoord.y));
-			}
+	out.numBodiesTracked = 0;
+	for (int b = 0; b < BODY_COUNT_MAX; b++) {
+		if (skeleton.tracked[b]) {
+			out.numBodiesTracked++;
 		}
 	}
 
-	// Update the images since we manipulated the pixels manually. This uploads to the
-	// pixel data to the texture on the GPU so it can get drawn to screen
-	foregroundImg.update();
-
 	//--
 	//Getting joint positions (skeleton tracking)
 	//--
@@ -370,13 +545,7 @@ void ofApp::update() {
 	*/
 
 
-	// shorten names to minimize packet size
-	const char * jointNames[] = { "SpineBase", "SpineMid", "Neck", "Head",
-		"ShldrL", "ElbowL", "WristL", "HandL",
-		"ShldrR", "ElbowR", "WristR", "HandR",
-		"HipL", "KneeL", "AnkleL", "FootL",
-		"HipR", "KneeR", "AnkleR", "FootR",
-		"SpineShldr", "HandTipL", "ThumbL", "HandTipR", "ThumbR", "Count" };
+	// joint names are shortened to minimize packet size, see jointNames in frameSource.cpp
 
 	/* MORE joint. values >>>
 	second. positionInWorld[] x y z , positionInDepthMap[] x y
@@ -391,70 +560,190 @@ void ofApp::update() {
 	body. activity  ??what is this
 	*/
 
-	// defined in new coordmap section as &
-	//	auto bodies = kinect.getBodySource()->getBodies();
-
-
-	if (jsonGrouped) {
-		body2JSON(bodies, jointNames);
+	// bodies are in the skeleton store (skeletonStore.h), joints are only filled in for tracked bodies.
+	// OSC gets them smoothed / predicted (skeletonFilter.h), the history and the previews stay raw
+	skeletonFilter.setSettings(processing.filter);
+	skeletonFilter.apply(skeleton);
+	oscFrame = frame;
+	skeleton.toBodies(oscFrame.bodies);
+
+	if (!processing.oscBinary) schemaSentTime = -SKELETON_SCHEMA_INTERVAL; // announce as soon as binary is switched on
+
+	// change driven: only bodies / joints that moved past the dead band, everything on keyframes
+	const SkeletonDelta * delta = nullptr;
+	if (processing.oscDelta) {
+		deltaFilter.setThreshold(processing.oscDeadBand / 1000.0f);
+		deltaFilter.setKeyframeInterval((long long)(processing.oscKeyframe * 1000000));
+		delta = &deltaFilter.update(oscFrame);
 	}
 	else {
-		// TODO:: seperate function and add additional features like hand open/closed
-		// NON JSON osc messages
-		for (auto body : bodies) {
-			for (auto joint : body.joints) {
-				auto pos = joint.second.getPositionInWorld();
-				ofxOscMessage m;
-				string adrs = "/" + to_string(body.bodyId) + "/" + jointNames[joint.first];
-				m.setAddress(adrs);
-				m.addFloatArg(pos.x);
-				m.addFloatArg(pos.y);
-				m.addFloatArg(pos.z);
-				m.addStringArg(jointNames[joint.first]);
-				oscSender.sendMessage(m);
-
-			} // end inner joints loop
-		} // end body loop
+		deltaFilter.reset();
+	}
 
+	if (processing.oscBinary) {
+		// typed args, receivers map them to joints with the schema message.
+		// Fixed layout, so with deltas a body that changed goes out whole
+		if (ofGetElapsedTimef() - schemaSentTime > SKELETON_SCHEMA_INTERVAL) sendSkeletonSchema();
+		ofxOscMessage m;
+		for (int b = 0; b < BODY_COUNT_MAX; b++) {
+			if (delta && !delta->bSendBody[b]) continue;
+			skeletonBinaryMessage(oscFrame.bodies[b], m);
+			oscSender.sendMessage(m);
+		}
+	}
+	else if (processing.jsonGrouped) {
+		body2JSON(oscFrame.bodies, jointNames, delta);
+	}
+	else {
+		// NON JSON osc messages, one per joint: batched into MTU sized bundles unless switched off
+		// TODO:: add additional features like hand open/closed
+		if (processing.oscBundles) jointBundler.sendBundled(oscSender, oscFrame, delta);
+		else jointBundler.sendUnbundled(oscSender, oscFrame, delta);
 	} // end if/else
-
-
+	out.oscLatencyMicros = frameSourceMicros() - out.arrivalMicros;
+	timers.record(TIMING_LATENCY_OSC, (float)out.oscLatencyMicros);
 
 	  //--
 	  //Getting bones (connected joints)
 	  //--
 	  //
 
-	{
-		//// Note that for this we need a reference of which joints are connected to each other.
-		//// We call this the 'boneAtlas', and you can ask for a reference to this atlas whenever you like
-		auto bodies = kinect.getBodySource()->getBodies();
-		auto boneAtlas = ofxKinectForWindows2::Data::Body::getBonesAtlas();
+	// Bone vectors, joint angles, speeds and pose triggers of every body in one pass (skeletonFeatures.h),
+	// computed here once instead of in every receiver.
+	// Note that for this we need a reference of which joints are connected to each other.
+	// We call this the 'boneAtlas' (frameSource.h, same as Body::getBonesAtlas())
+	if (processing.oscFeatures || processing.oscBones) {
+		featureEngine.update(skeleton);
+		ofxOscMessage m;
+		for (int b = 0; b < BODY_COUNT_MAX; b++) {
+			const BodyFeatures & features = featureEngine.getBody(b);
+			if (!features.tracked) continue;
+			if (processing.oscFeatures) {
+				skeletonFeaturesMessage(b, features, m);
+				oscSender.sendMessage(m);
+			}
+			if (processing.oscBones) {
+				skeletonBonesMessage(b, features, m);
+				oscSender.sendMessage(m);
+			}
+		}
+	}
+	else {
+		featureEngine.reset();
+	}
+	timers.record(TIMING_SKELETON_OSC, StageTimers::microsSince(skeletonStart));
+
+	// Key the bodies out of the color image (see keying.h)
+	// This is the check to see if a given depth pixel is inside a tracked body or part of the background,
+	// body pixels are looked up in the color image through the depth -> color mapping above.
+	// More info here: https://msdn.microsoft.com/en-us/library/windowspreview.kinect.bodyindexframe.aspx
+	// on the gpu path the mapping goes to the shader instead (gpuKeying.h)
+	out.bKeyed = processing.bKeyed && !processing.bGpu;
+	out.bCoords = processing.bKeyed && processing.bGpu;
+	if (out.bKeyed) {
+		if (processing.keyingThreads != keyingPool.getNumThreads()) {
+			keyingPool.setup(processing.keyingThreads);
+		}
+		StageTimers::Clock::time_point keyingStart = StageTimers::Clock::now();
+		KeyingFrame keyingFrame;
+		keyingFrame.bodyIndex = frame.bodyIndex;
+		keyingFrame.colorCoords = frame.colorCoords;
+		keyingFrame.colorBGRA = frame.colorBGRA;
+		keyingFrame.outRGBA = out.keyedRGBA.data();
+		keyingFrame.depthWidth = DEPTH_WIDTH;
+		keyingFrame.depthHeight = DEPTH_HEIGHT;
+		keyingFrame.colorWidth = COLOR_WIDTH;
+		keyingFrame.colorHeight = COLOR_HEIGHT;
+		keyBodiesParallel(keyingFrame, keyingPool); // returns once every tile is done
+		timers.record(TIMING_KEYING, StageTimers::microsSince(keyingStart));
+	}
 
-		for (auto body : bodies) {
-			for (auto bone : boneAtlas) {
-				auto firstJointInBone = body.joints[bone.first];
-				auto secondJointInBone = body.joints[bone.second];
+	// depth in its 2 byte encoding straight into the NDI stream's buffer, no fbo or readback.
+	// The window goes along as metadata so receivers can get millimetres back (pixelKernels.h)
+	float encodeMicros = 0; // depth + color, one sample per frame
+	if (processing.bNdiDepthEncoded) {
+		TimingScope scope(encodeMicros);
+		ndiDepthStream.setAsync(processing.bNdiAsync);
+		unsigned char * buffer = ndiDepthStream.beginFrame();
+		if (buffer) {
+			DepthRamp ramp(processing.depthNear, processing.depthFar);
+			encodeDepth(depthEncoding, frame.depth, buffer, DEPTH_SIZE, ramp.nearMm, ramp.nearMm + ramp.range);
+			char metadata[128];
+			snprintf(metadata, sizeof(metadata), "<kv2_depth encoding=\"%s\" near=\"%u\" far=\"%u\"/>",
+				depthEncodingName(depthEncoding), ramp.nearMm, ramp.nearMm + ramp.range);
+			ndiDepthStream.sendFrame(ofGetElapsedTimeMicros(), out.arrivalMicros, metadata);
+		}
+	}
 
-		//		//now do something with the joints
+	// color straight from the Kinect's buffer into the NDI stream's, one BGRA -> UYVY pass (or a copy
+	// for BGRA), instead of upload, fboColor and a 1080p readback. The GPU only draws the preview.
+	// The frame's buffer can't go to NDI itself: async sends are read until the next one.
+	if (processing.bNdiColor) {
+		TimingScope scope(encodeMicros);
+		ndiColorStream.setAsync(processing.bNdiAsync);
+		unsigned char * buffer = ndiColorStream.beginFrame();
+		if (buffer) {
+			ndiColorStream.fillFromBGRA(buffer, frame.colorBGRA, COLOR_WIDTH * 4);
+			ndiColorStream.sendFrame(ofGetElapsedTimeMicros(), out.arrivalMicros);
+		}
+	}
+	if (processing.bNdiDepthEncoded || processing.bNdiColor) timers.record(TIMING_ENCODE, encodeMicros);
+
+	// the frame's buffers are only valid until the next FrameSource::update(), the previews get copies
+	StageTimers::Clock::time_point copyStart = StageTimers::Clock::now();
+	out.bGpuDepth = processing.bDepth && processing.bColorizeDepth && processing.bGpu;
+	out.bDepthRGBA = processing.bDepth && processing.bColorizeDepth && !processing.bGpu;
+	out.depthNear = processing.depthNear;
+	out.depthFar = processing.depthFar;
+	out.bDepth = processing.bDepth && !out.bDepthRGBA;
+	out.bBodyIndex = processing.bBodyIndex;
+	out.bColor = processing.bColor;
+	if (out.bDepth) memcpy(out.depth.data(), frame.depth, DEPTH_SIZE * sizeof(unsigned short));
+	if (out.bDepthRGBA) colorizeDepth(frame.depth, out.depthRGBA.data(), DEPTH_SIZE, out.depthNear, out.depthFar);
+	if (out.bCoords) memcpy(out.colorCoords.data(), frame.colorCoords, DEPTH_SIZE * 2 * sizeof(float));
+	if (out.bBodyIndex) memcpy(out.bodyIndex.data(), frame.bodyIndex, DEPTH_SIZE);
+	if (out.bColor) memcpy(out.colorBGRA.data(), frame.colorBGRA, out.colorBGRA.size());
+	// infrared stretched to 8 bit here (pixelKernels.h), the preview, Spout and NDI all get that.
+	// Auto gain follows the frame's percentiles, smoothed so the picture doesn't pump
+	if (kinectSource) kinectSource->setLongExposureInfrared(processing.bIrLongExposure);
+	out.bInfrared = processing.bInfrared && frame.infrared != nullptr;
+	if (out.bInfrared) {
+		int black = processing.irBlack, white = processing.irWhite;
+		if (processing.bIrAutoGain) {
+			int low, high;
+			infraredPercentiles(frame.infrared, DEPTH_SIZE, IR_AUTO_LOW, IR_AUTO_HIGH, low, high);
+			if (irAutoWhite < 0) {
+				irAutoBlack = (float)low;
+				irAutoWhite = (float)high;
 			}
+			irAutoBlack += (low - irAutoBlack) * IR_AUTO_SMOOTHING;
+			irAutoWhite += (high - irAutoWhite) * IR_AUTO_SMOOTHING;
+			black = (int)irAutoBlack;
+			white = (int)irAutoWhite;
 		}
+		if (processing.irGamma != irLevels.gamma) irLevels.setGamma(processing.irGamma);
+		irLevels.setWindow(black, white);
+		out.irBlack = irLevels.black;
+		out.irWhite = irLevels.black + irLevels.range;
+		normalizeInfrared(frame.infrared, out.infrared.data(), DEPTH_SIZE, irLevels);
 	}
-
-	//
-	//--
+	timers.record(TIMING_PREVIEW_COPY, StageTimers::microsSince(copyStart));
+	preview.publish();
 }
 
-
 //--------------------------------------------------------------
 void ofApp::draw() {
+	StageTimers::Clock::time_point drawStart = StageTimers::Clock::now();
+	memset(drawMicros, 0, sizeof(drawMicros));
 	stringstream ss;
+	const PreviewFrame & p = preview.getFront(); // the textures' frame
 
-	ofClear(0, 0, 0);
+	// headless: only the fbos of the enabled outputs are drawn, nothing goes to the (hidden) window
+	if (!bHeadless) ofClear(0, 0, 0);
 	//bgCB.draw(0, 0, ofGetWidth(), ofGetHeight());
 
 	// Color is at 1920x1080 instead of 512x424 so we should fix aspect ratio
-	float colorHeight = previewWidth * (kinect.getColorSource()->getHeight() / kinect.getColorSource()->getWidth());
+	float colorHeight = previewWidth * ((float)COLOR_HEIGHT / COLOR_WIDTH);
 	float colorTop = (previewHeight - colorHeight) / 2.0;
 
 
@@ -462,88 +751,109 @@ void ofApp::draw() {
 		// Draw Depth Source
 		// TODO: brighten depth image. https://github.com/rickbarraza/KinectV2_Lessons/tree/master/3_MakeRawDepthBrigther
 		// MORE: https://forum.openframeworks.cc/t/kinect-v2-pixel-depth-and-color/18974/4 
-		fboDepth.begin(); // start drawing to off screenbuffer
-		ofClear(255, 255, 255, 0);
-		kinect.getDepthSource()->draw(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT);  // note that the depth texture is RAW so may appear dark
-		fboDepth.end();
-		//Spout
-		if (spoutDepth) {
-			spout.sendTexture(fboDepth.getTextureReference(), depth_StreamName);
+		if (bDepthOut) {
+			TimingScope scope(drawMicros[TIMING_FBO]);
+			fboDepth.begin(); // start drawing to off screenbuffer
+			ofClear(255, 255, 255, 0);
+			if (p.bGpuDepth && depthTex.isAllocated()) gpuKeying.drawDepth(depthTex, p.depthNear, p.depthFar);
+			else if (p.bDepthRGBA) depthColorTex.draw(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT); // colorized on the cpu
+			else if (depthTex.isAllocated()) depthTex.draw(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT);  // note that the depth texture is RAW so may appear dark
+			fboDepth.end();
+		}
+		//Spout, only when there is a new frame (the preview may run faster than the Kinect)
+		if (spoutDepth && bPreviewNew) {
+			sendSpout(fboDepth, depth_StreamName, TIMING_LATENCY_SPOUT_DEPTH);
 		}
 		// NDI
-		if (ndiDepth && ndiActive && !NDIlock) {
-			// Set the sender name
-			strcpy(senderName, depth_StreamName.c_str()); // convert from std string to cstring
-			sendNDI(ndiSender3, fboDepth, bUsePBO2, DEPTH_WIDTH, DEPTH_HEIGHT, senderName, depth_ndiBuffer, depth_idx);
+		if (ndiDepth && ndiActive && !NDIlock && !ndiAtlas && depthEncoding == DEPTH_ENCODING_RGBA && bPreviewNew) {
+			sendNDI(ndiDepthStream, fboDepth, depthPbo);
 		}
 		//Draw from FBO
-		fboDepth.draw(0, 0, previewWidth, previewHeight);
+		if (!bHeadless) fboDepth.draw(0, 0, previewWidth, previewHeight);
 		//fboDepth.clear();
 	}
 
 	{
 		// Draw Color Source
-		fboColor.begin(); // start drawing to off screenbuffer
-		ofClear(255, 255, 255, 0);
-		kinect.getColorSource()->draw(0, 0, COLOR_WIDTH, COLOR_HEIGHT);
-		fboColor.end();
-		//Spout
-		if (spoutColor) {
-			spout.sendTexture(fboColor.getTextureReference(), color_StreamName);
+		if (bColorOut) {
+			TimingScope scope(drawMicros[TIMING_FBO]);
+			fboColor.begin(); // start drawing to off screenbuffer
+			ofClear(255, 255, 255, 0);
+			if (colorTex.isAllocated()) colorTex.draw(0, 0, COLOR_WIDTH, COLOR_HEIGHT);
+			fboColor.end();
 		}
-		//NDI
-		if (ndiColor && ndiActive && !NDIlock) {
-			// Set the sender name
-			strcpy(senderName, color_StreamName.c_str()); // convert from std string to cstring
-			sendNDI(ndiSender1, fboColor, bUsePBO1, COLOR_WIDTH, COLOR_HEIGHT, senderName, color_ndiBuffer, color_idx);
+		//Spout
+		if (spoutColor && bPreviewNew) {
+			sendSpout(fboColor, color_StreamName, TIMING_LATENCY_SPOUT_COLOR);
 		}
 		//Draw from FBO to UI
-		fboColor.draw(previewWidth, 0 + colorTop, previewWidth, colorHeight);
+		if (!bHeadless) fboColor.draw(previewWidth, 0 + colorTop, previewWidth, colorHeight);
 		//fboColor.clear();
 	}
 
 	{
-		// Draw IR Source
-		kinect.getInfraredSource()->draw(0, previewHeight, DEPTH_WIDTH, DEPTH_HEIGHT);
-		//kinect.getLongExposureInfraredSource()->draw(0, previewHeight, previewWidth, previewHeight);
+		// Draw IR Source, normalized to 8 bit on the acquisition thread
+		if (bInfraredOut) {
+			TimingScope scope(drawMicros[TIMING_FBO]);
+			fboInfrared.begin();
+			ofClear(0, 0, 0, 255);
+			if (infraredTex.isAllocated()) infraredTex.draw(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT);
+			fboInfrared.end();
+		}
+		//Spout
+		if (spoutInfrared && bPreviewNew) {
+			sendSpout(fboInfrared, infrared_StreamName, TIMING_LATENCY_SPOUT_INFRARED);
+		}
+		// NDI
+		if (ndiInfrared && ndiActive && !NDIlock && bPreviewNew) {
+			sendNDI(ndiInfraredStream, fboInfrared, infraredPbo);
+		}
+		if (!bHeadless) fboInfrared.draw(0, previewHeight, previewWidth, previewHeight);
 	}
 
 	{
 		// Draw B+W cutout of Bodies
-		fboDepth.begin(); // start drawing to off screenbuffer
-		ofClear(255, 255, 255, 0);
-		kinect.getBodyIndexSource()->draw(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT);
-		fboDepth.end();
+		if (bCutoutOut) {
+			TimingScope scope(drawMicros[TIMING_FBO]);
+			fboCutout.begin(); // start drawing to off screenbuffer
+			ofClear(255, 255, 255, 0);
+			if (bodyIndexTex.isAllocated()) bodyIndexTex.draw(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT);
+			fboCutout.end();
+		}
 		//Spout
-		if (spoutCutOut) {
-			spout.sendTexture(fboDepth.getTextureReference(), "kv2_cutout");
+		if (spoutCutOut && bPreviewNew) {
+			sendSpout(fboCutout, "kv2_cutout", TIMING_LATENCY_SPOUT_CUTOUT);
 		}
 		// NDI
-		if (ndiCutOut && ndiActive && !NDIlock) {
-			// Set the sender name
-			strcpy(senderName, cutout_StreamName.c_str()); // convert from std string to cstring
-			sendNDI(ndiSender2, fboDepth, bUsePBO2, DEPTH_WIDTH, DEPTH_HEIGHT, senderName, cutout_ndiBuffer, cutout_idx);
+		if (ndiCutOut && ndiActive && !NDIlock && !ndiAtlas && bPreviewNew) {
+			sendNDI(ndiCutoutStream, fboCutout, cutoutPbo);
 		}
 		//Draw from FBO
-		fboDepth.draw(previewWidth, previewHeight, previewWidth, previewHeight);
+		if (!bHeadless) fboCutout.draw(previewWidth, previewHeight, previewWidth, previewHeight);
 		//fboDepth.clear();
 	}
 
 	{
 		// greenscreen/keyed fx from coordmaping
-		fboDepth.begin(); // start drawing to off screenbuffer
-		ofClear(255, 255, 255, 0);
-		foregroundImg.draw(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT);
-		fboDepth.end();
+		if (bKeyedOut) {
+			TimingScope scope(drawMicros[TIMING_FBO]);
+			fboKeyed.begin(); // start drawing to off screenbuffer
+			ofClear(255, 255, 255, 0);
+			if (p.bCoords && bodyIndexTex.isAllocated() && colorTex.isAllocated()) gpuKeying.drawKeyed(bodyIndexTex, coordTex, colorTex);
+			else if (keyedTex.isAllocated()) keyedTex.draw(0, 0, DEPTH_WIDTH, DEPTH_HEIGHT);
+			fboKeyed.end();
+		}
 		//Spout
 		if (spoutKeyed) {
 			//ofSetFrameRate(30);
-			spout.sendTexture(fboDepth.getTextureReference(), "kv2_keyed");
+			if (bPreviewNew) sendSpout(fboKeyed, "kv2_keyed", TIMING_LATENCY_SPOUT_KEYED);
 			//Draw from FBO, removed if not checked
-			ofEnableBlendMode(OF_BLENDMODE_ALPHA);
-			fboDepth.draw(previewWidth * 2, 0, previewWidth, previewHeight);
+			if (!bHeadless) {
+				ofEnableBlendMode(OF_BLENDMODE_ALPHA);
+				fboKeyed.draw(previewWidth * 2, 0, previewWidth, previewHeight);
+			}
 		}
-		else {
+		else if (!bHeadless) {
 			//ofSetFrameRate(60);
 			ss.str("");
 			ss << "Keyed image only shown when" << endl;
@@ -552,25 +862,51 @@ void ofApp::draw() {
 			ofDrawBitmapStringHighlight(ss.str(), previewWidth * 2 + 20, previewHeight - (previewHeight / 2 + 60));
 		}
 		// NDI
-		if (ndiKeyed && ndiActive && !NDIlock) {
-			// Set the sender name
-			strcpy(senderName, keyed_StreamName.c_str()); // convert from std string to cstring
-			sendNDI(ndiSender4, fboDepth, bUsePBO2, DEPTH_WIDTH, DEPTH_HEIGHT, senderName, keyed_ndiBuffer, keyed_idx);
+		if (ndiKeyed && ndiActive && !NDIlock && !ndiAtlas && bPreviewNew) {
+			sendNDI(ndiKeyedStream, fboKeyed, keyedPbo);
 		}
 	}
 
+	if (ndiAtlas && ndiActive && !NDIlock && (ndiDepth || ndiCutOut || ndiKeyed) && bPreviewNew) {
+		// depth, cutout and keyed side by side, one readback for all three
+		sendNDIAtlas();
+	}
+
+	if (!bHeadless) drawOverlays();
+
+	// render stages of this draw(), the send ones only when something went out
+	timers.record(TIMING_FBO, drawMicros[TIMING_FBO]);
+	if (bPreviewNew) {
+		int sendStages[] = { TIMING_READBACK, TIMING_NDI_QUEUE, TIMING_SPOUT };
+		for (int stage : sendStages) {
+			if (drawMicros[stage] > 0) timers.record(stage, drawMicros[stage]);
+		}
+	}
+	timers.record(TIMING_DRAW, StageTimers::microsSince(drawStart));
+}
+
+//--------------------------------------------------------------
+// Skeletons, status text, timing overlay and the GUI over the previews, skipped when headless
+void ofApp::drawOverlays() {
+	stringstream ss;
+
 	{
 		// Draw bodies joints+bones over
-		kinect.getBodySource()->drawProjected(previewWidth * 2, previewHeight, previewWidth, previewHeight, ofxKFW2::ProjectionCoordinates::DepthCamera);
+		drawBodies(previewWidth * 2, previewHeight, previewWidth, previewHeight);
 	}
 
 	ss.str("");
-	ss << "fps : " << ofGetFrameRate();
+	const PreviewFrame & p = preview.getFront();
+	ss << "fps : " << ofGetFrameRate() << ", OSC out " << p.oscLatencyMicros / 1000.0f << " ms after frame";
 	if (!bHaveAllStreams) ss << endl << "Not all streams detected!";
+	if (p.bRecording) {
+		ss << endl << "REC " << p.framesWritten << " frames, " << p.bytesWritten / (1024 * 1024) << " MB";
+		if (p.framesDropped) ss << " (" << p.framesDropped << " dropped)";
+	}
 	ofDrawBitmapStringHighlight(ss.str(), 20, previewHeight * 2 - 25);
 
 	ss.str("");
-	ss << "Keyed FX : cpu heavy";
+	ss << "Keyed FX : " << (p.bCoords ? "GPU shader" : keyingPathName(KEYING_AUTO));
 	ofDrawBitmapStringHighlight(ss.str(), previewWidth * 2 + 20, 20);
 
 	ss.str("");
@@ -587,13 +923,30 @@ void ofApp::draw() {
 	ofDrawBitmapStringHighlight(ss.str(), previewWidth * 2 + 20, previewHeight + 20);
 
 	ss.str("");
-	ss << "Depthmap : ";
+	ss << "Depthmap : " << frameSource->getName();
 	ofDrawBitmapStringHighlight(ss.str(), 20, 20);
 
 	ss.str("");
-	ss << "Infrared : ";
+	ss << "Infrared : " << p.irBlack << ".." << p.irWhite << (irAutoGain ? " auto" : "") << (irLongExposure ? ", long exposure" : "");
 	ofDrawBitmapStringHighlight(ss.str(), 20, previewHeight + 20);
 
+	if (ndiActive && !NDIlock) {
+		ss.str("");
+		ss << "NDI " << (ndiAsync ? "async" : "sync") << " sent / dropped / late / queued";
+		NdiStream * streams[] = { &ndiColorStream, &ndiCutoutStream, &ndiDepthStream, &ndiKeyedStream, &ndiInfraredStream };
+		for (NdiStream * stream : streams) {
+			ss << endl << stream->getName() << " : " << stream->getFramesSent() << " / "
+				<< stream->getFramesDropped() << " / " << stream->getFramesLate() << " / " << stream->getQueued();
+		}
+		PboRing * pbos[] = { &cutoutPbo, &depthPbo, &keyedPbo, &infraredPbo, &atlasPbo };
+		int pboDropped = 0;
+		for (PboRing * pbo : pbos) {
+			pboDropped += pbo->getFramesDropped();
+		}
+		ss << endl << "readback dropped : " << pboDropped;
+		ofDrawBitmapStringHighlight(ss.str(), previewWidth + 20, previewHeight * 2 - 85);
+	}
+
 	if (ndiActive && NDIlock) {
 		// NDI active has been toggled, and a restart of the app is required to use NDI
 		ss.str("");
@@ -601,13 +954,80 @@ void ofApp::draw() {
 		ofDrawBitmapStringHighlight(ss.str(), 20, previewHeight * 2 - 10, ofColor::black, ofColor::red);
 	}
 
+	if (timingOverlay) {
+		drawTimings(20, 45);
+	}
+
 	gui.draw();
 }
 
+//--------------------------------------------------------------
+// p50 / p95 / p99 / max of every stage in ms, over the previews
+void ofApp::drawTimings(float x, float y) {
+	stringstream ss;
+	ss << std::fixed << std::setprecision(2);
+	ss << "stage               p50     p95     p99     max";
+	for (int s = 0; s < TIMING_STAGE_COUNT; s++) {
+		TimingSummary summary;
+		if (!timers.summarize(s, summary)) continue;
+		if (s == TIMING_FIRST_LATENCY) ss << endl << "arrival -> sent";
+		ss << endl << std::left << std::setw(18) << StageTimers::getName(s) << std::right
+			<< std::setw(6) << summary.p50 << "  " << std::setw(6) << summary.p95 << "  "
+			<< std::setw(6) << summary.p99 << "  " << std::setw(6) << summary.max;
+	}
+	ofDrawBitmapStringHighlight(ss.str(), x, y);
+}
+
+//--------------------------------------------------------------
+// Skeletons of the current frame, drawn at the joints' depth map positions
+void ofApp::drawBodies(float x, float y, float width, float height) {
+	// newest skeletons from the store, raw (unfiltered) depth map positions
+	if (!skeletonHistory.getLatest(drawSkeleton)) return;
+	const SkeletonFrame & skel = drawSkeleton;
+
+	ofPushStyle();
+	ofPushMatrix();
+	ofTranslate(x, y);
+	ofScale(width / DEPTH_WIDTH, height / DEPTH_HEIGHT);
+	ofSetLineWidth(3);
+	for (int b = 0; b < BODY_COUNT_MAX; b++) {
+		if (!skel.tracked[b]) continue;
+		ofSetColor(ofColor::fromHsb(b * 255 / BODY_COUNT_MAX, 200, 255));
+
+		for (auto& bone : boneAtlas) {
+			int first = SkeletonFrame::index(b, bone[0]);
+			int second = SkeletonFrame::index(b, bone[1]);
+			if (skel.trackingState[first] == JOINT_NOT_TRACKED || skel.trackingState[second] == JOINT_NOT_TRACKED) continue;
+			ofDrawLine(skel.depthPosition[0][first], skel.depthPosition[1][first], skel.depthPosition[0][second], skel.depthPosition[1][second]);
+		}
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			int i = SkeletonFrame::index(b, j);
+			if (skel.trackingState[i] == JOINT_NOT_TRACKED) continue;
+			ofDrawCircle(skel.depthPosition[0][i], skel.depthPosition[1][i], skel.trackingState[i] == JOINT_TRACKED ? 5 : 3);
+		}
+	}
+	ofPopMatrix();
+	ofPopStyle();
+}
+
 void ofApp::exit() {
 	gui.saveToFile(guiFile);
-	if (ndiPbo1[0]) glDeleteBuffers(2, ndiPbo1); // clean up NDI_1 - HD
-	if (ndiPbo2[0]) glDeleteBuffers(2, ndiPbo2); // clean up NDI_2 - DepthsSize
+	acquisition.stop(); // before anything it uses goes away
+	timingLog.close();
+	keyingPool.stop();
+	frameSource->close(); // finishes writing any recording
+	ndiColorStream.close();
+	ndiCutoutStream.close();
+	ndiDepthStream.close();
+	ndiKeyedStream.close();
+	ndiInfraredStream.close();
+	if (bNdiInitialized) NDIlib_destroy();
+	cutoutPbo.close();
+	depthPbo.close();
+	keyedPbo.close();
+	infraredPbo.close();
+	atlasPbo.close();
+	oscControl.stop();
 	oscSendMsg("closed", "/kv2status/");
 }
 
@@ -622,189 +1042,315 @@ void ofApp::oscSendMsg(string message, string address)
 	oscSender.sendMessage(m);
 }
 
-string ofApp::escape_quotes(const string &before)
-// sourced from: http://stackoverflow.com/questions/1162619/fastest-quote-escaping-implementation
-{
-	string after;
-	after.reserve(before.length() + 4);  // TODO: may need to increase reserve...
+void ofApp::sendSkeletonSchema() {
+	ofxOscMessage m;
+	skeletonSchemaMessage(m);
+	oscSender.sendMessage(m);
+	schemaSentTime = ofGetElapsedTimef();
+}
+
+// Timing percentiles out every TIMING_EXPORT_INTERVAL, to OSC as one bundle and / or the CSV log
+void ofApp::exportTimings() {
+	if (processing.bTimingCsv != bTimingCsvRequested) {
+		bTimingCsvRequested = processing.bTimingCsv;
+		if (bTimingCsvRequested) {
+			string path = ofToDataPath(logsFolder + "timing_" + ofGetTimestampString("%Y-%m-%d_%H-%M-%S") + ".csv", true);
+			ofDirectory::createDirectory(logsFolder, true, true);
+			if (!timingLog.open(path)) ofLogError("kv2") << "Could not write timing log " << path;
+		}
+		else {
+			timingLog.close();
+		}
+	}
 
-	for (string::size_type i = 0; i < before.length(); ++i) {
-		switch (before[i]) {
-		case '"':
-		case '\\':
-			after += '\\';
-			// Fall through.
-		default:
-			after += before[i];
+	float now = ofGetElapsedTimef();
+	if (now - timingSentTime < TIMING_EXPORT_INTERVAL) return;
+	timingSentTime = now;
+
+	timingLog.write(timers, now);
+	if (processing.bTimingOsc) {
+		ofxOscBundle bundle;
+		for (int s = 0; s < TIMING_STAGE_COUNT; s++) {
+			TimingSummary summary;
+			if (!timers.summarize(s, summary)) continue;
+			ofxOscMessage m;
+			m.setAddress(string(TIMING_OSC_ADDRESS) + StageTimers::getName(s));
+			m.addFloatArg(summary.p50);
+			m.addFloatArg(summary.p95);
+			m.addFloatArg(summary.p99);
+			m.addFloatArg(summary.max);
+			m.addIntArg((int)summary.samples);
+			bundle.addMessage(m);
 		}
+		oscSender.sendBundle(bundle);
 	}
-	return after;
 }
 
 //--------------------------------------------------------------
-void ofApp::HostFieldChanged() {
-	cout << "fieldChange" << endl;
-	bool broadcast = oscSender.getSettings().broadcast;
-	broadcast = false;
-	oscSender.setup(HostField, oscPort);
-	oscReceiver.setup(oscPortIn);
-	cout << "updated" << endl;
-	oscSendMsg("fieldUpdated", "/kv2status/");
+// OSC remote control addresses, one per GUI control that can change at runtime
+// (the <reboot> ones can't). Args are converted to the control's type, see OscCommandType.
+void ofApp::setupControls() {
+	ControlBinding binding = {};
+	auto toggle = [&](const string & address, ofxToggle & control) {
+		ControlBinding b = binding;
+		b.toggle = &control;
+		addControl(address, b, OSC_COMMAND_BOOL);
+	};
+	auto intSlider = [&](const string & address, ofxIntSlider & control) {
+		ControlBinding b = binding;
+		b.intSlider = &control;
+		addControl(address, b, OSC_COMMAND_INT);
+	};
+	auto floatSlider = [&](const string & address, ofxFloatSlider & control) {
+		ControlBinding b = binding;
+		b.floatSlider = &control;
+		addControl(address, b, OSC_COMMAND_FLOAT);
+	};
+
+	toggle("/kV2/osc/json", jsonGrouped);
+	toggle("/kV2/osc/binary", oscBinary);
+	toggle("/kV2/osc/bundles", oscBundles);
+	toggle("/kV2/osc/features", oscFeatures);
+	toggle("/kV2/osc/bones", oscBones);
+	toggle("/kV2/osc/delta", oscDelta);
+	floatSlider("/kV2/osc/deadband", oscDeadBand);
+	floatSlider("/kV2/osc/keyframe", oscKeyframe);
+
+	toggle("/kV2/spout/cutout", spoutCutOut);
+	toggle("/kV2/spout/color", spoutColor);
+	toggle("/kV2/spout/keyed", spoutKeyed);
+	toggle("/kV2/spout/depth", spoutDepth);
+	toggle("/kV2/spout/infrared", spoutInfrared);
+
+	toggle("/kV2/ndi/cutout", ndiCutOut);
+	toggle("/kV2/ndi/color", ndiColor);
+	toggle("/kV2/ndi/keyed", ndiKeyed);
+	toggle("/kV2/ndi/depth", ndiDepth);
+	toggle("/kV2/ndi/infrared", ndiInfrared);
+	toggle("/kV2/ndi/async", ndiAsync);
+	toggle("/kV2/ndi/atlas", ndiAtlas);
+
+	intSlider("/kV2/filter/type", filterType);
+	floatSlider("/kV2/filter/minCutoff", filterMinCutoff);
+	floatSlider("/kV2/filter/beta", filterBeta);
+	floatSlider("/kV2/filter/dCutoff", filterDCutoff);
+	floatSlider("/kV2/filter/smoothing", filterSmoothing);
+	floatSlider("/kV2/filter/trend", filterTrend);
+	floatSlider("/kV2/filter/predict", filterPredict);
+
+	intSlider("/kV2/keying/threads", keyingThreads);
+	toggle("/kV2/keying/gpu", gpuShaders);
+	toggle("/kV2/depth/colorize", depthColorize);
+	intSlider("/kV2/depth/near", depthNear);
+	intSlider("/kV2/depth/far", depthFar);
+	toggle("/kV2/ir/autoGain", irAutoGain);
+	intSlider("/kV2/ir/black", irBlack);
+	intSlider("/kV2/ir/white", irWhite);
+	floatSlider("/kV2/ir/gamma", irGamma);
+	toggle("/kV2/ir/longExposure", irLongExposure);
+
+	toggle("/kV2/timing/overlay", timingOverlay);
+	toggle("/kV2/timing/osc", timingOsc);
+	toggle("/kV2/timing/csv", timingCsv);
+
+	toggle("/kV2/record", recordToggle);
+	toggle("/kV2/record/compressDepth", compressDepthToggle);
+	toggle("/kV2/record/compressColor", compressColorToggle);
+
+	// output host / ports, the sender and receiver are set up again once the frame's commands are in
+	ControlBinding b = binding;
+	b.action = CONTROL_RECONNECT;
+	b.textField = &HostField;
+	addControl("/kV2/osc/host", b, OSC_COMMAND_STRING);
+	b = binding;
+	b.action = CONTROL_RECONNECT;
+	b.intField = &oscPort;
+	addControl("/kV2/osc/port", b, OSC_COMMAND_INT);
+	b.intField = &oscPortIn;
+	addControl("/kV2/osc/portIn", b, OSC_COMMAND_INT);
+
+	b = binding;
+	b.action = CONTROL_APP_EXIT;
+	addControl("/app-exit", b, OSC_COMMAND_TRIGGER);
+	b.action = CONTROL_SCHEMA_GET;
+	addControl(SKELETON_SCHEMA_GET_ADDRESS, b, OSC_COMMAND_TRIGGER);
 }
 
-//--------------------------------------------------------------
-void ofApp::body2JSON(vector<ofxKinectForWindows2::Data::Body> bodies, const char * jointNames[]) {
-	// TODO: create factory
-	for (auto body : bodies) {
-		string bdata = ""; // start JSON array build of body data
-		string newData = ""; // start JSON array build of joints data
-		for (auto joint : body.joints) {
-			auto pos = joint.second.getPositionInWorld();
-			string name = jointNames[joint.first];
-			newData = "\"j\":";  // j for joint ;)
-			newData = newData + "\"" + name + "\",";
-			newData = newData + "\"x\":" + to_string(pos.x) + ",";
-			newData = newData + "\"y\":" + to_string(pos.y) + ",";
-			newData = newData + "\"z\":" + to_string(pos.z);
-			newData = "{" + newData + "}";
-			// format= {"\j\":\"jointName\",\"x\":0.1,\"y\":0.2,\"z\":0.3 }
-			if (bdata == "") {  // if bdata = "" no comma
-				bdata = newData;
-			}
-			else {
-				bdata = bdata + "," + newData;
-			}
-		} // end inner joints loop
-
-		  // format= {"\joint\":\"jointName\",\"x\":0.1,\"y\":0.2,\"z\":0.3 }
-		  // {"j":"SpineBase","x":-0.102359,"y":-0.669035,"z":1.112273}
-
-		  // TODO: add below features to non Json OSC
-		  // body.activity ?? contains more.. worth looking into 
-		newData = "\"LH-st8\":" + to_string(body.leftHandState);
-		newData = "{" + newData + "}";
-		// if tracked add ',' and bdata, otherwise bdata = newData. Fixes trailing ',' for non tracked bodies
-		if (!body.tracked) {
-			bdata = newData;
-		}
-		else {
-			bdata = newData + "," + bdata;
-		}
-
-		newData = "\"RH-st8\":" + to_string(body.rightHandState);
-		newData = "{" + newData + "}";
-		bdata = newData + "," + bdata;
+void ofApp::addControl(const string & address, ControlBinding binding, OscCommandType type) {
+	oscControl.addTarget(address, (int)controls.size(), type);
+	controls.push_back(binding);
+}
 
-		newData = "\"ID\":" + to_string(body.trackingId);
-		newData = "{" + newData + "}";
-		bdata = newData + "," + bdata;
+void ofApp::applyControl(const OscCommand & command, bool & bReconnect) {
+	if (command.target < 0 || command.target >= (int)controls.size()) return;
+	const ControlBinding & binding = controls[command.target];
+
+	if (binding.toggle) *binding.toggle = command.intValue != 0;
+	if (binding.intSlider) *binding.intSlider = ofClamp(command.intValue, binding.intSlider->getMin(), binding.intSlider->getMax());
+	if (binding.floatSlider) *binding.floatSlider = ofClamp(command.floatValue, binding.floatSlider->getMin(), binding.floatSlider->getMax());
+	if (binding.intField) *binding.intField = command.intValue;
+	if (binding.textField) *binding.textField = string(command.text);
+
+	switch (binding.action) {
+	case CONTROL_RECONNECT:
+		bReconnect = true;
+		break;
+	case CONTROL_APP_EXIT:
+		acquisition.stop(); // the sender is the acquisition thread's
+		oscSendMsg("exit", "/kv2status/");
+		exit();
+		std::exit(0);
+		break;
+	case CONTROL_SCHEMA_GET:
+		schemaRequests++; // sent by the acquisition thread
+		break;
+	default:
+		break;
+	}
+}
 
-		newData = "\"tracked\":" + to_string(body.tracked);
-		newData = "{" + newData + "}";
-		bdata = newData + "," + bdata;
+//--------------------------------------------------------------
+void ofApp::HostFieldChanged() {
+	// rebinding would drop the commands still queued, only when the input port changed
+	if (oscPortIn != oscControlPort) oscControlPort = oscControl.start(oscPortIn) ? oscPortIn : -1;
+	oscReconnects++; // the acquisition thread sets the sender up with the next settings
+}
 
-		// need to escape all " in bdata
-		bdata = escape_quotes(bdata);
-		bdata = "[" + bdata + "]";
-		bdata = "{\"b" + to_string(body.bodyId) + "\": \"" + bdata + "\"}";
+//--------------------------------------------------------------
+void ofApp::body2JSON(const BodySample bodies[], const char * jointNames[], const SkeletonDelta * delta) {
+	for (int b = 0; b < BODY_COUNT_MAX; b++) {
+		// with deltas: unchanged bodies are skipped, the joint array only holds joints that moved
+		if (delta && !delta->bSendBody[b]) continue;
+		unsigned int jointMask = delta ? delta->jointMask[b] : SKELETON_DELTA_ALL_JOINTS;
+		// format= {"b0": "[{\"tracked\":1},{\"ID\":...},...]"}, see bodyJson.h
+		const char * bdata = bodyJson.write(bodies[b], jointNames, jointMask);
 		//cout << bdata << endl;
 		ofxOscMessage m;
-		string adrs = "/kV2/body/" + to_string(body.bodyId);
-		m.setAddress(adrs);
+		m.setAddress(bodyJson.getAddress());
 		m.addStringArg(bdata);
 		oscSender.sendMessage(m);
 	} // end body loop
 }
 
 // NDI
-// straight from ofxNDI examples
-void ofApp::sendNDI(ofxNDIsender & ndiSender_, ofFbo & sourceFBO_,
-	bool bUsePBO_, int senderWidth_, int senderHeight_, char senderName_[256], ofPixels ndiBuffer_[], int idx_)
+// straight from ofxNDI examples, the buffer now comes from the stream's ring
+void ofApp::sendNDI(NdiStream & stream, ofFbo & sourceFBO_, PboRing & pbo)
 {
-	if (ndiSender_.GetAsync())
-		idx_ = (idx_ + 1) % 2;
+	stream.setAsync(ndiAsync);
+	unsigned long long renderMicros = ofGetElapsedTimeMicros();
+	long long arrivalMicros = preview.getFront().arrivalMicros;
 
 	// Extract pixels from the fbo.
-	if (bUsePBO_) {
-		// Read fbo using two pbos
-		// if (&ndiSender == &ndiSender1) {}
-		ReadFboPixels(sourceFBO_, senderWidth_, senderHeight_, ndiBuffer_[idx_].getPixels());
+	if (bUsePBO) {
+		// queue this frame's readback, send whichever earlier one has arrived
+		{
+			TimingScope scope(drawMicros[TIMING_READBACK]);
+			pbo.startTransfer(sourceFBO_, renderMicros, arrivalMicros);
+			if (!pbo.hasCompleted()) return;
+		}
 
+		unsigned char * buffer;
+		{
+			TimingScope scope(drawMicros[TIMING_NDI_QUEUE]);
+			buffer = stream.beginFrame();
+			if (!buffer) {
+				// every buffer still in use by NDI, the stream counts the drop, not the ring too
+				pbo.skipCompleted();
+				return;
+			}
+		}
+		bool bCopied;
+		{
+			// converted to the stream's format straight out of the mapped PBO
+			TimingScope scope(drawMicros[TIMING_READBACK]);
+			const unsigned char * pixels = pbo.mapCompleted(renderMicros, arrivalMicros);
+			bCopied = pixels != nullptr;
+			if (bCopied) {
+				stream.fillFromRGBA(buffer, pixels, stream.getWidth() * 4);
+				pbo.unmapCompleted();
+			}
+		}
+		TimingScope scope(drawMicros[TIMING_NDI_QUEUE]);
+		if (!bCopied) {
+			stream.cancelFrame();
+			return;
+		}
+		stream.sendFrame(renderMicros, arrivalMicros);
 	}
 	else {
 		// Read fbo directly
-		sourceFBO_.bind();
-		glReadPixels(0, 0, senderWidth_, senderHeight_, GL_RGBA, GL_UNSIGNED_BYTE, ndiBuffer_[idx_].getPixels());
-		sourceFBO_.unbind();
-	}
-
-	// Send the RGBA ofPixels buffer to NDI
-	// If you did not set the sender pixel format to RGBA in CreateSender
-	// you can convert to bgra within SendImage (specify true for bSwapRB)
-	if (ndiSender_.SendImage(ndiBuffer_[idx_].getPixels(), senderWidth_, senderHeight_)) {
-		// Send Image was successful
+		unsigned char * buffer = stream.beginFrame();
+		if (!buffer) return;
+		{
+			TimingScope scope(drawMicros[TIMING_READBACK]);
+			bool bRGBA = stream.getFormat() == NDI_FORMAT_RGBA;
+			if (!bRGBA) readbackPixels.resize(stream.getWidth() * stream.getHeight() * 4);
+			sourceFBO_.bind();
+			glReadPixels(0, 0, stream.getWidth(), stream.getHeight(), GL_RGBA, GL_UNSIGNED_BYTE, bRGBA ? buffer : readbackPixels.data());
+			sourceFBO_.unbind();
+			if (!bRGBA) stream.fillFromRGBA(buffer, readbackPixels.data(), stream.getWidth() * 4);
+		}
+		TimingScope scope(drawMicros[TIMING_NDI_QUEUE]);
+		stream.sendFrame(renderMicros, arrivalMicros);
 	}
 }
 
 // NDI
-// Asynchronous Read-back
-// adapted from : http://www.songho.ca/opengl/gl_pbo.html
-// straight from ofxNDI examples
-bool ofApp::ReadFboPixels(ofFbo fbo, unsigned int width, unsigned int height, unsigned char *data)
+// The three depth sized streams through one fbo + readback: fboAtlas holds depth | cutout | keyed,
+// each sender gets its third of the pixels
+void ofApp::sendNDIAtlas()
 {
-	void *pboMemory;
-
-	if (width == COLOR_WIDTH) {
-		// dealing with HD size video
-		Pbo1Index = (Pbo1Index + 1) % 2;
-		NextPbo1Index = (Pbo1Index + 1) % 2;
+	unsigned long long renderMicros = ofGetElapsedTimeMicros();
+	long long arrivalMicros = preview.getFront().arrivalMicros;
 
-		// Bind the fbo passed in
-		fbo.bind();
+	{
+		TimingScope scope(drawMicros[TIMING_FBO]);
+		fboAtlas.begin();
+		ofClear(0, 0, 0, 0);
+		ofPushStyle();
+		ofDisableBlendMode(); // copy alpha as is
+		fboDepth.draw(0, 0);
+		fboCutout.draw(DEPTH_WIDTH, 0);
+		fboKeyed.draw(DEPTH_WIDTH * 2, 0);
+		ofPopStyle();
+		fboAtlas.end();
+	}
 
-		// Set the target framebuffer to read
-		glReadBuffer(GL_FRONT);
+	const unsigned char * pixels;
+	{
+		TimingScope scope(drawMicros[TIMING_READBACK]);
+		atlasPbo.startTransfer(fboAtlas, renderMicros, arrivalMicros);
+		pixels = atlasPbo.mapCompleted(renderMicros, arrivalMicros);
+		if (!pixels) return;
+	}
 
-		// Bind the current PBO
-		glBindBuffer(GL_PIXEL_PACK_BUFFER, ndiPbo1[Pbo1Index]);
+	TimingScope scope(drawMicros[TIMING_NDI_QUEUE]);
 
-		// Read pixels from framebuffer to the current PBO - glReadPixels() should return immediately.
-		//glReadPixels(0, 0, width, height, GL_BGRA_EXT GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid *)0);
-		// Send RGBA
-		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid *)0);
+	NdiStream * streams[ATLAS_STREAMS] = { &ndiDepthStream, &ndiCutoutStream, &ndiKeyedStream };
+	bool bEnabled[ATLAS_STREAMS] = { ndiDepth && depthEncoding == DEPTH_ENCODING_RGBA, ndiCutOut, ndiKeyed };
+	const int atlasStride = DEPTH_WIDTH * ATLAS_STREAMS * 4;
+	for (int i = 0; i < ATLAS_STREAMS; i++) {
+		if (!bEnabled[i]) continue;
+		NdiStream & stream = *streams[i];
+		stream.setAsync(ndiAsync);
+		unsigned char * buffer = stream.beginFrame();
+		if (!buffer) continue;
 
-		// Map the previous PBO to process its data by CPU
-		glBindBuffer(GL_PIXEL_PACK_BUFFER, ndiPbo1[NextPbo1Index]);
-	}
-	else {
-		// dealing with depth size video
-		Pbo2Index = (Pbo2Index + 1) % 2;
-		NextPbo2Index = (Pbo2Index + 1) % 2;
-		fbo.bind();
-		glReadBuffer(GL_FRONT);
-		glBindBuffer(GL_PIXEL_PACK_BUFFER, ndiPbo2[Pbo2Index]);
-		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid *)0);
-		glBindBuffer(GL_PIXEL_PACK_BUFFER, ndiPbo2[NextPbo2Index]);
+		stream.fillFromRGBA(buffer, pixels + i * DEPTH_WIDTH * 4, atlasStride);
+		stream.sendFrame(renderMicros, arrivalMicros);
 	}
+	atlasPbo.unmapCompleted();
+}
 
-
-	pboMemory = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
-	if (pboMemory) {
-		// Use SSE2 mempcy
-		ofxNDIutils::CopyImage((unsigned char *)pboMemory, data, width, height, width * 4);
-		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
-	}
-	else {
-		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-		fbo.unbind();
-		return false;
+// Spout
+// shares the fbo's texture, so done once sendTexture() returns
+void ofApp::sendSpout(ofFbo & fbo, const string & name, int latencyStage)
+{
+	{
+		TimingScope scope(drawMicros[TIMING_SPOUT]);
+		spout.sendTexture(fbo.getTextureReference(), name);
 	}
-
-	// Back to conventional pixel operation
-	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-	fbo.unbind();
-
-	return true;
+	timers.record(latencyStage, (float)(frameSourceMicros() - preview.getFront().arrivalMicros));
 }
 
 //--------------------------------------------------------------
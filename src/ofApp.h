@@ -2,12 +2,31 @@
 
 
 #include "ofMain.h"
-#include "ofxKinectForWindows2.h"
 #include "ofxOsc.h"
 #include "ofxGui.h"
 #include "ofxSpout2Sender.h"
 #include "ofxNDI.h"
 
+#include "frameSource.h"
+#include "kinectFrameSource.h"
+#include "frameRecorder.h"
+#include "frameReplay.h"
+#include "keying.h"
+#include "gpuKeying.h"
+#include "pixelKernels.h"
+#include "ndiStream.h"
+#include "pboRing.h"
+#include "skeletonOsc.h"
+#include "bodyJson.h"
+#include "skeletonFilter.h"
+#include "oscControl.h"
+#include "workerPool.h"
+#include "acquisitionThread.h"
+#include "tripleBuffer.h"
+#include "stageTimers.h"
+
+#include <mutex>
+
 
 //  ** added from NDI sender example **
 // BGRA definition should be in glew.h 
@@ -17,6 +36,14 @@
 #endif
 //  ^^ added from NDI sender example ^^
 
+#define ATLAS_STREAMS 3 // depth, cutout, keyed share one NDI readback in atlas mode
+#define IR_AUTO_LOW 1.0f        // auto gain: percentile that goes black
+#define IR_AUTO_HIGH 99.5f      // percentile that goes white
+#define IR_AUTO_SMOOTHING 0.1f  // per frame, so the gain doesn't flicker
+#define OSC_HOST_MAX 64
+#define HEADLESS_FRAME_RATE 120      // render loop cap when headless, outputs go out on the next loop after a frame
+#define HEADLESS_STATUS_INTERVAL 10  // seconds between the console status lines when headless
+
 class ofApp : public ofBaseApp{
 
 	public:
@@ -34,8 +61,103 @@ class ofApp : public ofBaseApp{
 		void windowResized(int w, int h);
 		void gotMessage(ofMessage msg);
 		
-		ofxKFW2::Device kinect;
-		ICoordinateMapper* coordinateMapper;
+		// Kinect frames (live or replayed), see frameSource.h
+		std::unique_ptr<FrameSource> frameSource;
+		RecordingFrameSource * recorder; // == frameSource, wraps the live / replay source
+		string replayPath;               // set from the command line (--replay <file>) before setup()
+		bool bReplayUnthrottled = false; // --unthrottled
+		double replayStartSeconds = 0;   // --seek <seconds>
+		bool bHeadless = false;          // --headless: no preview, GUI or overlays, only the outputs
+
+		// Frames are waited for, processed and sent out over OSC on the acquisition thread
+		// (acquisitionThread.h), so neither the render rate nor a slow draw() delays them.
+		// update() / draw() only upload and show the newest PreviewFrame.
+		// The GUI values processFrame() needs are copied into settings by update(), and from
+		// there into processing at the start of every frame, so they only change between frames.
+		struct ProcessingSettings {
+			bool jsonGrouped, oscBinary, oscBundles, oscFeatures, oscBones, oscDelta;
+			float oscDeadBand, oscKeyframe;
+			SkeletonFilterSettings filter;
+			int keyingThreads;
+			bool bKeyed;
+			bool bGpu;           // keyed composite / depth colorization in shaders (gpuKeying.h)
+			bool bColorizeDepth; // depth gray ramp instead of raw depth, on the cpu if not bGpu
+			int depthNear, depthFar;
+			bool bDepth, bBodyIndex, bColor, bInfrared; // planes update() uploads, see updateOutputs()
+			bool bNdiDepthEncoded; // depth encoded straight into ndiDepthStream (pixelKernels.h)
+			bool bIrAutoGain, bIrLongExposure;
+			int irBlack, irWhite;
+			float irGamma;
+			bool bNdiColor; // color straight from the frame into ndiColorStream
+			bool bNdiAsync;
+			bool bRecord;
+			unsigned int compressMask; // CAPTURE_COMPRESS_*
+			bool bTimingOsc, bTimingCsv;
+			char oscHost[OSC_HOST_MAX];
+			int oscPort;
+			int reconnects;     // bumped to set the OSC sender up again
+			int schemaRequests; // bumped to send the skeleton schema
+		};
+		// one frame's buffers for the previews / fbos, handed over through a TripleBuffer
+		struct PreviewFrame {
+			vector<unsigned short> depth;
+			vector<unsigned char> infrared; // normalized to 8 bit (normalizeInfrared())
+			vector<unsigned char> bodyIndex, colorBGRA, keyedRGBA, depthRGBA;
+			vector<float> colorCoords;
+			bool bHaveAllStreams, bDepth, bBodyIndex, bColor, bInfrared, bKeyed;
+			bool bCoords;    // colorCoords copied, keyed on the gpu instead of keyedRGBA
+			bool bDepthRGBA; // depth colorized on the cpu, instead of depth
+			bool bGpuDepth;  // depth colorized by the shader
+			int depthNear, depthFar;
+			int irBlack, irWhite; // levels the infrared was normalized with, auto gain's or the sliders'
+			int numBodiesTracked;
+			long long arrivalMicros;    // frameSourceMicros() when the Kinect frame came in
+			long long oscLatencyMicros; // frame arrival -> skeleton OSC sent
+			// only the acquisition thread talks to the recorder
+			bool bRecording, bRecordFailed;
+			int framesWritten, framesDropped;
+			long long bytesWritten;
+		};
+		AcquisitionThread acquisition;
+		std::mutex settingsMutex;
+		ProcessingSettings settings;   // guarded by settingsMutex
+		ProcessingSettings processing; // acquisition thread's copy
+		TripleBuffer<PreviewFrame> preview;
+		bool bPreviewNew; // update() took a new frame, draw() sends it to spout / NDI
+		int oscReconnects, schemaRequests; // render thread's counts, see ProcessingSettings
+		int reconnectsDone, schemaRequestsDone; // acquisition thread's
+		bool bRecordRequested, bRecordFailed;   // acquisition thread's
+		void publishSettings();
+		void processFrame(bool bFrameNew); // acquisition thread
+		KinectFrameSource * kinectSource; // the live source inside recorder, nullptr when replaying
+
+		// Per stage timings and per output latencies (stageTimers.h). Render stages add up
+		// over a draw() in drawMicros, the overlay / exports read the rolling percentiles.
+		StageTimers timers;
+		float drawMicros[TIMING_STAGE_COUNT];
+		TimingCsvLog timingLog;    // acquisition thread's, like the exports
+		float timingSentTime;
+		bool bTimingCsvRequested;
+		void exportTimings();      // acquisition thread
+		InfraredLevels irLevels;   // acquisition thread's
+		float irAutoBlack, irAutoWhite;
+		void drawTimings(float x, float y);
+
+		// preview textures, uploaded from the newest PreviewFrame
+		ofShortPixels depthPixels;
+		ofPixels infraredPixels, bodyIndexPixels, colorPixels, keyedPixels, depthColorPixels;
+		ofTexture depthTex, infraredTex, bodyIndexTex, colorTex, keyedTex, depthColorTex;
+		ofTexture coordTex; // depth -> color mapping for the keying shader
+		GpuKeying gpuKeying;
+		void drawBodies(float x, float y, float width, float height);
+		void drawOverlays();
+
+		// Which fbos feed an output: all of them with the preview, headless only the ones Spout / NDI
+		// send. With only OSC enabled nothing is copied, uploaded or drawn.
+		bool bDepthOut, bColorOut, bCutoutOut, bKeyedOut, bInfraredOut;
+		void updateOutputs();
+		float headlessStatusTime;
+		void logHeadlessStatus();
 
 		// void HostFieldChanged(string & HostField);
 		void HostFieldChanged();
@@ -45,7 +167,11 @@ class ofApp : public ofBaseApp{
 
 					  // offscreen buffers (frame buffer object)
 		ofFbo fboDepth; // draw to for spout, setup at Kinect native 512x
+		ofFbo fboCutout;
+		ofFbo fboKeyed;
+		ofFbo fboInfrared;
 		ofFbo fboColor; // draw to for spout, setup at 1080x
+		ofFbo fboAtlas; // depth | cutout | keyed, see sendNDIAtlas()
 
 		// Spout obj
 		ofxSpout2::Sender spout;
@@ -54,58 +180,70 @@ class ofApp : public ofBaseApp{
 		//  *** added from NDI sender example ***
 		// NDI definitions
 		bool NDIlock; // used to block NDI functions incase the ON/OFF param is activated.
-		ofxNDIsender ndiSender1;    // NDI sender object, HD format (color_)
-		ofxNDIsender ndiSender2;	// Depth-Image format (cutout_)
-		ofxNDIsender ndiSender3;	// INFRARED
-		ofxNDIsender ndiSender4;	// KEYED
+		bool bNdiInitialized; // NDIlib_initialize() done, NDIlib_destroy() in exit()
+		NdiStream ndiColorStream;   // HD format (color_), sent by the acquisition thread from the Kinect buffer
+		NdiStream ndiCutoutStream;  // Depth-Image format (cutout_)
+		NdiStream ndiDepthStream;   // RGBA from fboDepth, or encoded on the acquisition thread (depthEncoding)
+		NdiStream ndiKeyedStream;
+		NdiStream ndiInfraredStream;
+		DepthEncoding depthEncoding = DEPTH_ENCODING_RGBA; // of ndiDepthStream, fixed at setup()
 		string color_StreamName;
 		string cutout_StreamName;
 		string depth_StreamName;
 		string keyed_StreamName;
-		string infrared_StreamName;  // TODO add this.. currently not setup
-		char senderName[256];      // for conversions... char[] required for ndiSender functions
-
-								   // NOTE using W+H defined already
-								   //unsigned int senderWidth;  // Width of the sender output
-								   //unsigned int senderHeight; // Height of the sender output
-
-								   // ofFbo ndiFbo;              // NOTE using fbos created for spout
-
-								   // NOTE: need a Buffer array and a index used for async for EACH NDIstream being created
-		ofPixels color_ndiBuffer[2];     // Two pixel buffers for async sending
-		ofPixels cutout_ndiBuffer[2];     // Two pixel buffers for async sending
-		ofPixels depth_ndiBuffer[2];     // Two pixel buffers for async sending
-		ofPixels keyed_ndiBuffer[2];     // Two pixel buffers for async sending
-										 //ofPixels infrared_ndiBuffer[2];     // Two pixel buffers for async sending
-		int color_idx;                   // Index used for async buffer swapping			???
-		int cutout_idx;
-		int depth_idx;
-		int keyed_idx;
-		// int infrared_idx;
-
-		// PBO and control vars for ndiSender1 HD format
-		GLuint ndiPbo1[2];
-		int Pbo1Index;
-		int NextPbo1Index;
-		bool bUsePBO1;
-
-		// PBO and control vars for ndiSender2+ DepthImage sized
-		GLuint ndiPbo2[2];
-		int Pbo2Index;
-		int NextPbo2Index;
-		bool bUsePBO2;
-
-
-		bool ReadFboPixels(ofFbo fbo, unsigned int width, unsigned int height, unsigned char *data);
+		string infrared_StreamName;
+
+		// async fbo readback, one ring per stream so each maps its own, finished, transfers
+		PboRing cutoutPbo;
+		PboRing depthPbo;
+		PboRing keyedPbo;
+		PboRing infraredPbo;
+		PboRing atlasPbo;
+		vector<unsigned char> readbackPixels; // glReadPixels() without PBOs, before the conversion
+		bool bUsePBO;
+
 		//  ^^^ added from NDI sender example ^^^
 
 
-		// OSC
+		// OSC, the sender belongs to the acquisition thread (set up again there on reconnects)
 		ofxOscSender oscSender;
-		ofxOscReceiver oscReceiver;
+
+		// OSC remote control: the receiver runs on OscControl's thread, commands are applied
+		// at the start of update(). Every binding is one GUI control or an action.
+		enum ControlAction {
+			CONTROL_SET,        // just set the GUI control
+			CONTROL_RECONNECT,  // set, then set up the OSC sender / receiver again
+			CONTROL_APP_EXIT,
+			CONTROL_SCHEMA_GET
+		};
+		struct ControlBinding {
+			ControlAction action;
+			ofxToggle * toggle;
+			ofxIntSlider * intSlider;
+			ofxFloatSlider * floatSlider;
+			ofxIntField * intField;
+			ofxTextField * textField;
+		};
+		OscControl oscControl;
+		int oscControlPort; // port oscControl listens on, -1 if it couldn't bind
+		vector<ControlBinding> controls;
+		void setupControls();
+		void addControl(const string & address, ControlBinding binding, OscCommandType type);
+		void applyControl(const OscCommand & command, bool & bReconnect);
 
 		// custom functions DX
+		// everything below up to the GUI is used by the acquisition thread only
 		void oscSendMsg(std::string message, std::string address);
+		void sendSkeletonSchema();
+		float schemaSentTime;
+		SkeletonJointBundler jointBundler; // plain OSC mode
+		SkeletonDeltaFilter deltaFilter;
+		SkeletonFrame skeleton; // this frame's bodies, filtered in place for OSC
+		SkeletonHistory skeletonHistory; // raw skeletons of the last frames
+		SkeletonFrame drawSkeleton;
+		SkeletonFilter skeletonFilter; // smoothing + prediction before OSC
+		FeatureEngine featureEngine; // angles, speeds, triggers of the filtered skeletons
+		KinectFrame oscFrame; // frame with the filtered bodies
 
 
 		// GUI
@@ -113,6 +251,13 @@ class ofApp : public ofBaseApp{
 
 		ofxGuiGroup OSCgroup;
 		ofxToggle jsonGrouped;
+		ofxToggle oscBinary;
+		ofxToggle oscBundles;
+		ofxToggle oscFeatures;
+		ofxToggle oscBones;
+		ofxToggle oscDelta;
+		ofxFloatSlider oscDeadBand; // millimeters
+		ofxFloatSlider oscKeyframe; // seconds
 		// ofxInputField
 		ofxIntField oscPort; // Output
 		ofxIntField oscPortIn;
@@ -123,6 +268,7 @@ class ofApp : public ofBaseApp{
 		ofxToggle spoutColor;
 		ofxToggle spoutKeyed;
 		ofxToggle spoutDepth;
+		ofxToggle spoutInfrared;
 
 		ofxGuiGroup NDIgroup;
 		ofxToggle ndiActive;
@@ -130,16 +276,58 @@ class ofApp : public ofBaseApp{
 		ofxToggle ndiColor;
 		ofxToggle ndiKeyed;
 		ofxToggle ndiDepth;
+		ofxToggle ndiInfrared;
+		ofxToggle ndiAsync;
+		ofxIntSlider ndiBuffers;
+		ofxIntSlider pboDepth;
+		ofxToggle ndiAtlas;
+		ofxToggle ndiCompact; // UYVY / UYVA streams instead of RGBA
+		ofxIntSlider ndiDepthEncoding; // DepthEncoding
+
+		ofxGuiGroup FILTERgroup;
+		ofxIntSlider filterType; // SkeletonFilterType
+		ofxFloatSlider filterMinCutoff;
+		ofxFloatSlider filterBeta;
+		ofxFloatSlider filterDCutoff;
+		ofxFloatSlider filterSmoothing;
+		ofxFloatSlider filterTrend;
+		ofxFloatSlider filterPredict;
+
+		ofxGuiGroup CPUgroup;
+		ofxIntSlider keyingThreads;
+		ofxToggle gpuShaders;
+		ofxToggle depthColorize;
+		ofxIntSlider depthNear; // mm
+		ofxIntSlider depthFar;
+
+		ofxGuiGroup IRgroup;
+		ofxToggle irAutoGain;
+		ofxIntSlider irBlack; // raw infrared levels, used when auto gain is off
+		ofxIntSlider irWhite;
+		ofxFloatSlider irGamma;
+		ofxToggle irLongExposure;
+
+		ofxGuiGroup TIMINGgroup;
+		ofxToggle timingOverlay;
+		ofxToggle timingOsc;
+		ofxToggle timingCsv;
+
+		ofxGuiGroup CAPTUREgroup;
+		ofxToggle recordToggle;
+		ofxToggle compressDepthToggle;
+		ofxToggle compressColorToggle;
 
 
 		// added for coordmapping
-		ofImage bodyIndexImg, foregroundImg;
-		vector<ofVec2f> colorCoords;
+		ofImage bodyIndexImg;
+		WorkerPool keyingPool; // row tiles of the keyed composite, run by the acquisition thread
 		int numBodiesTracked;
 		bool bHaveAllStreams;
 
 		// helper Functions
-		string escape_quotes(const string & before);
-		void body2JSON(vector<ofxKinectForWindows2::Data::Body> bodies, const char * jointNames[]);
-		void sendNDI(ofxNDIsender & ndiSender, ofFbo & sourceFBO, bool bUsePBO, int senderWidth, int senderHeight, char senderName[256], ofPixels ndiBuffer[], int idx);
+		void body2JSON(const BodySample bodies[], const char * jointNames[], const SkeletonDelta * delta);
+		BodyJsonWriter bodyJson; // reused every frame
+		void sendNDI(NdiStream & stream, ofFbo & sourceFBO, PboRing & pbo);
+		void sendNDIAtlas();
+		void sendSpout(ofFbo & fbo, const string & name, int latencyStage);
 };
@@ -0,0 +1,125 @@
+#include "oscControl.h"
+
+//--------------------------------------------------------------
+OscControl::OscControl()
+	: bQuit(false)
+	, bRunning(false)
+	, commandsDropped(0)
+	, unknownAddresses(0) {
+}
+
+OscControl::~OscControl() {
+	stop();
+}
+
+void OscControl::addTarget(const string & address, int target, OscCommandType type) {
+	Target t;
+	t.target = target;
+	t.type = type;
+	dispatch[address] = t;
+}
+
+//--------------------------------------------------------------
+bool OscControl::start(int port) {
+	stop();
+	pool.resize(OSC_COMMAND_QUEUE);
+	ready.reset(OSC_COMMAND_QUEUE);
+	released.reset(OSC_COMMAND_QUEUE);
+	for (int i = 0; i < OSC_COMMAND_QUEUE; i++) {
+		released.push(i);
+	}
+
+	try {
+		socket.reset(new UdpListeningReceiveSocket(IpEndpointName(IpEndpointName::ANY_ADDRESS, port), this));
+	}
+	catch (std::exception & e) {
+		ofLogError("kv2") << "OSC control can't listen on port " << port << ": " << e.what();
+		return false;
+	}
+	bQuit = false;
+	thread = std::thread(&OscControl::receiveLoop, this);
+	bRunning = true;
+	return true;
+}
+
+void OscControl::stop() {
+	if (!bRunning) return;
+	bQuit = true;
+	socket->AsynchronousBreak();
+	thread.join();
+	socket.reset();
+	bRunning = false;
+}
+
+//--------------------------------------------------------------
+void OscControl::receiveLoop() {
+	// Run() sleeps in the socket until a packet comes in (-> ProcessMessage()) or AsynchronousBreak().
+	// oscpack throws on malformed packets, that shouldn't take the control thread down
+	while (!bQuit) {
+		try {
+			socket->Run();
+		}
+		catch (std::exception & e) {
+			ofLogWarning("kv2") << "OSC control: " << e.what();
+		}
+	}
+}
+
+void OscControl::ProcessMessage(const osc::ReceivedMessage & m, const IpEndpointName & remoteEndpoint) {
+	address.assign(m.AddressPattern());
+	auto it = dispatch.find(address);
+	if (it == dispatch.end()) {
+		unknownAddresses++;
+		return;
+	}
+
+	int slot;
+	if (!released.pop(slot)) {
+		commandsDropped++; // render thread isn't keeping up
+		return;
+	}
+	if (parse(m, it->second, pool[slot])) ready.push(slot);
+	else released.push(slot);
+}
+
+bool OscControl::parse(const osc::ReceivedMessage & m, const Target & target, OscCommand & command) const {
+	command.target = target.target;
+	command.type = target.type;
+	command.intValue = 0;
+	command.floatValue = 0;
+	command.text[0] = 0;
+
+	if (m.ArgumentCount() == 0) {
+		if (target.type != OSC_COMMAND_TRIGGER) return false;
+		command.intValue = 1;
+		return true;
+	}
+
+	osc::ReceivedMessageArgumentIterator arg = m.ArgumentsBegin();
+	if (arg->IsInt32()) command.floatValue = (float)arg->AsInt32();
+	else if (arg->IsInt64()) command.floatValue = (float)arg->AsInt64();
+	else if (arg->IsFloat()) command.floatValue = arg->AsFloat();
+	else if (arg->IsDouble()) command.floatValue = (float)arg->AsDouble();
+	else if (arg->IsBool()) command.floatValue = arg->AsBool() ? 1 : 0;
+	else if (arg->IsString()) {
+		const char * text = arg->AsString();
+		strncpy(command.text, text, OSC_COMMAND_TEXT_MAX - 1);
+		command.text[OSC_COMMAND_TEXT_MAX - 1] = 0;
+		command.floatValue = strcmp(text, "true") == 0 ? 1 : (float)atof(text);
+	}
+	else return false;
+	if (target.type == OSC_COMMAND_STRING && !arg->IsString()) return false;
+
+	command.intValue = (int)std::round(command.floatValue);
+	if (target.type == OSC_COMMAND_BOOL) command.intValue = command.floatValue != 0;
+	return target.type != OSC_COMMAND_TRIGGER || command.intValue != 0;
+}
+
+//--------------------------------------------------------------
+bool OscControl::pop(OscCommand & command) {
+	int slot;
+	if (!ready.pop(slot)) return false;
+	command = pool[slot];
+	released.push(slot);
+	return true;
+}
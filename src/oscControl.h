@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ofMain.h"
+#include "OscPacketListener.h"
+#include "UdpSocket.h"
+#include "spscQueue.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+
+// Remote control over OSC without touching the render loop: a control thread blocks on the
+// socket (oscpack, what ofxOscReceiver uses underneath), looks the address of every message up
+// in a hash table and turns it into an OscCommand, which goes to the render thread through a
+// lock free queue. ofApp::update() pops the commands
+// at the start of a frame, so settings only ever change between frames.
+//
+// Commands are preallocated slots handed back and forth by index (like NdiStream's frames),
+// when the render thread falls behind new commands are dropped, not queued without bound.
+
+#define OSC_COMMAND_TEXT_MAX 64
+#define OSC_COMMAND_QUEUE 64
+
+enum OscCommandType {
+	OSC_COMMAND_BOOL,    // first arg as 0 / 1 (int, float, T / F or "true")
+	OSC_COMMAND_INT,
+	OSC_COMMAND_FLOAT,
+	OSC_COMMAND_STRING,
+	OSC_COMMAND_TRIGGER  // no arg needed, a non zero first arg if there is one
+};
+
+struct OscCommand {
+	int target; // whatever the app registered the address with
+	int type;   // OscCommandType
+	int intValue;
+	float floatValue;
+	char text[OSC_COMMAND_TEXT_MAX];
+};
+
+class OscControl : public osc::OscPacketListener {
+public:
+	OscControl();
+	~OscControl();
+
+	// register every address before start()
+	void addTarget(const string & address, int target, OscCommandType type);
+
+	// binds the port, false if it can't
+	bool start(int port);
+	void stop();
+
+	// render thread: next command in arrival order, false if none
+	bool pop(OscCommand & command);
+
+	int getCommandsDropped() const { return commandsDropped; }
+	int getUnknownAddresses() const { return unknownAddresses; }
+
+protected:
+	// control thread, from inside socket->Run(), bundles are already unpacked
+	void ProcessMessage(const osc::ReceivedMessage & m, const IpEndpointName & remoteEndpoint) override;
+
+private:
+	struct Target {
+		int target;
+		OscCommandType type;
+	};
+
+	void receiveLoop();
+	bool parse(const osc::ReceivedMessage & m, const Target & target, OscCommand & command) const;
+
+	std::unordered_map<string, Target> dispatch;
+	string address; // control thread, keeps its capacity so lookups don't allocate
+	std::unique_ptr<UdpListeningReceiveSocket> socket;
+	std::thread thread;
+	std::atomic<bool> bQuit;
+	bool bRunning;
+
+	vector<OscCommand> pool;
+	SpscQueue<int> ready;    // control thread -> render thread
+	SpscQueue<int> released; // render thread -> control thread
+
+	std::atomic<int> commandsDropped;
+	std::atomic<int> unknownAddresses;
+};
@@ -0,0 +1,149 @@
+#include "pboRing.h"
+
+// Asynchronous Read-back
+// adapted from : http://www.songho.ca/opengl/gl_pbo.html
+
+//--------------------------------------------------------------
+PboRing::PboRing()
+	: width(0)
+	, height(0)
+	, bUseFences(false)
+	, nextSlot(0)
+	, mapped(nullptr)
+	, sequence(0)
+	, framesDropped(0) {
+}
+
+PboRing::~PboRing() {
+	close();
+}
+
+//--------------------------------------------------------------
+void PboRing::setup(int width_, int height_, int depth) {
+	close();
+	width = width_;
+	height = height_;
+	bUseFences = GLEW_ARB_sync != 0;
+
+	slots.resize(ofClamp(depth, PBO_RING_MIN, PBO_RING_MAX));
+	for (auto& slot : slots) {
+		glGenBuffers(1, &slot.pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, 0, GL_STREAM_READ);
+		slot.fence = 0;
+		slot.bPending = false;
+		slot.renderMicros = 0;
+		slot.arrivalMicros = 0;
+		slot.sequence = 0;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	nextSlot = 0;
+	sequence = 0;
+	framesDropped = 0;
+}
+
+void PboRing::close() {
+	unmapCompleted();
+	for (auto& slot : slots) {
+		release(slot);
+		glDeleteBuffers(1, &slot.pbo);
+	}
+	slots.clear();
+}
+
+void PboRing::release(Slot & slot) {
+	if (slot.fence) glDeleteSync(slot.fence);
+	slot.fence = 0;
+	slot.bPending = false;
+}
+
+//--------------------------------------------------------------
+void PboRing::startTransfer(ofFbo & fbo, unsigned long long renderMicros, long long arrivalMicros) {
+	if (slots.empty()) return;
+
+	Slot & slot = slots[nextSlot];
+	nextSlot = (nextSlot + 1) % slots.size();
+	if (slot.bPending) {
+		// ring full, the consumer is too slow: this transfer is the oldest
+		framesDropped++;
+		release(slot);
+	}
+
+	fbo.bind();
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	// Read pixels from framebuffer to the PBO - glReadPixels() returns immediately.
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid *)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	fbo.unbind();
+
+	if (bUseFences) slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.bPending = true;
+	slot.renderMicros = renderMicros;
+	slot.arrivalMicros = arrivalMicros;
+	slot.sequence = ++sequence;
+}
+
+bool PboRing::isDone(Slot & slot) {
+	if (!slot.bPending) return false;
+	if (!bUseFences) return true; // no way to tell, mapping will wait if needed
+
+	// zero timeout: just a poll. Flush so the fence is guaranteed to get there.
+	GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+//--------------------------------------------------------------
+bool PboRing::hasCompleted() {
+	for (auto& slot : slots) {
+		if (!bUseFences && slot.bPending && slot.sequence == sequence) continue; // keep one in flight
+		if (isDone(slot)) return true;
+	}
+	return false;
+}
+
+const unsigned char * PboRing::mapCompleted(unsigned long long & renderMicros, long long & arrivalMicros) {
+	// newest finished transfer, fences signal in order so everything older is done too
+	Slot * newest = nullptr;
+	for (auto& slot : slots) {
+		if (!bUseFences && slot.bPending && slot.sequence == sequence) continue; // keep one in flight
+		if (isDone(slot) && (!newest || slot.sequence > newest->sequence)) newest = &slot;
+	}
+	if (!newest) return nullptr;
+
+	for (auto& slot : slots) {
+		if (&slot != newest && slot.bPending && slot.sequence < newest->sequence) {
+			framesDropped++;
+			release(slot);
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, newest->pbo);
+	void * pboMemory = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	renderMicros = newest->renderMicros;
+	arrivalMicros = newest->arrivalMicros;
+	if (!pboMemory) {
+		// Back to conventional pixel operation
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		release(*newest);
+		return nullptr;
+	}
+	mapped = newest;
+	return (const unsigned char *)pboMemory;
+}
+
+void PboRing::unmapCompleted() {
+	if (!mapped) return;
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	// Back to conventional pixel operation
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	release(*mapped);
+	mapped = nullptr;
+}
+
+void PboRing::skipCompleted() {
+	for (auto& slot : slots) {
+		if (!bUseFences && slot.bPending && slot.sequence == sequence) continue; // keep one in flight
+		if (isDone(slot)) release(slot);
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ofMain.h"
+
+#define PBO_RING_MIN 2
+#define PBO_RING_MAX 4
+
+// Asynchronous RGBA readback of an fbo through a ring of pixel pack buffers, one ring per
+// output stream. startTransfer() queues glReadPixels into the next PBO and drops a fence
+// behind it, mapCompleted() only maps PBOs whose fence has signalled, so the cpu never
+// waits on a transfer that was just issued. The caller reads (converts) the mapped pixels
+// straight into where they go. A frame comes out one or more draw()s later.
+// Without ARB_sync it falls back to mapping the oldest transfer (which may stall).
+class PboRing {
+public:
+	PboRing();
+	~PboRing();
+
+	void setup(int width, int height, int depth);
+	void close();
+	bool isSetup() const { return !slots.empty(); }
+	int getDepth() const { return (int)slots.size(); }
+
+	// queue the readback of fbo, renderMicros and arrivalMicros (frameSourceMicros() when the
+	// Kinect frame came in) travel with the frame.
+	// If every PBO is still waiting the oldest transfer is thrown away (counted as dropped).
+	void startTransfer(ofFbo & fbo, unsigned long long renderMicros, long long arrivalMicros);
+
+	// true if mapCompleted() has a frame
+	bool hasCompleted();
+	// maps the newest finished transfer for reading (width * height RGBA), older finished ones are
+	// dropped. It stays mapped until unmapCompleted(), which has to follow before any other call
+	const unsigned char * mapCompleted(unsigned long long & renderMicros, long long & arrivalMicros);
+	void unmapCompleted();
+	// throws the finished transfers away uncounted, for a frame the caller already counted as
+	// dropped (the stream had no buffer for it)
+	void skipCompleted();
+
+	int getFramesDropped() const { return framesDropped; } // lost in the ring, never handed out
+
+private:
+	struct Slot {
+		GLuint pbo;
+		GLsync fence;
+		bool bPending; // transfer issued, not copied out yet
+		unsigned long long renderMicros;
+		long long arrivalMicros;
+		unsigned long long sequence;
+	};
+
+	bool isDone(Slot & slot);
+	void release(Slot & slot);
+
+	int width;
+	int height;
+	bool bUseFences;
+	vector<Slot> slots;
+	int nextSlot;
+	Slot * mapped;
+	unsigned long long sequence;
+	int framesDropped;
+};
@@ -0,0 +1,528 @@
+#include "pixelKernels.h"
+#include "keying.h"
+#include "simd.h"
+
+#include <cmath>
+#include <cstring>
+
+static inline unsigned int load32(const unsigned char * p) {
+	unsigned int v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static inline void store32(unsigned char * p, unsigned int v) {
+	memcpy(p, &v, 4);
+}
+
+static PixelPath pixelBestPath() {
+	return simdHasSSE2() ? PIXEL_SSE2 : PIXEL_SCALAR;
+}
+
+static PixelPath resolve(PixelPath path) {
+	return path == PIXEL_AUTO || !pixelPathSupported(path) ? pixelBestPath() : path;
+}
+
+//--------------------------------------------------------------
+static void bodyIndexMaskScalar(const unsigned char * bodyIndex, unsigned char * outRGBA, int begin, int end) {
+	for (int i = begin; i < end; i++) {
+		store32(outRGBA + i * 4, bodyIndex[i] < KEYING_MAX_BODIES ? 0xFFFFFFFFu : 0);
+	}
+}
+
+// 16 pixels per step: one compare, the byte mask is widened to 4 bytes per pixel
+static void bodyIndexMaskSSE2(const unsigned char * bodyIndex, unsigned char * outRGBA, int count) {
+	int i = 0;
+#if SIMD_X86
+	const __m128i lastBody = _mm_set1_epi8(KEYING_MAX_BODIES - 1);
+	for (; i + 16 <= count; i += 16) {
+		__m128i idx = _mm_loadu_si128((const __m128i *)(bodyIndex + i));
+		__m128i m = _mm_cmpeq_epi8(_mm_min_epu8(idx, lastBody), idx); // unsigned idx <= 5
+		__m128i lo = _mm_unpacklo_epi8(m, m);
+		__m128i hi = _mm_unpackhi_epi8(m, m);
+		__m128i * out = (__m128i *)(outRGBA + i * 4);
+		_mm_storeu_si128(out, _mm_unpacklo_epi16(lo, lo));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, lo));
+		_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, hi));
+		_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, hi));
+	}
+#endif
+	bodyIndexMaskScalar(bodyIndex, outRGBA, i, count);
+}
+
+void bodyIndexMask(const unsigned char * bodyIndex, unsigned char * outRGBA, int count, PixelPath path) {
+	if (resolve(path) == PIXEL_SSE2) bodyIndexMaskSSE2(bodyIndex, outRGBA, count);
+	else bodyIndexMaskScalar(bodyIndex, outRGBA, 0, count);
+}
+
+//--------------------------------------------------------------
+static void swizzleRBScalar(const unsigned char * src, unsigned char * dst, int begin, int end) {
+	for (int i = begin; i < end; i++) {
+		unsigned int p = load32(src + i * 4);
+		store32(dst + i * 4, (p & 0xFF00FF00u) | ((p >> 16) & 0xFFu) | ((p & 0xFFu) << 16));
+	}
+}
+
+// same shifts and masks as the keying SSE2 path (no pshufb before SSSE3)
+static void swizzleRBSSE2(const unsigned char * src, unsigned char * dst, int count) {
+	int i = 0;
+#if SIMD_X86
+	const __m128i keepAG = _mm_set1_epi32((int)0xFF00FF00);
+	const __m128i lowByte = _mm_set1_epi32(0xFF);
+	for (; i + 4 <= count; i += 4) {
+		__m128i p = _mm_loadu_si128((const __m128i *)(src + i * 4));
+		p = _mm_or_si128(_mm_and_si128(p, keepAG),
+			_mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), lowByte),
+				_mm_slli_epi32(_mm_and_si128(p, lowByte), 16)));
+		_mm_storeu_si128((__m128i *)(dst + i * 4), p);
+	}
+#endif
+	swizzleRBScalar(src, dst, i, count);
+}
+
+void swizzleRB(const unsigned char * src, unsigned char * dst, int count, PixelPath path) {
+	if (resolve(path) == PIXEL_SSE2) swizzleRBSSE2(src, dst, count);
+	else swizzleRBScalar(src, dst, 0, count);
+}
+
+//--------------------------------------------------------------
+// The ramp is 255 - ((clamp(d - near, 0, range) * scale) >> 16), a fixed point divide both paths
+// (and the depth shader) do the same way. range >= PIXEL_DEPTH_RANGE_MIN keeps scale below 65536,
+// so SSE2 can use one unsigned 16 bit high multiply.
+DepthRamp::DepthRamp(int nearValue, int farValue) {
+	if (nearValue < 0) nearValue = 0;
+	if (nearValue > 65535 - PIXEL_DEPTH_RANGE_MIN) nearValue = 65535 - PIXEL_DEPTH_RANGE_MIN;
+	if (farValue > 65535) farValue = 65535;
+	if (farValue < nearValue + PIXEL_DEPTH_RANGE_MIN) farValue = nearValue + PIXEL_DEPTH_RANGE_MIN;
+	nearMm = (unsigned int)nearValue;
+	range = (unsigned int)(farValue - nearValue);
+	scale = (255u << 16) / range;
+}
+
+static inline unsigned int rampGray(unsigned int d, const DepthRamp & ramp) {
+	unsigned int t = d > ramp.nearMm ? d - ramp.nearMm : 0;
+	if (t > ramp.range) t = ramp.range;
+	return 255 - ((t * ramp.scale) >> 16);
+}
+
+#if SIMD_X86
+// 8 pixels per step in 16 bit lanes: saturating subtract for the clamps, mulhi for the scale
+struct RampSSE2 {
+	__m128i nearMm, range, scale, white;
+	RampSSE2(const DepthRamp & ramp)
+		: nearMm(_mm_set1_epi16((short)ramp.nearMm))
+		, range(_mm_set1_epi16((short)ramp.range))
+		, scale(_mm_set1_epi16((short)ramp.scale))
+		, white(_mm_set1_epi16(255)) {
+	}
+	__m128i gray(__m128i d) const {
+		__m128i t = _mm_subs_epu16(d, nearMm);
+		t = _mm_sub_epi16(t, _mm_subs_epu16(t, range)); // min(t, range) without SSE4.1
+		return _mm_sub_epi16(white, _mm_mulhi_epu16(t, scale));
+	}
+};
+#endif
+
+static void colorizeDepthScalar(const unsigned short * depth, unsigned char * outRGBA, int begin, int end, const DepthRamp & ramp) {
+	for (int i = begin; i < end; i++) {
+		unsigned int d = depth[i];
+		unsigned int px = 0;
+		if (d != 0) {
+			unsigned int gray = rampGray(d, ramp);
+			px = 0xFF000000u | gray << 16 | gray << 8 | gray;
+		}
+		store32(outRGBA + i * 4, px);
+	}
+}
+
+static void colorizeDepthSSE2(const unsigned short * depth, unsigned char * outRGBA, int count, const DepthRamp & ramp) {
+	int i = 0;
+#if SIMD_X86
+	const RampSSE2 r(ramp);
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= count; i += 8) {
+		__m128i d = _mm_loadu_si128((const __m128i *)(depth + i));
+		__m128i gray = r.gray(d);
+
+		__m128i invalid = _mm_cmpeq_epi16(d, zero);
+		gray = _mm_andnot_si128(invalid, gray);
+		__m128i alpha = _mm_andnot_si128(invalid, r.white);
+
+		// g g g a per pixel
+		__m128i g8 = _mm_packus_epi16(gray, gray);
+		__m128i a8 = _mm_packus_epi16(alpha, alpha);
+		__m128i gg = _mm_unpacklo_epi8(g8, g8);
+		__m128i ga = _mm_unpacklo_epi8(g8, a8);
+		__m128i * out = (__m128i *)(outRGBA + i * 4);
+		_mm_storeu_si128(out, _mm_unpacklo_epi16(gg, ga));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(gg, ga));
+	}
+#endif
+	colorizeDepthScalar(depth, outRGBA, i, count, ramp);
+}
+
+void colorizeDepth(const unsigned short * depth, unsigned char * outRGBA, int count, int nearMm, int farMm, PixelPath path) {
+	DepthRamp ramp(nearMm, farMm);
+	if (resolve(path) == PIXEL_SSE2) colorizeDepthSSE2(depth, outRGBA, count, ramp);
+	else colorizeDepthScalar(depth, outRGBA, 0, count, ramp);
+}
+
+//--------------------------------------------------------------
+// window8 / false color level of one depth: the ramp, kept off 0 so 0 can mean no reading
+static inline unsigned int depthLevel(unsigned int d, const DepthRamp & ramp) {
+	if (d == 0) return 0;
+	unsigned int level = rampGray(d, ramp);
+	return level ? level : 1;
+}
+
+#if SIMD_X86
+static inline __m128i depthLevelSSE2(__m128i d, const RampSSE2 & r) {
+	__m128i level = _mm_max_epi16(r.gray(d), _mm_set1_epi16(1));
+	return _mm_andnot_si128(_mm_cmpeq_epi16(d, _mm_setzero_si128()), level);
+}
+#endif
+
+static void encodeRG16Scalar(const unsigned short * depth, unsigned char * out, int count) {
+	for (int i = 0; i < count; i++) {
+		out[i * 2] = (unsigned char)(depth[i] & 0xFF);
+		out[i * 2 + 1] = (unsigned char)(depth[i] >> 8);
+	}
+}
+
+static void encodeWindow8Scalar(const unsigned short * depth, unsigned char * out, int begin, int end, const DepthRamp & ramp) {
+	for (int i = begin; i < end; i++) {
+		out[i * 2] = 128;
+		out[i * 2 + 1] = (unsigned char)depthLevel(depth[i], ramp);
+	}
+}
+
+// 8 pixels per step, the levels interleaved with the 128 chroma bytes
+static void encodeWindow8SSE2(const unsigned short * depth, unsigned char * out, int count, const DepthRamp & ramp) {
+	int i = 0;
+#if SIMD_X86
+	const RampSSE2 r(ramp);
+	const __m128i chroma = _mm_set1_epi8((char)128);
+	for (; i + 8 <= count; i += 8) {
+		__m128i level = depthLevelSSE2(_mm_loadu_si128((const __m128i *)(depth + i)), r);
+		_mm_storeu_si128((__m128i *)(out + i * 2), _mm_unpacklo_epi8(chroma, _mm_packus_epi16(level, level)));
+	}
+#endif
+	encodeWindow8Scalar(depth, out, i, count, ramp);
+}
+
+// turbo (Google's polynomial fit) from far blue to near red, in BT.601 video levels.
+// Level 0 (no reading) is black.
+struct FalseColorLut {
+	unsigned char y[256], u[256], v[256];
+	FalseColorLut() {
+		y[0] = 16;
+		u[0] = v[0] = 128;
+		for (int level = 1; level < 256; level++) {
+			double x = (level - 1) / 254.0;
+			double r = 0.13572138 + x * (4.61539260 + x * (-42.66032258 + x * (132.13108234 + x * (-152.94239396 + x * 59.28637943))));
+			double g = 0.09140261 + x * (2.19418839 + x * (4.84296658 + x * (-14.18503333 + x * (4.27729857 + x * 2.82956604))));
+			double b = 0.10667330 + x * (12.64194608 + x * (-60.58204836 + x * (110.36276771 + x * (-89.90310912 + x * 27.34824973))));
+			r = r < 0 ? 0 : r > 1 ? 1 : r;
+			g = g < 0 ? 0 : g > 1 ? 1 : g;
+			b = b < 0 ? 0 : b > 1 ? 1 : b;
+			double luma = 0.299 * r + 0.587 * g + 0.114 * b;
+			y[level] = (unsigned char)(16 + 219 * luma + 0.5);
+			u[level] = (unsigned char)(128 + 224 * (b - luma) / 1.772 + 0.5);
+			v[level] = (unsigned char)(128 + 224 * (r - luma) / 1.402 + 0.5);
+		}
+	}
+};
+
+static const FalseColorLut & falseColorLut() {
+	static const FalseColorLut lut;
+	return lut;
+}
+
+static inline void falseColorPair(unsigned int l0, unsigned int l1, unsigned char * out, const FalseColorLut & lut) {
+	out[0] = (unsigned char)((lut.u[l0] + lut.u[l1] + 1) >> 1);
+	out[1] = lut.y[l0];
+	out[2] = (unsigned char)((lut.v[l0] + lut.v[l1] + 1) >> 1);
+	out[3] = lut.y[l1];
+}
+
+static void encodeFalseColorScalar(const unsigned short * depth, unsigned char * out, int begin, int end, const DepthRamp & ramp) {
+	const FalseColorLut & lut = falseColorLut();
+	for (int i = begin; i < end; i += 2) {
+		falseColorPair(depthLevel(depth[i], ramp), depthLevel(depth[i + 1], ramp), out + i * 2, lut);
+	}
+}
+
+// no gather before AVX2: SSE2 works out the levels, the table lookups stay scalar
+static void encodeFalseColorSSE2(const unsigned short * depth, unsigned char * out, int count, const DepthRamp & ramp) {
+	int i = 0;
+#if SIMD_X86
+	const RampSSE2 r(ramp);
+	const FalseColorLut & lut = falseColorLut();
+	unsigned short levels[8];
+	for (; i + 8 <= count; i += 8) {
+		__m128i level = depthLevelSSE2(_mm_loadu_si128((const __m128i *)(depth + i)), r);
+		_mm_storeu_si128((__m128i *)levels, level);
+		for (int j = 0; j < 8; j += 2) {
+			falseColorPair(levels[j], levels[j + 1], out + (i + j) * 2, lut);
+		}
+	}
+#endif
+	encodeFalseColorScalar(depth, out, i, count, ramp);
+}
+
+void encodeDepth(DepthEncoding encoding, const unsigned short * depth, unsigned char * out, int count,
+	int nearMm, int farMm, PixelPath path) {
+	DepthRamp ramp(nearMm, farMm);
+	bool bSSE2 = resolve(path) == PIXEL_SSE2;
+	switch (encoding) {
+	case DEPTH_ENCODING_RG16:
+		// little endian already is the layout, a copy is as vectorized as it gets
+		if (bSSE2) memcpy(out, depth, count * 2);
+		else encodeRG16Scalar(depth, out, count);
+		break;
+	case DEPTH_ENCODING_WINDOW8:
+		if (bSSE2) encodeWindow8SSE2(depth, out, count, ramp);
+		else encodeWindow8Scalar(depth, out, 0, count, ramp);
+		break;
+	case DEPTH_ENCODING_FALSE_COLOR:
+		if (bSSE2) encodeFalseColorSSE2(depth, out, count, ramp);
+		else encodeFalseColorScalar(depth, out, 0, count, ramp);
+		break;
+	default:
+		break;
+	}
+}
+
+int decodeDepthWindow8(unsigned char y, int nearMm, int farMm) {
+	if (y == 0) return 0;
+	DepthRamp ramp(nearMm, farMm);
+	return (int)(ramp.nearMm + ((255 - y) * ramp.range + 127) / 255);
+}
+
+const char * depthEncodingName(DepthEncoding encoding) {
+	switch (encoding) {
+	case DEPTH_ENCODING_RGBA:
+		return "rgba";
+	case DEPTH_ENCODING_RG16:
+		return "rg16";
+	case DEPTH_ENCODING_WINDOW8:
+		return "window8";
+	case DEPTH_ENCODING_FALSE_COLOR:
+		return "falsecolor";
+	default:
+		break;
+	}
+	return "unknown";
+}
+
+//--------------------------------------------------------------
+// 8 bit fixed point video level matrices: Y = 16 + (yr R + yg G + yb B + 128) >> 8,
+// chroma from the pixel pair's sums: U = 128 + (ur (R0 + R1) + ug (G0 + G1) + ub (B0 + B1) + 256) >> 9
+struct YuvCoefficients {
+	int yr, yg, yb, ur, ug, ub, vr, vg, vb;
+};
+
+static const YuvCoefficients yuvCoefficients[2] = {
+	{ 66, 129, 25, -38, -74, 112, 112, -94, -18 }, // BT.601
+	{ 47, 157, 16, -26, -86, 112, 112, -102, -10 } // BT.709, chroma rows sum to 0 so grays stay at 128
+};
+
+// red at byte 0 of every pixel, or at byte 2 for BGRA
+static void rgbaToUyvyScalar(const unsigned char * rgba, unsigned char * uyvy, unsigned char * alpha, int begin, int end,
+	const YuvCoefficients & c, bool bBGRA) {
+	const int rByte = bBGRA ? 2 : 0, bByte = 2 - rByte;
+	for (int i = begin; i < end; i += 2) {
+		const unsigned char * p = rgba + i * 4;
+		int r0 = p[rByte], g0 = p[1], b0 = p[bByte];
+		int r1 = p[4 + rByte], g1 = p[5], b1 = p[4 + bByte];
+		int r = r0 + r1, g = g0 + g1, b = b0 + b1;
+		unsigned char * out = uyvy + i * 2;
+		out[0] = (unsigned char)(128 + ((c.ur * r + c.ug * g + c.ub * b + 256) >> 9));
+		out[1] = (unsigned char)(16 + ((c.yr * r0 + c.yg * g0 + c.yb * b0 + 128) >> 8));
+		out[2] = (unsigned char)(128 + ((c.vr * r + c.vg * g + c.vb * b + 256) >> 9));
+		out[3] = (unsigned char)(16 + ((c.yr * r1 + c.yg * g1 + c.yb * b1 + 128) >> 8));
+		if (alpha) {
+			alpha[i] = p[3];
+			alpha[i + 1] = p[7];
+		}
+	}
+}
+
+// 8 pixels per step: channels split into 16 bit lanes, Y with 16 bit multiplies (the sums stay
+// below 65536), chroma with madd, which adds up each pair. Chroma | Y << 8 in every 16 bit lane
+// is already U Y V Y byte order.
+static void rgbaToUyvySSE2(const unsigned char * rgba, unsigned char * uyvy, unsigned char * alpha, int count,
+	const YuvCoefficients & c, bool bBGRA) {
+	int i = 0;
+#if SIMD_X86
+	const int rShift = bBGRA ? 16 : 0, bShift = 16 - rShift;
+	const __m128i lowByte = _mm_set1_epi32(0xFF);
+	const __m128i yr = _mm_set1_epi16((short)c.yr), yg = _mm_set1_epi16((short)c.yg), yb = _mm_set1_epi16((short)c.yb);
+	const __m128i ur = _mm_set1_epi16((short)c.ur), ug = _mm_set1_epi16((short)c.ug), ub = _mm_set1_epi16((short)c.ub);
+	const __m128i vr = _mm_set1_epi16((short)c.vr), vg = _mm_set1_epi16((short)c.vg), vb = _mm_set1_epi16((short)c.vb);
+	const __m128i yRound = _mm_set1_epi16(128), yOffset = _mm_set1_epi16(16);
+	const __m128i cRound = _mm_set1_epi32(256), cOffset = _mm_set1_epi32(128);
+	for (; i + 8 <= count; i += 8) {
+		__m128i p0 = _mm_loadu_si128((const __m128i *)(rgba + i * 4));
+		__m128i p1 = _mm_loadu_si128((const __m128i *)(rgba + i * 4 + 16));
+		__m128i r = _mm_packs_epi32(_mm_and_si128(_mm_srl_epi32(p0, _mm_cvtsi32_si128(rShift)), lowByte),
+			_mm_and_si128(_mm_srl_epi32(p1, _mm_cvtsi32_si128(rShift)), lowByte));
+		__m128i g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), lowByte), _mm_and_si128(_mm_srli_epi32(p1, 8), lowByte));
+		__m128i b = _mm_packs_epi32(_mm_and_si128(_mm_srl_epi32(p0, _mm_cvtsi32_si128(bShift)), lowByte),
+			_mm_and_si128(_mm_srl_epi32(p1, _mm_cvtsi32_si128(bShift)), lowByte));
+
+		__m128i y = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, yr), _mm_mullo_epi16(g, yg)),
+			_mm_add_epi16(_mm_mullo_epi16(b, yb), yRound));
+		y = _mm_add_epi16(_mm_srli_epi16(y, 8), yOffset);
+
+		__m128i u = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(r, ur), _mm_madd_epi16(g, ug)), _mm_add_epi32(_mm_madd_epi16(b, ub), cRound));
+		__m128i v = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(r, vr), _mm_madd_epi16(g, vg)), _mm_add_epi32(_mm_madd_epi16(b, vb), cRound));
+		u = _mm_add_epi32(_mm_srai_epi32(u, 9), cOffset);
+		v = _mm_add_epi32(_mm_srai_epi32(v, 9), cOffset);
+		__m128i chroma = _mm_or_si128(u, _mm_slli_epi32(v, 16)); // U V per pair in 16 bit lanes
+		_mm_storeu_si128((__m128i *)(uyvy + i * 2), _mm_or_si128(chroma, _mm_slli_epi16(y, 8)));
+
+		if (alpha) {
+			__m128i a = _mm_packs_epi32(_mm_srli_epi32(p0, 24), _mm_srli_epi32(p1, 24));
+			_mm_storel_epi64((__m128i *)(alpha + i), _mm_packus_epi16(a, a));
+		}
+	}
+#endif
+	rgbaToUyvyScalar(rgba, uyvy, alpha, i, count, c, bBGRA);
+}
+
+void rgbaToUyvy(const unsigned char * rgba, unsigned char * uyvy, int count, YuvMatrix matrix, PixelPath path) {
+	if (resolve(path) == PIXEL_SSE2) rgbaToUyvySSE2(rgba, uyvy, nullptr, count, yuvCoefficients[matrix], false);
+	else rgbaToUyvyScalar(rgba, uyvy, nullptr, 0, count, yuvCoefficients[matrix], false);
+}
+
+void rgbaToUyva(const unsigned char * rgba, unsigned char * uyvy, unsigned char * alpha, int count, YuvMatrix matrix, PixelPath path) {
+	if (resolve(path) == PIXEL_SSE2) rgbaToUyvySSE2(rgba, uyvy, alpha, count, yuvCoefficients[matrix], false);
+	else rgbaToUyvyScalar(rgba, uyvy, alpha, 0, count, yuvCoefficients[matrix], false);
+}
+
+void bgraToUyvy(const unsigned char * bgra, unsigned char * uyvy, int count, YuvMatrix matrix, PixelPath path) {
+	if (resolve(path) == PIXEL_SSE2) rgbaToUyvySSE2(bgra, uyvy, nullptr, count, yuvCoefficients[matrix], true);
+	else rgbaToUyvyScalar(bgra, uyvy, nullptr, 0, count, yuvCoefficients[matrix], true);
+}
+
+void bgraToUyva(const unsigned char * bgra, unsigned char * uyvy, unsigned char * alpha, int count, YuvMatrix matrix, PixelPath path) {
+	if (resolve(path) == PIXEL_SSE2) rgbaToUyvySSE2(bgra, uyvy, alpha, count, yuvCoefficients[matrix], true);
+	else rgbaToUyvyScalar(bgra, uyvy, alpha, 0, count, yuvCoefficients[matrix], true);
+}
+
+//--------------------------------------------------------------
+InfraredLevels::InfraredLevels() {
+	setWindow(0, 65535);
+	setGamma(1);
+}
+
+void InfraredLevels::setWindow(int blackValue, int whiteValue) {
+	if (blackValue < 0) blackValue = 0;
+	if (blackValue > 65535 - PIXEL_IR_RANGE_MIN) blackValue = 65535 - PIXEL_IR_RANGE_MIN;
+	if (whiteValue > 65535) whiteValue = 65535;
+	if (whiteValue < blackValue + PIXEL_IR_RANGE_MIN) whiteValue = blackValue + PIXEL_IR_RANGE_MIN;
+	black = (unsigned int)blackValue;
+	range = (unsigned int)(whiteValue - blackValue);
+	scale = ((PIXEL_IR_STEPS - 1u) << 16) / range;
+	linearScale = (255u << 16) / range;
+}
+
+void InfraredLevels::setGamma(float gamma_) {
+	gamma = gamma_ > 0.01f ? gamma_ : 0.01f;
+	for (int i = 0; i < PIXEL_IR_STEPS; i++) {
+		curve[i] = (unsigned char)(255 * std::pow(i / (PIXEL_IR_STEPS - 1.0), 1.0 / gamma) + 0.5);
+	}
+}
+
+static inline bool isLinear(const InfraredLevels & levels) {
+	return levels.gamma == 1;
+}
+
+static void normalizeInfraredScalar(const unsigned short * infrared, unsigned char * out, int begin, int end, const InfraredLevels & levels) {
+	bool bLinear = isLinear(levels);
+	for (int i = begin; i < end; i++) {
+		unsigned int t = infrared[i] > levels.black ? infrared[i] - levels.black : 0;
+		if (t > levels.range) t = levels.range;
+		out[i] = bLinear ? (unsigned char)((t * levels.linearScale) >> 16) : levels.curve[(t * levels.scale) >> 16];
+	}
+}
+
+// 8 pixels per step like the depth ramp. The gamma curve needs a gather, so with a curve
+// SSE2 only works out the steps and the lookups stay scalar.
+static void normalizeInfraredSSE2(const unsigned short * infrared, unsigned char * out, int count, const InfraredLevels & levels) {
+	int i = 0;
+#if SIMD_X86
+	bool bLinear = isLinear(levels);
+	const __m128i black = _mm_set1_epi16((short)levels.black);
+	const __m128i range = _mm_set1_epi16((short)levels.range);
+	const __m128i scale = _mm_set1_epi16((short)(bLinear ? levels.linearScale : levels.scale));
+	unsigned short steps[8];
+	for (; i + 8 <= count; i += 8) {
+		__m128i t = _mm_subs_epu16(_mm_loadu_si128((const __m128i *)(infrared + i)), black);
+		t = _mm_sub_epi16(t, _mm_subs_epu16(t, range));
+		__m128i step = _mm_mulhi_epu16(t, scale);
+		if (bLinear) {
+			_mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi16(step, step));
+			continue;
+		}
+		_mm_storeu_si128((__m128i *)steps, step);
+		for (int j = 0; j < 8; j++) {
+			out[i + j] = levels.curve[steps[j]];
+		}
+	}
+#endif
+	normalizeInfraredScalar(infrared, out, i, count, levels);
+}
+
+void normalizeInfrared(const unsigned short * infrared, unsigned char * out, int count, const InfraredLevels & levels, PixelPath path) {
+	if (resolve(path) == PIXEL_SSE2) normalizeInfraredSSE2(infrared, out, count, levels);
+	else normalizeInfraredScalar(infrared, out, 0, count, levels);
+}
+
+void infraredPercentiles(const unsigned short * infrared, int count, float lowPercent, float highPercent, int & low, int & high) {
+	unsigned int histogram[1024] = { 0 };
+	int samples = 0;
+	for (int i = 0; i < count; i += 4) {
+		histogram[infrared[i] >> 6]++;
+		samples++;
+	}
+	unsigned int lowCount = (unsigned int)(samples * lowPercent / 100);
+	unsigned int highCount = (unsigned int)(samples * highPercent / 100);
+	unsigned int sum = 0;
+	low = -1;
+	high = 65535;
+	for (int bin = 0; bin < 1024; bin++) {
+		sum += histogram[bin];
+		if (low < 0 && sum > lowCount) low = bin << 6;
+		if (sum >= highCount) {
+			high = (bin << 6) + 63;
+			break;
+		}
+	}
+	if (low < 0) low = 0;
+}
+
+//--------------------------------------------------------------
+bool pixelPathSupported(PixelPath path) {
+	switch (path) {
+	case PIXEL_AUTO:
+	case PIXEL_SCALAR:
+		return true;
+	case PIXEL_SSE2:
+		return simdHasSSE2();
+	}
+	return false;
+}
+
+const char * pixelPathName(PixelPath path) {
+	switch (path) {
+	case PIXEL_AUTO:
+		return pixelPathName(pixelBestPath());
+	case PIXEL_SCALAR:
+		return "scalar";
+	case PIXEL_SSE2:
+		return "SSE2";
+	}
+	return "unknown";
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+// Per pixel conversions of the Kinect planes, same layout as keying.h: plain C++ on raw
+// planes, a scalar reference plus SSE2, every path gives the same bytes.
+//   bodyIndexMask : body index -> RGBA cutout, bodies opaque white, background transparent black
+//   swizzleRB     : BGRA <-> RGBA, swaps bytes 0 and 2 of every pixel (works both ways, in place too)
+//   colorizeDepth : depth (mm) -> RGBA gray ramp, nearMm = white .. farMm = black,
+//                   no reading (0) = transparent black
+//   encodeDepth   : depth (mm) -> 2 bytes per pixel for the NDI depth stream, see DepthEncoding
+//   normalizeInfrared : infrared (16 bit) -> 8 bit gray, black..white stretched, then the gamma curve
+//   rgbaToUyvy    : RGBA -> UYVY 4:2:2 in video levels, chroma of each pixel pair averaged
+//   rgbaToUyva    : the same plus the alpha bytes in a plane of their own (NDI's UYVA)
+//   bgraToUyvy / bgraToUyva : the same from BGRA (the Kinect's color plane), without a swizzle pass first
+// count is in pixels.
+
+#define PIXEL_DEPTH_RANGE_MIN 256 // farMm - nearMm is raised to this, keeps the ramp scale in 16 bits
+#define PIXEL_IR_STEPS 1024       // resolution of the infrared gamma curve
+#define PIXEL_IR_RANGE_MIN 1024   // white - black is raised to this, same reason as for depth
+
+enum PixelPath {
+	PIXEL_AUTO = 0, // best path the cpu supports
+	PIXEL_SCALAR,   // reference implementation
+	PIXEL_SSE2
+};
+
+// What the NDI depth stream carries (ndiStream.h), half the bytes of the RGBA depth fbo. Every frame
+// also has NDI metadata <kv2_depth encoding="rg16|window8|falsecolor" near="mm" far="mm"/> with the
+// window it was encoded with (after the DepthRamp clamps), so receivers can get millimetres back.
+// NDI compresses video, so only the 8 bit encodings survive it well: rg16 arrives exact where frames
+// are not recompressed, over NDI expect the low bytes (R / B) to be off by the codec's noise.
+enum DepthEncoding {
+	DEPTH_ENCODING_RGBA = 0,    // the depth fbo as drawn (raw or gray ramp), RGBA or UYVY as the stream is set up,
+	                            // not encodeDepth()'s
+	DEPTH_ENCODING_RG16,        // RGBA at half width, pixel x holds depth 2x in R (low byte) G (high byte)
+	                            // and depth 2x+1 in B A: mm = R + 256 * G, mm = B + 256 * A
+	DEPTH_ENCODING_WINDOW8,     // UYVY, U = V = 128, Y (full range) = the colorizeDepth gray ramp over near..far,
+	                            // 0 = no reading, otherwise at least 1: mm = near + (255 - Y) * (far - near) / 255
+	DEPTH_ENCODING_FALSE_COLOR, // UYVY, BT.601 video levels (SD, see YuvMatrix), the turbo color map over near..far:
+	                            // far blue .. near red, no reading black. Chroma is the average of the pixel pair
+	DEPTH_ENCODING_COUNT
+};
+
+// YUV matrix of the UYVY conversions: NDI receivers take BT.601 below 720 lines (all the Kinect
+// depth sized streams), BT.709 from there (color)
+enum YuvMatrix {
+	YUV_BT601 = 0,
+	YUV_BT709
+};
+inline YuvMatrix yuvMatrixFor(int height) { return height < 720 ? YUV_BT601 : YUV_BT709; }
+
+// near / far clamped to a valid ramp, shared with the depth shader (keyingShaders.h)
+struct DepthRamp {
+	unsigned int nearMm, range, scale;
+	DepthRamp(int nearMm, int farMm);
+};
+
+void bodyIndexMask(const unsigned char * bodyIndex, unsigned char * outRGBA, int count, PixelPath path = PIXEL_AUTO);
+void swizzleRB(const unsigned char * src, unsigned char * dst, int count, PixelPath path = PIXEL_AUTO);
+void colorizeDepth(const unsigned short * depth, unsigned char * outRGBA, int count, int nearMm, int farMm,
+	PixelPath path = PIXEL_AUTO);
+
+// Infrared levels: (min(ir - black, range) * scale) >> 16 is a step of the gamma curve,
+// with gamma 1 the curve is skipped and the step goes straight to 0..255
+struct InfraredLevels {
+	unsigned int black, range, scale, linearScale;
+	float gamma;
+	unsigned char curve[PIXEL_IR_STEPS];
+	InfraredLevels();
+	void setWindow(int black, int white); // cheap, every frame with auto gain
+	void setGamma(float gamma);           // builds the curve
+};
+
+// count even, out gets count * 2 bytes. DEPTH_ENCODING_RGBA does nothing.
+void encodeDepth(DepthEncoding encoding, const unsigned short * depth, unsigned char * out, int count,
+	int nearMm, int farMm, PixelPath path = PIXEL_AUTO);
+// DEPTH_ENCODING_WINDOW8 Y back to millimetres (0 for no reading), what a receiver does
+int decodeDepthWindow8(unsigned char y, int nearMm, int farMm);
+const char * depthEncodingName(DepthEncoding encoding); // as in the metadata
+
+void normalizeInfrared(const unsigned short * infrared, unsigned char * out, int count, const InfraredLevels & levels,
+	PixelPath path = PIXEL_AUTO);
+// count even, uyvy gets count * 2 bytes, alpha count bytes
+void rgbaToUyvy(const unsigned char * rgba, unsigned char * uyvy, int count, YuvMatrix matrix, PixelPath path = PIXEL_AUTO);
+void rgbaToUyva(const unsigned char * rgba, unsigned char * uyvy, unsigned char * alpha, int count, YuvMatrix matrix,
+	PixelPath path = PIXEL_AUTO);
+void bgraToUyvy(const unsigned char * bgra, unsigned char * uyvy, int count, YuvMatrix matrix, PixelPath path = PIXEL_AUTO);
+void bgraToUyva(const unsigned char * bgra, unsigned char * uyvy, unsigned char * alpha, int count, YuvMatrix matrix,
+	PixelPath path = PIXEL_AUTO);
+// low / high percentiles of an infrared plane (every 4th pixel, 64 wide bins) for auto gain
+void infraredPercentiles(const unsigned short * infrared, int count, float lowPercent, float highPercent, int & low, int & high);
+
+bool pixelPathSupported(PixelPath path);
+const char * pixelPathName(PixelPath path);
@@ -0,0 +1,43 @@
+#include "simd.h"
+
+#if SIMD_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//--------------------------------------------------------------
+bool simdHasSSE2() {
+#if SIMD_X86
+	return true; // baseline for every x64 build and the /arch:SSE2 default on Win32
+#else
+	return false;
+#endif
+}
+
+//--------------------------------------------------------------
+static bool detectAVX2() {
+#if SIMD_X86 && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+
+	// the OS has to save the YMM registers too (OSXSAVE + XCR0 bits 1,2)
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx) return false;
+	if ((_xgetbv(0) & 6) != 6) return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#else
+	return false;
+#endif
+}
+
+bool simdHasAVX2() {
+	static const bool hasAVX2 = detectAVX2();
+	return hasAVX2;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Small helpers shared by the SIMD kernels (keying etc.)
+// Kernels are plain C++ with no openFrameworks / Kinect dependency so they can be
+// built and benchmarked on any x86 box, not just the capture machine.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SIMD_X86 1
+#include <emmintrin.h>  // SSE2
+#include <immintrin.h>  // AVX2
+#else
+#define SIMD_X86 0
+#endif
+
+// GCC/Clang need the target attribute to emit AVX2 code in a function when the
+// translation unit is compiled for SSE2. MSVC emits intrinsics regardless of /arch.
+#if SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_TARGET_AVX2
+#endif
+
+// Runtime CPU checks (cached after the first call)
+bool simdHasSSE2();
+bool simdHasAVX2();
@@ -0,0 +1,73 @@
+#include "skeletonDelta.h"
+
+#include <cstring>
+
+//--------------------------------------------------------------
+SkeletonDeltaFilter::SkeletonDeltaFilter()
+	: threshold(0.005f)
+	, keyframeMicros(1000000)
+	, lastKeyframe(0) {
+	reset();
+}
+
+void SkeletonDeltaFilter::setThreshold(float meters) {
+	threshold = meters > 0 ? meters : 0;
+}
+
+void SkeletonDeltaFilter::setKeyframeInterval(long long micros) {
+	keyframeMicros = micros;
+}
+
+void SkeletonDeltaFilter::reset() {
+	memset(sent, 0, sizeof(sent));
+	memset(&delta, 0, sizeof(delta));
+	bNeedKeyframe = true;
+}
+
+//--------------------------------------------------------------
+const SkeletonDelta & SkeletonDeltaFilter::update(const KinectFrame & frame) {
+	// timestamps restart when a replay loops, that gets a keyframe too
+	long long sinceKeyframe = frame.timestamp - lastKeyframe;
+	delta.bKeyframe = bNeedKeyframe || sinceKeyframe >= keyframeMicros || sinceKeyframe < 0;
+	if (delta.bKeyframe) {
+		lastKeyframe = frame.timestamp;
+		bNeedKeyframe = false;
+	}
+
+	const float thresholdSq = threshold * threshold;
+	for (int b = 0; b < BODY_COUNT_MAX; b++) {
+		const BodySample & body = frame.bodies[b];
+		SentBody & last = sent[b];
+
+		bool bStateChanged = !last.bValid || body.tracked != last.tracked || body.trackingId != last.trackingId
+			|| body.leftHandState != last.leftHandState || body.rightHandState != last.rightHandState;
+		bool bFull = delta.bKeyframe || bStateChanged;
+
+		unsigned int mask = 0;
+		if (body.tracked) {
+			for (int j = 0; j < JOINT_COUNT; j++) {
+				const JointSample & joint = body.joints[j];
+				if (!bFull) {
+					float dx = joint.position[0] - last.position[j][0];
+					float dy = joint.position[1] - last.position[j][1];
+					float dz = joint.position[2] - last.position[j][2];
+					if (dx * dx + dy * dy + dz * dz <= thresholdSq && joint.trackingState == last.trackingState[j]) continue;
+				}
+				mask |= 1u << j;
+				memcpy(last.position[j], joint.position, sizeof(last.position[j]));
+				last.trackingState[j] = joint.trackingState;
+			}
+		}
+
+		delta.jointMask[b] = mask;
+		delta.bSendBody[b] = bFull || mask != 0;
+		if (delta.bSendBody[b]) {
+			last.bValid = true;
+			last.tracked = body.tracked;
+			last.trackingId = body.trackingId;
+			last.leftHandState = body.leftHandState;
+			last.rightHandState = body.rightHandState;
+		}
+	}
+	return delta;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "frameSource.h"
+
+// Change driven skeleton streaming: decides per frame which bodies and joints are worth sending.
+// A joint goes out when it moved more than the dead band since it was last sent, a body when any
+// of its joints did or its state changed (tracked, tracking id, hand states). Bodies that stay
+// untracked are sent once and then left out. Every keyframe interval everything is sent again,
+// so receivers that join late or lost packets catch up.
+// Bodies are indexed by their slot in KinectFrame::bodies.
+
+#define SKELETON_DELTA_ALL_JOINTS ((1u << JOINT_COUNT) - 1)
+
+struct SkeletonDelta {
+	bool bKeyframe;
+	bool bSendBody[BODY_COUNT_MAX];
+	unsigned int jointMask[BODY_COUNT_MAX]; // bit j: joint j moved (tracked bodies only)
+};
+
+class SkeletonDeltaFilter {
+public:
+	SkeletonDeltaFilter();
+
+	void setThreshold(float meters);
+	void setKeyframeInterval(long long micros);
+	// forget what was sent, the next update() is a keyframe
+	void reset();
+
+	// what of this frame to send, everything that is marked counts as sent
+	const SkeletonDelta & update(const KinectFrame & frame);
+
+private:
+	struct SentBody {
+		bool bValid;
+		int tracked;
+		unsigned long long trackingId;
+		int leftHandState;
+		int rightHandState;
+		float position[JOINT_COUNT][3];
+		int trackingState[JOINT_COUNT];
+	};
+
+	float threshold;
+	long long keyframeMicros;
+	long long lastKeyframe;
+	bool bNeedKeyframe;
+	SentBody sent[BODY_COUNT_MAX];
+	SkeletonDelta delta;
+};
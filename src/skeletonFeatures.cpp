@@ -0,0 +1,162 @@
+#include "skeletonFeatures.h"
+
+#include <cmath>
+#include <cstring>
+
+const int featureAngles[FEATURE_ANGLE_COUNT][3] = {
+	{ 4, 5, 6 }, { 8, 9, 10 },       // elbows
+	{ 20, 4, 5 }, { 20, 8, 9 },      // shoulders
+	{ 5, 6, 7 }, { 9, 10, 11 },      // wrists
+	{ 0, 12, 13 }, { 0, 16, 17 },    // hips
+	{ 12, 13, 14 }, { 16, 17, 18 },  // knees
+	{ 13, 14, 15 }, { 17, 18, 19 },  // ankles
+	{ 0, 1, 20 },                    // spine
+	{ 20, 2, 3 }                     // neck
+};
+
+const char * featureAngleNames[FEATURE_ANGLE_COUNT] = { "ElbowL", "ElbowR", "ShldrL", "ShldrR",
+	"WristL", "WristR", "HipL", "HipR", "KneeL", "KneeR", "AnkleL", "AnkleR", "Spine", "Neck" };
+
+// JointType
+enum {
+	JOINT_HEAD = 3,
+	JOINT_SHOULDER_LEFT = 4,
+	JOINT_WRIST_LEFT = 6,
+	JOINT_HAND_LEFT = 7,
+	JOINT_SHOULDER_RIGHT = 8,
+	JOINT_WRIST_RIGHT = 10,
+	JOINT_HAND_RIGHT = 11
+};
+
+static const float radiansToDegrees = 57.2957795f;
+
+//--------------------------------------------------------------
+FeatureEngine::FeatureEngine() {
+	reset();
+}
+
+void FeatureEngine::reset() {
+	bStarted = false;
+	lastTimestamp = 0;
+	invDt = 0;
+	memset(trackingIds, 0, sizeof(trackingIds));
+	memset(velocitySamples, 0, sizeof(velocitySamples));
+	memset(previous, 0, sizeof(previous));
+	memset(velocity, 0, sizeof(velocity));
+	memset(previousVelocity, 0, sizeof(previousVelocity));
+	memset(bodies, 0, sizeof(bodies));
+}
+
+void FeatureEngine::update(const SkeletonFrame & frame) {
+	float dt = (frame.timestamp - lastTimestamp) / 1000000.0f;
+	bool bRestart = !bStarted || dt <= 0 || dt > 0.5f;
+	lastTimestamp = frame.timestamp;
+	bStarted = true;
+
+	// bodies without a previous frame start at rest
+	for (int b = 0; b < BODY_COUNT_MAX; b++) {
+		bool bNew = bRestart || !bodies[b].tracked || frame.trackingId[b] != trackingIds[b];
+		trackingIds[b] = frame.trackingId[b];
+		if (!frame.tracked[b]) continue;
+		if (!bNew) {
+			if (velocitySamples[b] < 2) velocitySamples[b]++;
+			continue;
+		}
+		velocitySamples[b] = 0;
+		for (int c = 0; c < 3; c++) {
+			int first = SkeletonFrame::index(b, 0);
+			memcpy(&previous[c][first], &frame.position[c][first], JOINT_COUNT * sizeof(float));
+			memset(&velocity[c][first], 0, JOINT_COUNT * sizeof(float));
+		}
+	}
+
+	// velocities of every joint of every body in one sweep
+	invDt = bRestart ? 0 : 1.0f / dt;
+	for (int c = 0; c < 3; c++) {
+		const float * pos = frame.position[c];
+		float * prev = previous[c];
+		float * vel = velocity[c];
+		float * prevVel = previousVelocity[c];
+		for (int i = 0; i < SKELETON_STRIDE; i++) {
+			prevVel[i] = vel[i];
+			vel[i] = (pos[i] - prev[i]) * invDt;
+			prev[i] = pos[i];
+		}
+	}
+
+	for (int b = 0; b < BODY_COUNT_MAX; b++) {
+		updateBody(b, frame);
+	}
+}
+
+//--------------------------------------------------------------
+void FeatureEngine::updateBody(int b, const SkeletonFrame & frame) {
+	BodyFeatures & features = bodies[b];
+	unsigned int lastTriggers = features.triggers;
+	features.tracked = frame.tracked[b];
+	if (!features.tracked) {
+		features.triggers = features.triggersStarted = 0;
+		return;
+	}
+
+	const float * x = frame.position[0];
+	const float * y = frame.position[1];
+	const float * z = frame.position[2];
+	const int first = SkeletonFrame::index(b, 0);
+
+	// the velocity before the first real one is the 0 a new body starts with, no acceleration yet
+	float accelerationScale = velocitySamples[b] >= 2 ? invDt : 0;
+	for (int j = 0; j < JOINT_COUNT; j++) {
+		int i = first + j;
+		float vx = velocity[0][i], vy = velocity[1][i], vz = velocity[2][i];
+		float ax = (vx - previousVelocity[0][i]) * accelerationScale;
+		float ay = (vy - previousVelocity[1][i]) * accelerationScale;
+		float az = (vz - previousVelocity[2][i]) * accelerationScale;
+		features.speed[j] = std::sqrt(vx * vx + vy * vy + vz * vz);
+		features.acceleration[j] = std::sqrt(ax * ax + ay * ay + az * az);
+	}
+
+	for (int n = 0; n < BONE_COUNT; n++) {
+		int from = first + boneAtlas[n][0];
+		int to = first + boneAtlas[n][1];
+		float dx = x[to] - x[from], dy = y[to] - y[from], dz = z[to] - z[from];
+		float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+		float invLength = length > 0 ? 1.0f / length : 0;
+		features.boneDirection[n][0] = dx * invLength;
+		features.boneDirection[n][1] = dy * invLength;
+		features.boneDirection[n][2] = dz * invLength;
+		features.boneLength[n] = length;
+	}
+
+	for (int n = 0; n < FEATURE_ANGLE_COUNT; n++) {
+		int a = first + featureAngles[n][0];
+		int v = first + featureAngles[n][1];
+		int c = first + featureAngles[n][2];
+		float ux = x[a] - x[v], uy = y[a] - y[v], uz = z[a] - z[v];
+		float wx = x[c] - x[v], wy = y[c] - y[v], wz = z[c] - z[v];
+		float lengths = std::sqrt((ux * ux + uy * uy + uz * uz) * (wx * wx + wy * wy + wz * wz));
+		float cosine = lengths > 0 ? (ux * wx + uy * wy + uz * wz) / lengths : 1;
+		cosine = cosine < -1 ? -1 : (cosine > 1 ? 1 : cosine);
+		features.angle[n] = std::acos(cosine) * radiansToDegrees;
+	}
+
+	int handL = first + JOINT_HAND_LEFT, handR = first + JOINT_HAND_RIGHT, head = first + JOINT_HEAD;
+	float hx = x[handL] - x[handR], hy = y[handL] - y[handR], hz = z[handL] - z[handR];
+	features.handDistance = std::sqrt(hx * hx + hy * hy + hz * hz);
+
+	unsigned int triggers = 0;
+	if (y[handL] > y[head]) triggers |= FEATURE_LEFT_HAND_UP;
+	if (y[handR] > y[head]) triggers |= FEATURE_RIGHT_HAND_UP;
+	if ((triggers & FEATURE_LEFT_HAND_UP) && (triggers & FEATURE_RIGHT_HAND_UP)) triggers |= FEATURE_HANDS_UP;
+	if (features.handDistance < FEATURE_HANDS_TOGETHER_DISTANCE) triggers |= FEATURE_HANDS_TOGETHER;
+
+	// T: straight elbows, wrists at shoulder height and far apart
+	bool bElbowsStraight = features.angle[0] > 150 && features.angle[1] > 150; // ElbowL, ElbowR
+	bool bWristsLevel = std::fabs(y[first + JOINT_WRIST_LEFT] - y[first + JOINT_SHOULDER_LEFT]) < 0.15f
+		&& std::fabs(y[first + JOINT_WRIST_RIGHT] - y[first + JOINT_SHOULDER_RIGHT]) < 0.15f;
+	if (bElbowsStraight && bWristsLevel && features.handDistance > 1.0f) triggers |= FEATURE_T_POSE;
+	if (features.angle[8] < FEATURE_CROUCH_ANGLE && features.angle[9] < FEATURE_CROUCH_ANGLE) triggers |= FEATURE_CROUCH; // KneeL, KneeR
+
+	features.triggers = triggers;
+	features.triggersStarted = triggers & ~lastTriggers;
+}
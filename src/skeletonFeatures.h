@@ -0,0 +1,68 @@
+#pragma once
+
+#include "skeletonStore.h"
+
+// Things most receivers work out from the joints themselves, computed once per frame for all
+// bodies and sent along over OSC:
+//   bone vectors   : unit direction + length of every boneAtlas bone (first -> second joint of the pair)
+//   joint angles   : the angle at the middle joint of each featureAngles triplet, degrees
+//   speed / accel  : per joint, m/s and m/s^2 (finite differences between frames)
+//   pose triggers  : FeatureTrigger bits, plus the ones that switched on this frame
+// Velocities run over the whole SkeletonFrame position rows at once, like SkeletonFilter.
+
+#define FEATURE_ANGLE_COUNT 14
+
+enum FeatureTrigger {
+	FEATURE_LEFT_HAND_UP = 1 << 0,    // hand above the head
+	FEATURE_RIGHT_HAND_UP = 1 << 1,
+	FEATURE_HANDS_UP = 1 << 2,        // both
+	FEATURE_HANDS_TOGETHER = 1 << 3,  // hands closer than FEATURE_HANDS_TOGETHER_DISTANCE
+	FEATURE_T_POSE = 1 << 4,          // arms straight out to the sides
+	FEATURE_CROUCH = 1 << 5           // both knees bent past FEATURE_CROUCH_ANGLE
+};
+
+#define FEATURE_HANDS_TOGETHER_DISTANCE 0.15f // meters
+#define FEATURE_CROUCH_ANGLE 120.0f // degrees, straight leg is 180
+
+// {joint, vertex joint, joint} in JointType order, names as sent in featureAngleNames
+extern const int featureAngles[FEATURE_ANGLE_COUNT][3];
+extern const char * featureAngleNames[FEATURE_ANGLE_COUNT];
+
+struct BodyFeatures {
+	int tracked;
+	float boneDirection[BONE_COUNT][3];
+	float boneLength[BONE_COUNT];
+	float angle[FEATURE_ANGLE_COUNT];
+	float speed[JOINT_COUNT];
+	float acceleration[JOINT_COUNT];
+	float handDistance;
+	unsigned int triggers;        // FeatureTrigger bits
+	unsigned int triggersStarted; // bits that weren't set last frame
+};
+
+class FeatureEngine {
+public:
+	FeatureEngine();
+
+	void reset();
+	// one batched pass over every body of the frame
+	void update(const SkeletonFrame & frame);
+
+	const BodyFeatures & getBody(int body) const { return bodies[body]; }
+
+private:
+	void updateBody(int body, const SkeletonFrame & frame);
+
+	bool bStarted;
+	long long lastTimestamp;
+	float invDt; // 1 / seconds since the last frame, 0 after a restart
+	unsigned long long trackingIds[BODY_COUNT_MAX];
+	int velocitySamples[BODY_COUNT_MAX]; // real velocities since the body showed up, acceleration needs 2
+
+	// same layout as SkeletonFrame::position
+	float previous[3][SKELETON_STRIDE];
+	float velocity[3][SKELETON_STRIDE];
+	float previousVelocity[3][SKELETON_STRIDE];
+
+	BodyFeatures bodies[BODY_COUNT_MAX];
+};
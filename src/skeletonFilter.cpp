@@ -0,0 +1,148 @@
+#include "skeletonFilter.h"
+#include "simd.h"
+
+#include <cmath>
+#include <cstring>
+
+static const float twoPi = 6.28318530718f;
+
+//--------------------------------------------------------------
+SkeletonFilter::SkeletonFilter()
+	: bSimd(true) {
+	reset();
+}
+
+void SkeletonFilter::setSettings(const SkeletonFilterSettings & settings_) {
+	if (settings_.type != settings.type) reset();
+	settings = settings_;
+}
+
+void SkeletonFilter::reset() {
+	bStarted = false;
+	lastTimestamp = 0;
+	memset(trackingIds, 0, sizeof(trackingIds));
+	memset(bTracked, 0, sizeof(bTracked));
+	memset(value, 0, sizeof(value));
+	memset(velocity, 0, sizeof(velocity));
+}
+
+void SkeletonFilter::resetBody(int body, const SkeletonFrame & frame) {
+	for (int c = 0; c < 3; c++) {
+		int first = c * SKELETON_STRIDE + SkeletonFrame::index(body, 0);
+		memcpy(value + first, &frame.position[c][SkeletonFrame::index(body, 0)], JOINT_COUNT * sizeof(float));
+		memset(velocity + first, 0, JOINT_COUNT * sizeof(float));
+	}
+}
+
+//--------------------------------------------------------------
+void SkeletonFilter::apply(SkeletonFrame & frame) {
+	if (settings.type == SKELETON_FILTER_OFF) return;
+
+	// timestamps going back (replay loop) or a long gap: start over
+	float dt = (frame.timestamp - lastTimestamp) / 1000000.0f;
+	bool bRestart = !bStarted || dt <= 0 || dt > SKELETON_FILTER_MAX_GAP;
+	lastTimestamp = frame.timestamp;
+	bStarted = true;
+
+	for (int b = 0; b < BODY_COUNT_MAX; b++) {
+		bool bNew = frame.tracked[b] && (bRestart || !bTracked[b] || frame.trackingId[b] != trackingIds[b]);
+		bTracked[b] = frame.tracked[b] != 0;
+		trackingIds[b] = frame.trackingId[b];
+		if (bNew) resetBody(b, frame);
+	}
+	if (bRestart) dt = 1.0f / KINECT_FPS; // only matters for the first step, which starts at zero velocity
+
+	if (bSimd && simdHasSSE2()) runSSE2(frame.position[0], dt);
+	else runScalar(frame.position[0], dt);
+}
+
+//--------------------------------------------------------------
+// Reference, runSSE2() does the same operations in the same order
+void SkeletonFilter::runScalar(float * position, float dt) {
+	const float invDt = 1.0f / dt;
+	const float predict = settings.predictMs / 1000.0f;
+
+	if (settings.type == SKELETON_FILTER_ONE_EURO) {
+		const float twoPiDt = twoPi * dt;
+		const float rd = twoPiDt * settings.derivativeCutoff;
+		const float alphaD = rd / (rd + 1.0f);
+		for (int i = 0; i < SKELETON_FILTER_SIZE; i++) {
+			float x = position[i];
+			float v = velocity[i];
+			float dx = (x - value[i]) * invDt;
+			v = v + alphaD * (dx - v);
+			float cutoff = settings.minCutoff + settings.beta * std::fabs(v);
+			float r = twoPiDt * cutoff;
+			float alpha = r / (r + 1.0f);
+			float s = value[i] + alpha * (x - value[i]);
+			value[i] = s;
+			velocity[i] = v;
+			position[i] = s + v * predict;
+		}
+	}
+	else {
+		const float alpha = settings.smoothing;
+		const float gamma = settings.trendSmoothing;
+		for (int i = 0; i < SKELETON_FILTER_SIZE; i++) {
+			float x = position[i];
+			float v = velocity[i];
+			float s = value[i] + v * dt;
+			s = s + alpha * (x - s);
+			v = v + gamma * ((s - value[i]) * invDt - v);
+			value[i] = s;
+			velocity[i] = v;
+			position[i] = s + v * predict;
+		}
+	}
+}
+
+// Unaligned loads: the filter lives inside ofApp, which new only aligns to 8 bytes on Win32
+void SkeletonFilter::runSSE2(float * position, float dt) {
+#if SIMD_X86
+	const __m128 invDt = _mm_set1_ps(1.0f / dt);
+	const __m128 predict = _mm_set1_ps(settings.predictMs / 1000.0f);
+
+	if (settings.type == SKELETON_FILTER_ONE_EURO) {
+		const float twoPiDtScalar = twoPi * dt;
+		const float rd = twoPiDtScalar * settings.derivativeCutoff;
+		const __m128 alphaD = _mm_set1_ps(rd / (rd + 1.0f));
+		const __m128 twoPiDt = _mm_set1_ps(twoPiDtScalar);
+		const __m128 minCutoff = _mm_set1_ps(settings.minCutoff);
+		const __m128 beta = _mm_set1_ps(settings.beta);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		for (int i = 0; i < SKELETON_FILTER_SIZE; i += 4) {
+			__m128 x = _mm_loadu_ps(position + i);
+			__m128 v = _mm_loadu_ps(velocity + i);
+			__m128 prev = _mm_loadu_ps(value + i);
+			__m128 dx = _mm_mul_ps(_mm_sub_ps(x, prev), invDt);
+			v = _mm_add_ps(v, _mm_mul_ps(alphaD, _mm_sub_ps(dx, v)));
+			__m128 cutoff = _mm_add_ps(minCutoff, _mm_mul_ps(beta, _mm_andnot_ps(signBit, v)));
+			__m128 r = _mm_mul_ps(twoPiDt, cutoff);
+			__m128 alpha = _mm_div_ps(r, _mm_add_ps(r, one));
+			__m128 s = _mm_add_ps(prev, _mm_mul_ps(alpha, _mm_sub_ps(x, prev)));
+			_mm_storeu_ps(value + i, s);
+			_mm_storeu_ps(velocity + i, v);
+			_mm_storeu_ps(position + i, _mm_add_ps(s, _mm_mul_ps(v, predict)));
+		}
+	}
+	else {
+		const __m128 alpha = _mm_set1_ps(settings.smoothing);
+		const __m128 gamma = _mm_set1_ps(settings.trendSmoothing);
+		const __m128 dtv = _mm_set1_ps(dt);
+		for (int i = 0; i < SKELETON_FILTER_SIZE; i += 4) {
+			__m128 x = _mm_loadu_ps(position + i);
+			__m128 v = _mm_loadu_ps(velocity + i);
+			__m128 prev = _mm_loadu_ps(value + i);
+			__m128 s = _mm_add_ps(prev, _mm_mul_ps(v, dtv));
+			s = _mm_add_ps(s, _mm_mul_ps(alpha, _mm_sub_ps(x, s)));
+			v = _mm_add_ps(v, _mm_mul_ps(gamma, _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(s, prev), invDt), v)));
+			_mm_storeu_ps(value + i, s);
+			_mm_storeu_ps(velocity + i, v);
+			_mm_storeu_ps(position + i, _mm_add_ps(s, _mm_mul_ps(v, predict)));
+		}
+	}
+#else
+	runScalar(position, dt);
+#endif
+}
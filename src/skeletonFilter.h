@@ -0,0 +1,74 @@
+#pragma once
+
+#include "skeletonStore.h"
+
+// Per joint smoothing + prediction of the body positions before they go out over OSC.
+//   One Euro          : low pass whose cutoff rises with speed, little jitter when still and little
+//                       lag when moving (Casiez et al. 2012)
+//   Double exponential: Holt's level + trend smoothing
+// Both keep a velocity estimate, so the output can be pushed predictMs ahead to make up for the
+// filter and network latency.
+//
+// Works in place on the SkeletonFrame position rows: x of every joint of all six bodies, then y,
+// then z, so the whole skeleton set is one flat float array and the kernel runs on it 4 lanes at
+// a time. Only camera space positions are filtered, depth map positions and orientations pass through.
+
+enum SkeletonFilterType {
+	SKELETON_FILTER_OFF = 0,
+	SKELETON_FILTER_ONE_EURO,
+	SKELETON_FILTER_DOUBLE_EXP,
+	SKELETON_FILTER_TYPE_COUNT
+};
+
+struct SkeletonFilterSettings {
+	int type;               // SkeletonFilterType
+	float minCutoff;        // One Euro: Hz, cutoff when still
+	float beta;             // One Euro: cutoff increase per m/s
+	float derivativeCutoff; // One Euro: Hz, smoothing of the speed estimate
+	float smoothing;        // double exponential: weight of the new sample, 0 - 1
+	float trendSmoothing;   // double exponential: weight of the new trend, 0 - 1
+	float predictMs;        // forward prediction
+
+	SkeletonFilterSettings()
+		: type(SKELETON_FILTER_OFF)
+		, minCutoff(1.0f)
+		, beta(1.0f)
+		, derivativeCutoff(1.0f)
+		, smoothing(0.5f)
+		, trendSmoothing(0.5f)
+		, predictMs(0) {
+	}
+};
+
+#define SKELETON_FILTER_SIZE (SKELETON_STRIDE * 3) // position rows of a SkeletonFrame
+#define SKELETON_FILTER_MAX_GAP 0.5f // seconds without frames before the filter starts over
+
+class SkeletonFilter {
+public:
+	SkeletonFilter();
+
+	void setSettings(const SkeletonFilterSettings & settings);
+	const SkeletonFilterSettings & getSettings() const { return settings; }
+	void setSimd(bool bSimd_) { bSimd = bSimd_; } // scalar reference path when false (bench)
+	void reset();
+
+	// filters the positions in place, a body that (re)appears or changes tracking id starts from
+	// its raw position. Untracked bodies run along on whatever they hold, which is harmless.
+	void apply(SkeletonFrame & frame);
+
+private:
+	void resetBody(int body, const SkeletonFrame & frame);
+	void runScalar(float * position, float dt);
+	void runSSE2(float * position, float dt);
+
+	SkeletonFilterSettings settings;
+	bool bSimd;
+	bool bStarted;
+	long long lastTimestamp;
+	unsigned long long trackingIds[BODY_COUNT_MAX];
+	bool bTracked[BODY_COUNT_MAX];
+
+	// same layout as SkeletonFrame::position
+	float value[SKELETON_FILTER_SIZE]; // filtered position
+	float velocity[SKELETON_FILTER_SIZE]; // m/s
+};
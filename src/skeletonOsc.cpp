@@ -0,0 +1,170 @@
+#include "skeletonOsc.h"
+
+static_assert(JOINT_COUNT * 2 <= 64, "joint states have to fit the int64 argument");
+
+//--------------------------------------------------------------
+long long skeletonJointStates(const BodySample & body) {
+	unsigned long long states = 0;
+	for (int j = 0; j < JOINT_COUNT; j++) {
+		states |= (unsigned long long)(body.joints[j].trackingState & 3) << (2 * j);
+	}
+	return (long long)states;
+}
+
+void skeletonBinaryMessage(const BodySample & body, ofxOscMessage & m) {
+	static const string addresses[BODY_COUNT_MAX] = {
+		"/kV2/skel/0", "/kV2/skel/1", "/kV2/skel/2", "/kV2/skel/3", "/kV2/skel/4", "/kV2/skel/5"
+	};
+	int bodyId = body.bodyId >= 0 && body.bodyId < BODY_COUNT_MAX ? body.bodyId : 0;
+
+	m.clear();
+	m.setAddress(addresses[bodyId]);
+	m.addIntArg(body.tracked);
+	m.addInt64Arg((long long)body.trackingId);
+	m.addIntArg(body.leftHandState);
+	m.addIntArg(body.rightHandState);
+	if (!body.tracked) return;
+
+	m.addInt64Arg(skeletonJointStates(body));
+	for (int j = 0; j < JOINT_COUNT; j++) {
+		const float * pos = body.joints[j].position;
+		m.addFloatArg(pos[0]);
+		m.addFloatArg(pos[1]);
+		m.addFloatArg(pos[2]);
+	}
+}
+
+void skeletonFeaturesMessage(int bodyId, const BodyFeatures & features, ofxOscMessage & m) {
+	static const string addresses[BODY_COUNT_MAX] = {
+		"/kV2/features/0", "/kV2/features/1", "/kV2/features/2", "/kV2/features/3", "/kV2/features/4", "/kV2/features/5"
+	};
+	m.clear();
+	m.setAddress(addresses[bodyId]);
+	m.addIntArg(features.triggers);
+	m.addIntArg(features.triggersStarted);
+	m.addFloatArg(features.handDistance);
+	for (int n = 0; n < FEATURE_ANGLE_COUNT; n++) m.addFloatArg(features.angle[n]);
+	for (int j = 0; j < JOINT_COUNT; j++) m.addFloatArg(features.speed[j]);
+	for (int j = 0; j < JOINT_COUNT; j++) m.addFloatArg(features.acceleration[j]);
+}
+
+void skeletonBonesMessage(int bodyId, const BodyFeatures & features, ofxOscMessage & m) {
+	static const string addresses[BODY_COUNT_MAX] = {
+		"/kV2/bones/0", "/kV2/bones/1", "/kV2/bones/2", "/kV2/bones/3", "/kV2/bones/4", "/kV2/bones/5"
+	};
+	m.clear();
+	m.setAddress(addresses[bodyId]);
+	for (int n = 0; n < BONE_COUNT; n++) {
+		m.addFloatArg(features.boneDirection[n][0]);
+		m.addFloatArg(features.boneDirection[n][1]);
+		m.addFloatArg(features.boneDirection[n][2]);
+		m.addFloatArg(features.boneLength[n]);
+	}
+}
+
+void skeletonSchemaMessage(ofxOscMessage & m) {
+	m.clear();
+	m.setAddress(SKELETON_SCHEMA_ADDRESS);
+	m.addIntArg(SKELETON_SCHEMA_VERSION);
+	m.addIntArg(JOINT_COUNT);
+	for (int j = 0; j < JOINT_COUNT; j++) {
+		m.addStringArg(jointNames[j]);
+	}
+}
+
+//--------------------------------------------------------------
+// OSC strings are null terminated and padded to 4 bytes
+static int oscStringBytes(size_t length) {
+	return (int)(length + 4) & ~3;
+}
+
+static const int bundleHeaderBytes = 16; // "#bundle\0" + time tag
+static const int frameMessageBytes = 4 + oscStringBytes(strlen(SKELETON_FRAME_ADDRESS)) + oscStringBytes(3) + 2 * 8;
+
+SkeletonJointBundler::SkeletonJointBundler()
+	: names(jointNames)
+	, maxPacketBytes(SKELETON_BUNDLE_MAX_BYTES)
+	, bundleBytes(0) {
+}
+
+void SkeletonJointBundler::setup(const char * const names_[JOINT_COUNT], int maxPacketBytes_) {
+	names = names_;
+	maxPacketBytes = maxPacketBytes_;
+	for (int b = 0; b < BODY_COUNT_MAX; b++) {
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			addresses[b][j] = "/" + ofToString(b) + "/" + names[j];
+			// size prefix + address + ",fffs" + 3 floats + name
+			messageBytes[b][j] = 4 + oscStringBytes(addresses[b][j].size()) + oscStringBytes(5) + 3 * 4 + oscStringBytes(strlen(names[j]));
+		}
+	}
+}
+
+void SkeletonJointBundler::jointMessage(const BodySample & body, int joint, ofxOscMessage & m) const {
+	const float * pos = body.joints[joint].position;
+	m.clear();
+	m.setAddress(addresses[body.bodyId][joint]);
+	m.addFloatArg(pos[0]);
+	m.addFloatArg(pos[1]);
+	m.addFloatArg(pos[2]);
+	m.addStringArg(names[joint]);
+}
+
+void SkeletonJointBundler::startBundle(const KinectFrame & frame) {
+	ofxOscMessage m;
+	m.setAddress(SKELETON_FRAME_ADDRESS);
+	m.addInt64Arg((long long)frame.frameNumber);
+	m.addInt64Arg(frame.timestamp);
+	bundle.clear();
+	bundle.addMessage(m);
+	bundleBytes = bundleHeaderBytes + frameMessageBytes;
+}
+
+//--------------------------------------------------------------
+int SkeletonJointBundler::sendBundled(ofxOscSender & sender, const KinectFrame & frame, const SkeletonDelta * delta) {
+	int packets = 0;
+	bool bStarted = false;
+	ofxOscMessage m;
+	for (int b = 0; b < BODY_COUNT_MAX; b++) {
+		const BodySample & body = frame.bodies[b];
+		if (!body.tracked || body.bodyId < 0 || body.bodyId >= BODY_COUNT_MAX) continue;
+		unsigned int mask = delta ? delta->jointMask[b] : SKELETON_DELTA_ALL_JOINTS;
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			if (!(mask & (1u << j))) continue;
+			int bytes = messageBytes[body.bodyId][j];
+			if (bStarted && bundleBytes + bytes > maxPacketBytes) {
+				sender.sendBundle(bundle);
+				packets++;
+				bStarted = false;
+			}
+			if (!bStarted) {
+				startBundle(frame);
+				bStarted = true;
+			}
+			jointMessage(body, j, m);
+			bundle.addMessage(m);
+			bundleBytes += bytes;
+		}
+	}
+	if (bStarted) {
+		sender.sendBundle(bundle);
+		packets++;
+	}
+	return packets;
+}
+
+int SkeletonJointBundler::sendUnbundled(ofxOscSender & sender, const KinectFrame & frame, const SkeletonDelta * delta) {
+	int packets = 0;
+	ofxOscMessage m;
+	for (int b = 0; b < BODY_COUNT_MAX; b++) {
+		const BodySample & body = frame.bodies[b];
+		if (!body.tracked || body.bodyId < 0 || body.bodyId >= BODY_COUNT_MAX) continue;
+		unsigned int mask = delta ? delta->jointMask[b] : SKELETON_DELTA_ALL_JOINTS;
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			if (!(mask & (1u << j))) continue;
+			jointMessage(body, j, m);
+			sender.sendMessage(m);
+			packets++;
+		}
+	}
+	return packets;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ofxOsc.h"
+#include "frameSource.h"
+#include "skeletonDelta.h"
+#include "skeletonFeatures.h"
+
+// Binary skeleton over OSC: one message per body with typed arguments in a fixed joint order,
+// the joint names are announced separately with the schema message. Compared to the JSON
+// strings nothing is formatted or escaped, and a receiver reads the floats directly.
+//
+//   /kV2/skel/<bodyId>  i tracked  h trackingId  i leftHandState  i rightHandState
+//                       h jointStates (2 bits per joint, JointTrackingState, joint j at bit 2j)
+//                       f x f y f z  per joint in schema order, camera space meters
+//                       (tracked bodies only, untracked ones stop after rightHandState)
+//
+//   /kV2/skel/schema    i version  i jointCount  s jointName ...
+//
+// Receivers can ask for the schema with /kV2/skel/schema/get, it is also repeated every
+// SKELETON_SCHEMA_INTERVAL seconds for anyone joining late.
+#define SKELETON_SCHEMA_VERSION 1
+#define SKELETON_SCHEMA_INTERVAL 5.0f
+#define SKELETON_SCHEMA_ADDRESS "/kV2/skel/schema"
+#define SKELETON_SCHEMA_GET_ADDRESS "/kV2/skel/schema/get"
+
+void skeletonBinaryMessage(const BodySample & body, ofxOscMessage & m);
+void skeletonSchemaMessage(ofxOscMessage & m);
+
+// JointTrackingState of every joint, 2 bits each
+long long skeletonJointStates(const BodySample & body);
+
+// FeatureEngine output, tracked bodies only:
+//   /kV2/features/<bodyId>  i triggers  i triggersStarted (FeatureTrigger bits)  f handDistance
+//                           f angle x FEATURE_ANGLE_COUNT (featureAngleNames order, degrees)
+//                           f speed x 25  f acceleration x 25 (JointType order)
+//   /kV2/bones/<bodyId>     f dx f dy f dz f length  per bone in boneAtlas order
+void skeletonFeaturesMessage(int bodyId, const BodyFeatures & features, ofxOscMessage & m);
+void skeletonBonesMessage(int bodyId, const BodyFeatures & features, ofxOscMessage & m);
+
+//--------------------------------------------------------------
+// The per joint messages of the plain OSC mode, /<bodyId>/<jointName> f x f y f z s jointName,
+// packed into bundles: as many joints as fit in one datagram (maxPacketBytes, the ethernet MTU
+// minus IP/UDP headers by default), so a frame is one or two packets instead of 25 per body.
+// Every bundle starts with /kV2/frame h frameNumber h timestamp (microseconds), the same for all
+// bundles of a frame. ofxOsc sends bundles with the "immediately" time tag, so the frame time
+// can't go into the bundle header.
+#define SKELETON_BUNDLE_MAX_BYTES 1472
+#define SKELETON_FRAME_ADDRESS "/kV2/frame"
+
+class SkeletonJointBundler {
+public:
+	SkeletonJointBundler();
+
+	// addresses and message sizes are worked out once here
+	void setup(const char * const names[JOINT_COUNT], int maxPacketBytes = SKELETON_BUNDLE_MAX_BYTES);
+
+	// the joints of every tracked body (only the ones marked in delta if given),
+	// returns the number of packets sent
+	int sendBundled(ofxOscSender & sender, const KinectFrame & frame, const SkeletonDelta * delta = nullptr);
+	// one message per joint, the old way for receivers that can't take bundles
+	int sendUnbundled(ofxOscSender & sender, const KinectFrame & frame, const SkeletonDelta * delta = nullptr);
+
+	const string & getAddress(int bodyId, int joint) const { return addresses[bodyId][joint]; }
+
+private:
+	void jointMessage(const BodySample & body, int joint, ofxOscMessage & m) const;
+	void startBundle(const KinectFrame & frame);
+
+	const char * const * names;
+	int maxPacketBytes;
+	string addresses[BODY_COUNT_MAX][JOINT_COUNT];
+	int messageBytes[BODY_COUNT_MAX][JOINT_COUNT]; // encoded size inside a bundle
+
+	ofxOscBundle bundle;
+	int bundleBytes;
+};
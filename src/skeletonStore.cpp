@@ -0,0 +1,89 @@
+#include "skeletonStore.h"
+
+#include <cstring>
+
+//--------------------------------------------------------------
+void SkeletonFrame::clear() {
+	memset(this, 0, sizeof(*this));
+}
+
+void SkeletonFrame::fromBodies(const BodySample bodies[BODY_COUNT_MAX], unsigned long long frameNumber_, long long timestamp_) {
+	frameNumber = frameNumber_;
+	timestamp = timestamp_;
+	for (int b = 0; b < BODY_COUNT_MAX; b++) {
+		const BodySample & body = bodies[b];
+		trackingId[b] = body.trackingId;
+		tracked[b] = body.tracked;
+		leftHandState[b] = body.leftHandState;
+		rightHandState[b] = body.rightHandState;
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			const JointSample & joint = body.joints[j];
+			int i = index(b, j);
+			for (int c = 0; c < 3; c++) position[c][i] = joint.position[c];
+			for (int c = 0; c < 2; c++) depthPosition[c][i] = joint.depthPosition[c];
+			for (int c = 0; c < 4; c++) orientation[c][i] = joint.orientation[c];
+			trackingState[i] = (unsigned char)joint.trackingState;
+		}
+	}
+}
+
+void SkeletonFrame::toBodies(BodySample bodies[BODY_COUNT_MAX]) const {
+	for (int b = 0; b < BODY_COUNT_MAX; b++) {
+		BodySample & body = bodies[b];
+		body.bodyId = b;
+		body.trackingId = trackingId[b];
+		body.tracked = tracked[b];
+		body.leftHandState = leftHandState[b];
+		body.rightHandState = rightHandState[b];
+		if (!tracked[b]) continue;
+		for (int j = 0; j < JOINT_COUNT; j++) {
+			JointSample & joint = body.joints[j];
+			int i = index(b, j);
+			for (int c = 0; c < 3; c++) joint.position[c] = position[c][i];
+			for (int c = 0; c < 2; c++) joint.depthPosition[c] = depthPosition[c][i];
+			for (int c = 0; c < 4; c++) joint.orientation[c] = orientation[c][i];
+			joint.trackingState = trackingState[i];
+		}
+	}
+}
+
+//--------------------------------------------------------------
+SkeletonHistory::SkeletonHistory(int capacity_)
+	: capacity(capacity_ > 0 ? capacity_ : 1)
+	, count(0) {
+	slots.reset(new Slot[capacity]);
+	for (int i = 0; i < capacity; i++) {
+		slots[i].sequence.store(0);
+		slots[i].frame.clear();
+	}
+}
+
+void SkeletonHistory::push(const SkeletonFrame & frame) {
+	unsigned long long n = count.load(std::memory_order_relaxed);
+	Slot & slot = slots[n % capacity];
+
+	// frame n is sequence 2n + 2 once written, odd in between
+	slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(&slot.frame, &frame, sizeof(frame));
+	slot.sequence.store(2 * n + 2, std::memory_order_release);
+	count.store(n + 1, std::memory_order_release);
+}
+
+bool SkeletonHistory::get(int age, SkeletonFrame & frame) const {
+	// a few tries: only a writer lapping the whole ring during one copy makes this fail
+	for (int tries = 0; tries < 4; tries++) {
+		unsigned long long pushed = count.load(std::memory_order_acquire);
+		if (age < 0 || age >= capacity || (unsigned long long)age >= pushed) return false;
+
+		unsigned long long n = pushed - 1 - age;
+		const Slot & slot = slots[n % capacity];
+		unsigned long long before = slot.sequence.load(std::memory_order_acquire);
+		if (before != 2 * n + 2) continue; // being overwritten
+
+		memcpy(&frame, &slot.frame, sizeof(frame));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) == before) return true;
+	}
+	return false;
+}
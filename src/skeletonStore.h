@@ -0,0 +1,65 @@
+#pragma once
+
+#include "frameSource.h"
+
+#include <atomic>
+#include <memory>
+
+// Skeletons of one frame as structure of arrays: every per joint value is a row of
+// BODY_COUNT_MAX * JOINT_COUNT entries, indexed body * JOINT_COUNT + joint, so a pass over one
+// component of all six bodies is a single linear sweep (SkeletonFilter runs SIMD straight on
+// position[]). Rows are padded to a multiple of 8 floats.
+#define SKELETON_JOINTS (BODY_COUNT_MAX * JOINT_COUNT)
+#define SKELETON_STRIDE ((SKELETON_JOINTS + 7) & ~7)
+
+struct SkeletonFrame {
+	unsigned long long frameNumber;
+	long long timestamp; // microseconds, KinectFrame::timestamp
+
+	unsigned long long trackingId[BODY_COUNT_MAX];
+	int tracked[BODY_COUNT_MAX]; // joints are only valid when tracked
+	int leftHandState[BODY_COUNT_MAX];
+	int rightHandState[BODY_COUNT_MAX];
+
+	float position[3][SKELETON_STRIDE];      // camera space x y z in meters
+	float depthPosition[2][SKELETON_STRIDE]; // depth map pixels
+	float orientation[4][SKELETON_STRIDE];   // quaternion x y z w
+	unsigned char trackingState[SKELETON_STRIDE]; // JointTrackingState
+
+	static int index(int body, int joint) { return body * JOINT_COUNT + joint; }
+
+	void clear();
+	void fromBodies(const BodySample bodies[BODY_COUNT_MAX], unsigned long long frameNumber, long long timestamp);
+	// joints of untracked bodies are left alone
+	void toBodies(BodySample bodies[BODY_COUNT_MAX]) const;
+};
+
+// The last N skeleton frames. One writer (whoever receives the bodies), any number of readers
+// on any thread, no locks: every slot is a seqlock, a reader copies the frame out and retries
+// if the writer came around to that slot while it was copying.
+#define SKELETON_HISTORY_SIZE 64 // ~2 s at 30 fps
+
+class SkeletonHistory {
+public:
+	explicit SkeletonHistory(int capacity = SKELETON_HISTORY_SIZE);
+
+	// writer only
+	void push(const SkeletonFrame & frame);
+
+	// age 0 is the newest frame. False if there is no such frame (yet / anymore)
+	bool get(int age, SkeletonFrame & frame) const;
+	bool getLatest(SkeletonFrame & frame) const { return get(0, frame); }
+
+	unsigned long long getFramesPushed() const { return count.load(std::memory_order_acquire); }
+	int getCapacity() const { return capacity; }
+
+private:
+	struct Slot {
+		std::atomic<unsigned long long> sequence; // odd while being written
+		SkeletonFrame frame;
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	int capacity;
+	std::atomic<unsigned long long> count;
+};
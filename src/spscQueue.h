@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+// Bounded lock free single producer / single consumer queue of small values (slot indices).
+// pushDropOldest() lets the producer evict the oldest entry when the consumer falls behind,
+// which is why the head is advanced with a CAS on both sides. head / tail are ever increasing
+// 64 bit positions, so there is no ABA.
+template<typename T>
+class SpscQueue {
+public:
+	explicit SpscQueue(size_t capacity = 1) {
+		reset(capacity);
+	}
+
+	// empties the queue, not thread safe
+	void reset(size_t capacity) {
+		cap = capacity > 0 ? capacity : 1;
+		slots.reset(new std::atomic<T>[cap]);
+		head.store(0);
+		tail.store(0);
+	}
+
+	size_t capacity() const { return cap; }
+	size_t size() const { return (size_t)(tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire)); }
+	bool empty() const { return size() == 0; }
+
+	// producer, false if full
+	bool push(T item) {
+		unsigned long long t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) >= cap) return false;
+		slots[t % cap].store(item, std::memory_order_relaxed);
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// producer, never fails. Returns true and the evicted entry if the queue was full.
+	bool pushDropOldest(T item, T & evicted) {
+		bool bEvicted = false;
+		unsigned long long t = tail.load(std::memory_order_relaxed);
+		while (true) {
+			unsigned long long h = head.load(std::memory_order_acquire);
+			if (t - h < cap) break;
+			T oldest = slots[h % cap].load(std::memory_order_relaxed);
+			if (head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel)) {
+				evicted = oldest;
+				bEvicted = true;
+				break;
+			}
+			// the consumer took it first, there's room now
+		}
+		slots[t % cap].store(item, std::memory_order_relaxed);
+		tail.store(t + 1, std::memory_order_release);
+		return bEvicted;
+	}
+
+	// consumer, false if empty
+	bool pop(T & item) {
+		unsigned long long h = head.load(std::memory_order_acquire);
+		while (h != tail.load(std::memory_order_acquire)) {
+			T value = slots[h % cap].load(std::memory_order_relaxed);
+			if (head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel)) {
+				item = value;
+				return true;
+			}
+			// h was reloaded, the producer dropped the entry we read
+		}
+		return false;
+	}
+
+private:
+	SpscQueue(const SpscQueue &) = delete;
+	SpscQueue & operator=(const SpscQueue &) = delete;
+
+	size_t cap;
+	std::unique_ptr<std::atomic<T>[]> slots;
+	std::atomic<unsigned long long> head; // next to pop
+	std::atomic<unsigned long long> tail; // next to push
+};
@@ -0,0 +1,101 @@
+#include "stageTimers.h"
+
+#include <algorithm>
+
+static const char * timingNames[TIMING_STAGE_COUNT] = {
+	"fetch", "mapping", "skeletonOsc", "keying", "encode", "previewCopy",
+	"upload", "fbo", "readback", "ndiQueue", "spout", "draw",
+	"latencyOsc",
+	"latencySpoutDepth", "latencySpoutColor", "latencySpoutCutout", "latencySpoutKeyed", "latencySpoutInfrared",
+	"latencyNdiDepth", "latencyNdiColor", "latencyNdiCutout", "latencyNdiKeyed", "latencyNdiInfrared"
+};
+
+//--------------------------------------------------------------
+StageTimers::StageTimers() {
+	reset();
+}
+
+void StageTimers::reset() {
+	for (int s = 0; s < TIMING_STAGE_COUNT; s++) {
+		for (int i = 0; i < TIMING_WINDOW; i++) samples[s][i].store(0);
+		recorded[s].store(0);
+	}
+}
+
+const char * StageTimers::getName(int stage) {
+	return stage >= 0 && stage < TIMING_STAGE_COUNT ? timingNames[stage] : "";
+}
+
+//--------------------------------------------------------------
+void StageTimers::record(int stage, float micros) {
+	unsigned int n = recorded[stage].load(std::memory_order_relaxed);
+	samples[stage][n % TIMING_WINDOW].store(micros, std::memory_order_relaxed);
+	recorded[stage].store(n + 1, std::memory_order_release);
+}
+
+bool StageTimers::summarize(int stage, TimingSummary & summary) const {
+	unsigned int n = recorded[stage].load(std::memory_order_acquire);
+	summary.samples = n;
+	summary.p50 = summary.p95 = summary.p99 = summary.max = 0;
+	if (n == 0) return false;
+
+	// a sample being overwritten during the copy is either the old or the new one, both fine
+	float sorted[TIMING_WINDOW];
+	int count = n < TIMING_WINDOW ? (int)n : TIMING_WINDOW;
+	for (int i = 0; i < count; i++) {
+		sorted[i] = samples[stage][i].load(std::memory_order_relaxed);
+	}
+	std::sort(sorted, sorted + count);
+
+	// nearest rank
+	auto percentile = [&](int p) {
+		int rank = (p * count + 99) / 100;
+		return sorted[rank > 0 ? rank - 1 : 0] / 1000.0f;
+	};
+	summary.p50 = percentile(50);
+	summary.p95 = percentile(95);
+	summary.p99 = percentile(99);
+	summary.max = sorted[count - 1] / 1000.0f;
+	return true;
+}
+
+//--------------------------------------------------------------
+TimingCsvLog::TimingCsvLog()
+	: file(nullptr) {
+}
+
+TimingCsvLog::~TimingCsvLog() {
+	close();
+}
+
+bool TimingCsvLog::open(const std::string & path) {
+	close();
+	file = fopen(path.c_str(), "w");
+	if (!file) return false;
+
+	fprintf(file, "seconds");
+	for (int s = 0; s < TIMING_STAGE_COUNT; s++) {
+		const char * name = StageTimers::getName(s);
+		fprintf(file, ",%s_p50,%s_p95,%s_p99,%s_max", name, name, name, name);
+	}
+	fprintf(file, "\n");
+	return true;
+}
+
+void TimingCsvLog::close() {
+	if (!file) return;
+	fclose(file);
+	file = nullptr;
+}
+
+void TimingCsvLog::write(const StageTimers & timers, double seconds) {
+	if (!file) return;
+	fprintf(file, "%.3f", seconds);
+	for (int s = 0; s < TIMING_STAGE_COUNT; s++) {
+		TimingSummary summary;
+		timers.summarize(s, summary); // zeros if nothing yet
+		fprintf(file, ",%.3f,%.3f,%.3f,%.3f", summary.p50, summary.p95, summary.p99, summary.max);
+	}
+	fprintf(file, "\n");
+	fflush(file); // a crash mid show still leaves the log
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Rolling timings of every pipeline stage and of every output's frame arrival -> sent latency.
+// Each stage keeps its last TIMING_WINDOW samples in a ring, percentiles are worked out from a
+// copy when asked (overlay, OSC / CSV export), so record() is just two stores.
+// One writer thread per stage (acquisition, render or an NDI sender thread), any thread can read.
+// Render stages are cpu time: GL work is asynchronous, so TIMING_FBO is the submission cost.
+
+#define TIMING_WINDOW 512       // samples per stage, ~17 s at 30 fps
+#define TIMING_EXPORT_INTERVAL 1.0f // seconds between OSC / CSV exports
+#define TIMING_OSC_ADDRESS "/kV2/timing/" // + stage name: f p50 f p95 f p99 f max (ms), i samples
+
+enum TimingStage {
+	// acquisition thread
+	TIMING_FETCH,         // FrameSource::update() without the mapping (Kinect acquire, replay decode)
+	TIMING_MAPPING,       // depth -> color coordinate mapping (live only)
+	TIMING_SKELETON_OSC,  // skeleton store, filter, JSON / OSC encoding and send, features
+	TIMING_KEYING,
+	TIMING_ENCODE,        // cpu encodings handed to NDI without an fbo (depth, color)
+	TIMING_PREVIEW_COPY,  // frame buffers -> PreviewFrame
+	// render thread
+	TIMING_UPLOAD,        // textures from the PreviewFrame
+	TIMING_FBO,
+	TIMING_READBACK,      // PBO transfers and copies out
+	TIMING_NDI_QUEUE,     // handing frames to the NDI sender threads
+	TIMING_SPOUT,
+	TIMING_DRAW,          // all of draw()
+	// frame arrival -> sent, per output
+	TIMING_LATENCY_OSC,
+	TIMING_LATENCY_SPOUT_DEPTH,
+	TIMING_LATENCY_SPOUT_COLOR,
+	TIMING_LATENCY_SPOUT_CUTOUT,
+	TIMING_LATENCY_SPOUT_KEYED,
+	TIMING_LATENCY_SPOUT_INFRARED,
+	TIMING_LATENCY_NDI_DEPTH,
+	TIMING_LATENCY_NDI_COLOR,
+	TIMING_LATENCY_NDI_CUTOUT,
+	TIMING_LATENCY_NDI_KEYED,
+	TIMING_LATENCY_NDI_INFRARED,
+	TIMING_STAGE_COUNT
+};
+#define TIMING_FIRST_LATENCY TIMING_LATENCY_OSC
+
+struct TimingSummary {
+	float p50, p95, p99, max; // milliseconds
+	unsigned int samples;     // recorded since start / reset, not just in the window
+};
+
+class StageTimers {
+public:
+	StageTimers();
+
+	void reset(); // not thread safe
+
+	void record(int stage, float micros);
+	// false if nothing was recorded yet
+	bool summarize(int stage, TimingSummary & summary) const;
+
+	static const char * getName(int stage);
+
+	// steady clock, for timing a stage by hand
+	typedef std::chrono::steady_clock Clock;
+	static float microsSince(Clock::time_point start) {
+		return std::chrono::duration<float, std::micro>(Clock::now() - start).count();
+	}
+
+private:
+	std::atomic<float> samples[TIMING_STAGE_COUNT][TIMING_WINDOW];
+	std::atomic<unsigned int> recorded[TIMING_STAGE_COUNT];
+};
+
+// Adds the time until the end of the scope to micros, for stages made of several pieces
+class TimingScope {
+public:
+	TimingScope(float & micros_) : micros(micros_), start(StageTimers::Clock::now()) {}
+	~TimingScope() { micros += StageTimers::microsSince(start); }
+
+private:
+	float & micros;
+	StageTimers::Clock::time_point start;
+};
+
+// p50 / p95 / p99 / max of every stage, one row per export
+class TimingCsvLog {
+public:
+	TimingCsvLog();
+	~TimingCsvLog();
+
+	bool open(const std::string & path);
+	void close();
+	bool isOpen() const { return file != nullptr; }
+
+	void write(const StageTimers & timers, double seconds);
+
+private:
+	FILE * file;
+};
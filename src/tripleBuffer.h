@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+
+// Lock free handoff of the newest value from one producer thread to one consumer thread.
+// The producer fills getBack() and publish()es it, the consumer takes the newest published
+// one with update() and reads getFront(). Neither side ever waits: a producer that is faster
+// than the consumer just replaces the unread value, so frames are skipped, never queued.
+// Three slots so both sides always own one while the third holds the newest published.
+template<typename T>
+class TripleBuffer {
+public:
+	TripleBuffer()
+		: back(0)
+		, front(1)
+		, middle(2) {
+	}
+
+	// producer
+	T & getBack() { return slots[back]; }
+	void publish() {
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	// consumer, true if something was published since the last update()
+	bool update() {
+		if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+	const T & getFront() const { return slots[front]; }
+	T & getFront() { return slots[front]; }
+
+	// not thread safe, for setting the slots up before the threads start
+	T & getSlot(int i) { return slots[i]; }
+
+private:
+	TripleBuffer(const TripleBuffer &) = delete;
+	TripleBuffer & operator=(const TripleBuffer &) = delete;
+
+	enum { INDEX = 3, FRESH = 4 };
+
+	T slots[3];
+	int back;   // producer's
+	int front;  // consumer's
+	std::atomic<int> middle; // slot index | FRESH if the consumer hasn't taken it yet
+};
@@ -0,0 +1,116 @@
+#include "workerPool.h"
+
+//--------------------------------------------------------------
+WorkerPool::WorkerPool()
+	: generation(0)
+	, bQuit(false)
+	, busyWorkers(0)
+	, currentTask(nullptr)
+	, numTasks(0)
+	, nextTask(0)
+	, tasksRemaining(0) {
+}
+
+WorkerPool::~WorkerPool() {
+	stop();
+}
+
+//--------------------------------------------------------------
+void WorkerPool::setup(int numThreads) {
+	if (numThreads < 1) numThreads = 1;
+	if (numThreads == getNumThreads()) return;
+
+	stop();
+	bQuit = false;
+	for (int i = 1; i < numThreads; i++) {
+		workers.emplace_back(&WorkerPool::workerLoop, this);
+	}
+}
+
+void WorkerPool::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		bQuit = true;
+	}
+	wakeWorkers.notify_all();
+	for (auto & worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+}
+
+int WorkerPool::defaultNumThreads() {
+	// leave half the cores for the Kinect runtime, NDI and the GL thread
+	int cores = (int)std::thread::hardware_concurrency();
+	return cores > 2 ? cores / 2 : 1;
+}
+
+//--------------------------------------------------------------
+void WorkerPool::run(int count, const std::function<void(int)> & task) {
+	if (count <= 0) return;
+
+	if (workers.empty()) {
+		for (int i = 0; i < count; i++) {
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		currentTask = &task;
+		numTasks = count;
+		nextTask = 0;
+		tasksRemaining = count;
+		generation++;
+	}
+	wakeWorkers.notify_all();
+
+	// the calling thread takes tiles too
+	runTasks();
+
+	// barrier: every task done and no worker still looking at currentTask
+	std::unique_lock<std::mutex> lock(mutex);
+	tasksDone.wait(lock, [this] { return tasksRemaining == 0 && busyWorkers == 0; });
+	currentTask = nullptr;
+}
+
+//--------------------------------------------------------------
+void WorkerPool::runTasks() {
+	const int count = numTasks;
+	int i;
+	while ((i = nextTask.fetch_add(1)) < count) {
+		(*currentTask)(i);
+		tasksRemaining.fetch_sub(1);
+	}
+}
+
+void WorkerPool::workerLoop() {
+	unsigned int seenGeneration;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		seenGeneration = generation;
+	}
+
+	while (true) {
+		{
+			// a worker that wakes up after run() already returned sees currentTask == nullptr
+			// and goes back to sleep instead of touching the next run's state
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeWorkers.wait(lock, [&] { return bQuit || (generation != seenGeneration && currentTask); });
+			if (bQuit) return;
+			seenGeneration = generation;
+			busyWorkers++;
+		}
+
+		runTasks();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busyWorkers--;
+			if (busyWorkers == 0 && tasksRemaining == 0) {
+				tasksDone.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool of worker threads for splitting per-frame cpu work into tiles.
+// run() hands out task indices to the workers and the calling thread, and only returns
+// once every task has finished (acts as the barrier before the results are used).
+// Not re-entrant: run() must only be called from one thread at a time.
+class WorkerPool {
+public:
+	WorkerPool();
+	~WorkerPool();
+
+	// numThreads includes the calling thread, so 1 = no worker threads, everything runs inline
+	void setup(int numThreads);
+	void stop();
+	int getNumThreads() const { return (int)workers.size() + 1; }
+
+	void run(int numTasks, const std::function<void(int)> & task);
+
+	static int defaultNumThreads();
+
+private:
+	void workerLoop();
+	void runTasks();
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wakeWorkers;
+	std::condition_variable tasksDone;
+	unsigned int generation; // bumped for every run(), workers wait for it to change
+	bool bQuit;
+	int busyWorkers; // workers inside runTasks(), guarded by mutex
+
+	const std::function<void(int)> * currentTask;
+	int numTasks;
+	std::atomic<int> nextTask;
+	std::atomic<int> tasksRemaining;
+};